@@ -0,0 +1,496 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// replays a camera path with fixed time steps and measures the performance
+//   of the traversal and the resource pipeline, no window system nor gpu is used
+// the results are written as json
+
+#include <vts-browser/log.hpp>
+#include <vts-browser/map.hpp>
+#include <vts-browser/mapOptions.hpp>
+#include <vts-browser/mapCallbacks.hpp>
+#include <vts-browser/mapStatistics.hpp>
+#include <vts-browser/camera.hpp>
+#include <vts-browser/cameraOptions.hpp>
+#include <vts-browser/cameraStatistics.hpp>
+#include <vts-browser/navigation.hpp>
+#include <vts-browser/navigationOptions.hpp>
+#include <vts-browser/position.hpp>
+#include <vts-browser/resources.hpp>
+#include <vts-browser/buffer.hpp>
+#include <vts-browser/fetcher.hpp>
+#include <vts-browser/boostProgramOptions.hpp>
+
+#include <boost/program_options.hpp>
+
+#include <chrono>
+#include <thread>
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <iomanip>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+namespace po = boost::program_options;
+
+namespace
+{
+
+typedef std::chrono::steady_clock Clock;
+
+struct AppOptions
+{
+    std::string mapconfig;
+    std::string auth;
+    std::string pathPath;
+    std::string outputPath = "-";
+    std::string replayPath;
+    std::string recordPath;
+    vts::FetcherReplayOptions replayOptions;
+    uint32 width = 1024;
+    uint32 height = 768;
+    uint32 ticksPerPosition = 1;
+    uint32 settleTicks = 0;
+    uint32 convertPoints = 100000;
+    double elapsedTime = 1.0 / 60;
+};
+
+void dataEntry(vts::Map *map)
+{
+    vts::setLogThreadName("data");
+    map->dataAllRun();
+}
+
+// nothing is uploaded, only the memory costs are accounted for
+void bindLoadFunctions(vts::Map &map)
+{
+    vts::MapCallbacks &c = map.callbacks();
+    c.loadTexture = [](vts::ResourceInfo &info, vts::GpuTextureSpec &spec,
+        const std::string &)
+    {
+        info.gpuMemoryCost += spec.buffer.size();
+    };
+    c.loadMesh = [](vts::ResourceInfo &info, vts::GpuMeshSpec &spec,
+        const std::string &)
+    {
+        info.gpuMemoryCost += spec.vertices.size() + spec.indices.size();
+    };
+    c.loadFont = [](vts::ResourceInfo &info, vts::GpuFontSpec &spec,
+        const std::string &)
+    {
+        info.ramMemoryCost += spec.data.size();
+    };
+    c.loadGeodata = [](vts::ResourceInfo &, vts::GpuGeodataSpec &,
+        const std::string &)
+    {};
+}
+
+uint64 peakRssKB()
+{
+#ifdef _WIN32
+    return 0;
+#else
+    struct rusage u;
+    if (getrusage(RUSAGE_SELF, &u) != 0)
+        return 0;
+#ifdef __APPLE__
+    return u.ru_maxrss / 1024; // in bytes on apple
+#else
+    return u.ru_maxrss;
+#endif
+#endif
+}
+
+std::vector<std::string> loadPath(const std::string &path)
+{
+    std::ifstream f(path);
+    if (!f)
+        throw std::runtime_error("Failed to open camera path file");
+    std::vector<std::string> res;
+    std::string line;
+    while (std::getline(f, line))
+    {
+        if (line.empty() || line[0] == '#')
+            continue;
+        res.push_back(line);
+    }
+    if (res.empty())
+        throw std::runtime_error("Camera path is empty");
+    return res;
+}
+
+bool programOptions(vts::MapCreateOptions &createOptions,
+                    vts::MapRuntimeOptions &mapOptions,
+                    vts::FetcherOptions &fetcherOptions,
+                    vts::CameraOptions &camOptions,
+                    AppOptions &appOptions,
+                    int argc, char *argv[])
+{
+    po::options_description desc("Options");
+    desc.add_options()
+        ("help", "Show this help.")
+        ("url",
+            po::value<std::string>(&appOptions.mapconfig)->required(),
+            "Mapconfig URL, eg. file:///path/mapConfig.json."
+        )
+        ("auth",
+            po::value<std::string>(&appOptions.auth),
+            "Authentication URL."
+        )
+        ("path",
+            po::value<std::string>(&appOptions.pathPath)->required(),
+            "File with the camera path, one position per line.\n"
+            "Uses url format, eg.:\n"
+            "obj,long,lat,fix,height,pitch,yaw,roll,extent,fov"
+        )
+        ("output",
+            po::value<std::string>(&appOptions.outputPath)
+            ->default_value(appOptions.outputPath),
+            "Path of the json with results, - for standard output."
+        )
+        ("replay",
+            po::value<std::string>(&appOptions.replayPath),
+            "Fetcher archive with recorded downloads, "
+            "the network is used if empty."
+        )
+        ("record",
+            po::value<std::string>(&appOptions.recordPath),
+            "Fetcher archive to store the downloads into."
+        )
+        ("replay.durationScale",
+            po::value<double>(&appOptions.replayOptions.durationScale)
+            ->default_value(appOptions.replayOptions.durationScale),
+            "Multiplier of the recorded download durations."
+        )
+        ("replay.latency",
+            po::value<double>(&appOptions.replayOptions.latency)
+            ->default_value(appOptions.replayOptions.latency),
+            "Milliseconds added to each download."
+        )
+        ("replay.latencyJitter",
+            po::value<double>(&appOptions.replayOptions.latencyJitter)
+            ->default_value(appOptions.replayOptions.latencyJitter),
+            "Maximum random milliseconds added to each download."
+        )
+        ("replay.bandwidth",
+            po::value<double>(&appOptions.replayOptions.bandwidth)
+            ->default_value(appOptions.replayOptions.bandwidth),
+            "Bytes per second, 0 for unlimited."
+        )
+        ("replay.errorRate",
+            po::value<double>(&appOptions.replayOptions.errorRate)
+            ->default_value(appOptions.replayOptions.errorRate),
+            "Probability of simulated download errors."
+        )
+        ("replay.seed",
+            po::value<uint32>(&appOptions.replayOptions.seed)
+            ->default_value(appOptions.replayOptions.seed),
+            "Seed for the jitter and the errors."
+        )
+        ("elapsedTime",
+            po::value<double>(&appOptions.elapsedTime)
+            ->default_value(appOptions.elapsedTime),
+            "Seconds passed to each render tick."
+        )
+        ("ticksPerPosition",
+            po::value<uint32>(&appOptions.ticksPerPosition)
+            ->default_value(appOptions.ticksPerPosition),
+            "Render ticks for each position of the path."
+        )
+        ("settleTicks",
+            po::value<uint32>(&appOptions.settleTicks)
+            ->default_value(appOptions.settleTicks),
+            "Additional render ticks at the last position."
+        )
+        ("width",
+            po::value<uint32>(&appOptions.width)
+            ->default_value(appOptions.width),
+            "Viewport width."
+        )
+        ("height",
+            po::value<uint32>(&appOptions.height)
+            ->default_value(appOptions.height),
+            "Viewport height."
+        )
+        ("convertPoints",
+            po::value<uint32>(&appOptions.convertPoints)
+            ->default_value(appOptions.convertPoints),
+            "Number of points for the coordinates conversion benchmark."
+        )
+        ;
+
+    vts::optionsConfigLog(desc);
+    vts::optionsConfigMapCreate(desc, &createOptions);
+    vts::optionsConfigMapRuntime(desc, &mapOptions);
+    vts::optionsConfigCamera(desc, &camOptions);
+    vts::optionsConfigFetcherOptions(desc, &fetcherOptions);
+
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+
+    if (vm.count("help"))
+    {
+        std::cout << "Usage: " << argv[0] << " [options]" << std::endl << desc << std::endl;
+        return false;
+    }
+
+    po::notify(vm);
+    return true;
+}
+
+struct Results
+{
+    std::vector<double> frameTimes; // milliseconds
+    uint64 nodesRendered = 0;
+    uint64 metaNodesTraversed = 0;
+    uint64 nodeMetaUpdates = 0;
+    uint64 nodeDrawsUpdates = 0;
+    uint32 peakRamUseKB = 0;
+    uint32 peakGpuUseKB = 0;
+    uint32 convertPoints = 0;
+    double convertDuration = 0; // seconds
+    double mapconfigDuration = 0; // seconds
+    double duration = 0; // seconds
+};
+
+double percentile(const std::vector<double> &sorted, double p)
+{
+    if (sorted.empty())
+        return 0;
+    std::size_t i = (std::size_t)std::ceil(p * sorted.size());
+    return sorted[std::min(std::max(i, (std::size_t)1), sorted.size()) - 1];
+}
+
+// measures points per second of the batch conversion
+//   the points are spread deterministically over geographic coordinates
+void benchmarkConvert(vts::Map &map, Results &results, uint32 count)
+{
+    if (count == 0)
+        return;
+    std::mt19937 random(count);
+    std::uniform_real_distribution<double> lon(-180, 180);
+    std::uniform_real_distribution<double> lat(-85, 85);
+    std::uniform_real_distribution<double> alt(0, 5000);
+    std::vector<double> src(count * 3), dst(count * 3);
+    for (uint32 i = 0; i < count; i++)
+    {
+        src[i * 3 + 0] = lon(random);
+        src[i * 3 + 1] = lat(random);
+        src[i * 3 + 2] = alt(random);
+    }
+    Clock::time_point start = Clock::now();
+    try
+    {
+        map.convert(src.data(), dst.data(), count,
+            vts::Srs::Navigation, vts::Srs::Physical);
+    }
+    catch (const std::exception &e)
+    {
+        vts::log(vts::LogLevel::warn3,
+            std::string() + "Conversion benchmark failed <" + e.what() + ">");
+        return;
+    }
+    results.convertDuration = std::chrono::duration<double>(
+        Clock::now() - start).count();
+    results.convertPoints = count;
+}
+
+void run(vts::Map &map, const std::vector<std::string> &path,
+    const vts::CameraOptions &camOptions,
+    const AppOptions &appOptions, Results &results)
+{
+    auto cam = map.createCamera();
+    cam->options() = camOptions;
+    cam->setViewportSize(appOptions.width, appOptions.height);
+    auto nav = cam->createNavigation();
+    nav->options().type = vts::NavigationType::Instant;
+
+    // wait for the mapconfig
+    {
+        Clock::time_point start = Clock::now();
+        while (!map.getMapconfigReady())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            map.renderUpdate(appOptions.elapsedTime);
+        }
+        results.mapconfigDuration = std::chrono::duration<double>(
+            Clock::now() - start).count();
+    }
+
+    benchmarkConvert(map, results, appOptions.convertPoints);
+
+    const uint32 ticks = path.size() * appOptions.ticksPerPosition
+        + appOptions.settleTicks;
+    results.frameTimes.reserve(ticks);
+    Clock::time_point begin = Clock::now();
+    for (uint32 tick = 0; tick < ticks; tick++)
+    {
+        uint32 index = tick / appOptions.ticksPerPosition;
+        if (tick % appOptions.ticksPerPosition == 0 && index < path.size())
+            nav->setPosition(vts::Position(path[index]));
+
+        Clock::time_point start = Clock::now();
+        map.renderUpdate(appOptions.elapsedTime);
+        cam->renderUpdate();
+        results.frameTimes.push_back(std::chrono::duration<double,
+            std::milli>(Clock::now() - start).count());
+
+        const vts::CameraStatistics &cs = cam->statistics();
+        results.nodesRendered += cs.nodesRenderedTotal;
+        results.metaNodesTraversed += cs.metaNodesTraversedTotal;
+        results.nodeMetaUpdates += cs.currentNodeMetaUpdates;
+        results.nodeDrawsUpdates += cs.currentNodeDrawsUpdates;
+        const vts::MapStatistics &ms = map.statistics();
+        results.peakRamUseKB = std::max(results.peakRamUseKB,
+            ms.currentRamMemUseKB);
+        results.peakGpuUseKB = std::max(results.peakGpuUseKB,
+            ms.currentGpuMemUseKB);
+    }
+    results.duration = std::chrono::duration<double>(
+        Clock::now() - begin).count();
+}
+
+std::string resultsJson(vts::Map &map, const Results &results,
+    const AppOptions &appOptions)
+{
+    std::vector<double> sorted = results.frameTimes;
+    std::sort(sorted.begin(), sorted.end());
+    double sum = 0;
+    for (double t : sorted)
+        sum += t;
+    const vts::MapStatistics &ms = map.statistics();
+
+    std::stringstream s;
+    s << std::setprecision(10);
+    s << "{\n";
+    s << "\"ticks\": " << sorted.size() << ",\n";
+    s << "\"elapsedTime\": " << appOptions.elapsedTime << ",\n";
+    s << "\"duration\": " << results.duration << ",\n";
+    s << "\"mapconfigDuration\": " << results.mapconfigDuration << ",\n";
+    s << "\"frameTimeMs\": {"
+        << "\"mean\": " << (sorted.empty() ? 0 : sum / sorted.size())
+        << ", \"p50\": " << percentile(sorted, 0.5)
+        << ", \"p90\": " << percentile(sorted, 0.9)
+        << ", \"p95\": " << percentile(sorted, 0.95)
+        << ", \"p99\": " << percentile(sorted, 0.99)
+        << ", \"max\": " << (sorted.empty() ? 0 : sorted.back())
+        << "},\n";
+    s << "\"traversal\": {"
+        << "\"nodesRendered\": " << results.nodesRendered
+        << ", \"metaNodesTraversed\": " << results.metaNodesTraversed
+        << ", \"nodeMetaUpdates\": " << results.nodeMetaUpdates
+        << ", \"nodeDrawsUpdates\": " << results.nodeDrawsUpdates
+        << "},\n";
+    s << "\"resources\": {"
+        << "\"created\": " << ms.resourcesCreated
+        << ", \"downloaded\": " << ms.resourcesDownloaded
+        << ", \"diskLoaded\": " << ms.resourcesDiskLoaded
+        << ", \"decoded\": " << ms.resourcesDecoded
+        << ", \"uploaded\": " << ms.resourcesUploaded
+        << ", \"failed\": " << ms.resourcesFailed
+        << ", \"released\": " << ms.resourcesReleased
+        << "},\n";
+    s << "\"memory\": {"
+        << "\"peakRamUseKB\": " << results.peakRamUseKB
+        << ", \"peakGpuUseKB\": " << results.peakGpuUseKB
+        << ", \"peakRssKB\": " << peakRssKB()
+        << "},\n";
+    s << "\"convert\": {"
+        << "\"points\": " << results.convertPoints
+        << ", \"pointsPerSecond\": " << (results.convertDuration > 0
+            ? results.convertPoints / results.convertDuration : 0)
+        << "},\n";
+    s << "\"mapStatistics\": " << ms.toJson() << "\n";
+    s << "}\n";
+    return s.str();
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    try
+    {
+        vts::setLogThreadName("main");
+
+        vts::MapCreateOptions createOptions;
+        createOptions.clientId = "vts-browser-benchmark";
+        createOptions.diskCache = false; // for repeatable results
+        vts::MapRuntimeOptions mapOptions;
+        vts::FetcherOptions fetcherOptions;
+        vts::CameraOptions camOptions;
+        AppOptions appOptions;
+        if (!programOptions(createOptions, mapOptions, fetcherOptions,
+            camOptions, appOptions, argc, argv))
+            return 0;
+        if (appOptions.ticksPerPosition == 0)
+            throw std::runtime_error("ticksPerPosition must be positive");
+        const std::vector<std::string> path = loadPath(appOptions.pathPath);
+
+        std::shared_ptr<vts::Fetcher> fetcher;
+        if (appOptions.replayPath.empty())
+            fetcher = vts::Fetcher::create(fetcherOptions);
+        else
+            fetcher = vts::Fetcher::createReplay(appOptions.replayPath,
+                appOptions.replayOptions);
+        if (!appOptions.recordPath.empty())
+            fetcher = vts::Fetcher::createRecording(fetcher,
+                appOptions.recordPath);
+
+        Results results;
+        std::string json;
+        {
+            vts::Map map(createOptions, fetcher);
+            map.options() = mapOptions;
+            bindLoadFunctions(map);
+            std::thread dataThread(&dataEntry, &map);
+            map.setMapconfigPath(appOptions.mapconfig, appOptions.auth);
+            run(map, path, camOptions, appOptions, results);
+            json = resultsJson(map, results, appOptions);
+            map.renderFinalize(); // this allows the data thread to finish
+            dataThread.join();
+        }
+
+        if (appOptions.outputPath == "-")
+            std::cout << json;
+        else
+            vts::writeLocalFileBuffer(appOptions.outputPath, vts::Buffer(json));
+        return 0;
+    }
+    catch(const std::exception &e)
+    {
+        std::stringstream s;
+        s << "Exception <" << e.what() << ">";
+        vts::log(vts::LogLevel::err4, s.str());
+        return 1;
+    }
+}
@@ -0,0 +1,222 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <map>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include <vts-browser/buffer.hpp>
+#include <vts-browser/log.hpp>
+#include <vts-browser/math.hpp>
+#include <vts-browser/resources.hpp>
+
+#include "benchmark.hpp"
+
+using namespace vts;
+
+namespace
+{
+
+struct Timing
+{
+    double seconds = 0;
+    uint64 pixels = 0;
+    uint64 bytes = 0;
+};
+
+template<class F>
+Timing measure(const std::vector<Buffer> &files, uint32 iterations, F f)
+{
+    Timing t;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (uint32 i = 0; i < iterations; i++)
+    {
+        for (const Buffer &b : files)
+        {
+            GpuTextureSpec spec = f(b);
+            t.pixels += spec.width * spec.height;
+            t.bytes += spec.buffer.size();
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    t.seconds = std::chrono::duration<double>(end - start).count();
+    return t;
+}
+
+void print(const std::string &name, const Timing &t, uint64 images)
+{
+    std::cout << std::setw(24) << std::left << name
+        << std::fixed << std::setprecision(3)
+        << std::setw(12) << std::right
+        << (t.seconds * 1000 / images) << " ms/image"
+        << std::setw(12) << (t.pixels / t.seconds * 1e-6) << " Mpix/s"
+        << std::setw(12) << (t.bytes / t.seconds / 1024 / 1024) << " MB/s"
+        << std::endl;
+}
+
+// obj files are decoded as separate triangles
+//   merge identical vertices to obtain an indexed mesh
+GpuMeshSpec weldMesh(const GpuMeshSpec &in)
+{
+    const uint32 stride = in.attributes[0].stride;
+    std::map<std::string, uint32> unique;
+    std::vector<uint32> indices;
+    indices.reserve(in.verticesCount);
+    for (uint32 i = 0; i < in.verticesCount; i++)
+    {
+        std::string key(in.vertices.data() + i * stride, stride);
+        auto it = unique.emplace(key, (uint32)unique.size()).first;
+        indices.push_back(it->second);
+    }
+
+    GpuMeshSpec out;
+    out.attributes = in.attributes;
+    out.verticesCount = unique.size();
+    out.vertices.allocate(out.verticesCount * stride);
+    for (const auto &it : unique)
+        memcpy(out.vertices.data() + it.second * stride,
+               it.first.data(), stride);
+    out.indicesCount = indices.size();
+    out.indexMode = GpuTypeEnum::UnsignedInt;
+    out.indices.allocate(out.indicesCount * sizeof(uint32));
+    memcpy(out.indices.data(), indices.data(), out.indices.size());
+    return out;
+}
+
+} // namespace
+
+void benchmarkDecode(const std::string &path, uint32 iterations,
+                     uint32 maxResolution)
+{
+    std::vector<Buffer> files;
+    uint64 inputSize = 0;
+    for (const auto &it : boost::filesystem::recursive_directory_iterator(path))
+    {
+        if (!boost::filesystem::is_regular_file(it.path()))
+            continue;
+        std::string ext = it.path().extension().string();
+        if (ext != ".jpg" && ext != ".jpeg" && ext != ".png")
+            continue;
+        files.push_back(readLocalFileBuffer(it.path().string()));
+        inputSize += files.back().size();
+    }
+    if (files.empty())
+        throw std::runtime_error("No images found for decode benchmark");
+    iterations = std::max(iterations, 1u);
+
+    std::cout << "Decoding " << files.size() << " images ("
+        << inputSize / 1024 << " KB), "
+        << iterations << " iterations" << std::endl;
+
+    // warm up (file cache, thread local decoders)
+    measure(files, 1, [](const Buffer &b) {
+        return GpuTextureSpec(b, true);
+    });
+
+    uint64 images = files.size() * (uint64)iterations;
+    print("decode + flip pass", measure(files, iterations,
+        [](const Buffer &b) {
+            GpuTextureSpec spec(b);
+            spec.verticalFlip();
+            return spec;
+        }), images);
+    print("decode bottom-up", measure(files, iterations,
+        [](const Buffer &b) {
+            return GpuTextureSpec(b, true);
+        }), images);
+    print("decode downscaled " + std::to_string(maxResolution),
+        measure(files, iterations,
+        [&](const Buffer &b) {
+            return GpuTextureSpec(b, true, maxResolution);
+        }), images);
+}
+
+void benchmarkMeshes(const std::string &path, uint32 iterations)
+{
+    std::vector<GpuMeshSpec> meshes;
+    uint64 triangles = 0;
+    for (const auto &it : boost::filesystem::recursive_directory_iterator(path))
+    {
+        if (!boost::filesystem::is_regular_file(it.path())
+            || it.path().extension().string() != ".obj")
+            continue;
+        GpuMeshSpec spec(readLocalFileBuffer(it.path().string()));
+        if (spec.faceMode != GpuMeshSpec::FaceMode::Triangles)
+            continue;
+        spec.attributes[0].enable = true;
+        spec.attributes[0].stride = sizeof(vec3f) + sizeof(vec2f);
+        spec.attributes[0].components = 3;
+        spec.attributes[1].enable = true;
+        spec.attributes[1].stride = spec.attributes[0].stride;
+        spec.attributes[1].components = 2;
+        spec.attributes[1].offset = sizeof(vec3f);
+        meshes.push_back(weldMesh(spec));
+        triangles += meshes.back().indicesCount / 3;
+    }
+    if (meshes.empty())
+        throw std::runtime_error("No meshes found for mesh benchmark");
+    iterations = std::max(iterations, 1u);
+
+    std::cout << "Optimizing " << meshes.size() << " meshes ("
+        << triangles << " triangles), "
+        << iterations << " iterations" << std::endl;
+
+    double original = 0, optimized = 0, seconds = 0;
+    for (const GpuMeshSpec &m : meshes)
+    {
+        uint32 tris = m.indicesCount / 3;
+        original += m.vertexCacheMissRatio() * tris;
+        for (uint32 i = 0; i < iterations; i++)
+        {
+            GpuMeshSpec c;
+            c.attributes = m.attributes;
+            c.verticesCount = m.verticesCount;
+            c.indicesCount = m.indicesCount;
+            c.indexMode = m.indexMode;
+            c.vertices = m.vertices.copy();
+            c.indices = m.indices.copy();
+            auto start = std::chrono::high_resolution_clock::now();
+            c.optimize();
+            auto end = std::chrono::high_resolution_clock::now();
+            seconds += std::chrono::duration<double>(end - start).count();
+            if (i == 0)
+                optimized += c.vertexCacheMissRatio() * tris;
+        }
+    }
+
+    std::cout << std::fixed << std::setprecision(3)
+        << "acmr original:  " << (original / triangles) << std::endl
+        << "acmr optimized: " << (optimized / triangles) << std::endl
+        << "optimization:   "
+        << (triangles * (double)iterations / seconds * 1e-6)
+        << " Mtris/s" << std::endl;
+}
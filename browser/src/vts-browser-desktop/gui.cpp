@@ -617,6 +617,12 @@ public:
                     else
                         nk_label(&ctx, "no", NK_TEXT_RIGHT);
 
+                    // depth feedback divisor
+                    nk_label(&ctx, "Depth divisor:", NK_TEXT_LEFT);
+                    r.depthFeedbackDivisor = nk_slide_int(&ctx, 1, r.depthFeedbackDivisor, 8, 1);
+                    sprintf(buffer, "%d", r.depthFeedbackDivisor);
+                    nk_label(&ctx, buffer, NK_TEXT_RIGHT);
+
                     // maxResourcesMemory
                     nk_label(&ctx, "Target memory:", NK_TEXT_LEFT);
                     mr.targetResourcesMemoryKB = 1024 * nk_slide_int(&ctx, 0, mr.targetResourcesMemoryKB / 1024, 8192, 128);
@@ -768,6 +774,12 @@ public:
                 // geodata hysteresis
                 r.geodataHysteresis = nk_check_label(&ctx, "Geodata hysteresis", r.geodataHysteresis);
 
+                // geodata batching
+                r.geodataBatching = nk_check_label(&ctx, "Geodata batching", r.geodataBatching);
+
+                // indirect surfaces
+                r.surfacesIndirect = nk_check_label(&ctx, "Indirect surfaces", r.surfacesIndirect);
+
                 // camera zoom limit
                 {
                     int e = viewExtentLimitScaleMax == std::numeric_limits<double>::infinity();
@@ -909,6 +921,19 @@ public:
                     nk_tree_pop(&ctx);
                 }
 
+                if (nk_tree_push(&ctx, NK_TREE_TAB, "Meshes", NK_MINIMIZED))
+                {
+                    float ratio2[] = { width * 0.45f, width * 0.45f };
+                    nk_layout_row(&ctx, NK_STATIC, 16, 2, ratio2);
+
+                    double tris = std::max(ms.meshTrianglesOptimized, 1u);
+                    S("Triangles:", ms.meshTrianglesOptimized, "");
+                    S("Acmr original:", ms.meshCacheMissesOriginal / tris, "");
+                    S("Acmr optimized:", ms.meshCacheMissesOptimized / tris, "");
+
+                    nk_tree_pop(&ctx);
+                }
+
                 nk_tree_pop(&ctx);
             }
 
@@ -964,6 +989,45 @@ public:
 
                 nk_tree_pop(&ctx);
             }
+
+            // renderer
+            if (nk_tree_push(&ctx, NK_TREE_TAB, "Renderer", NK_MINIMIZED))
+            {
+                const float ratio[] = { width * 0.5f, width * 0.5f };
+                nk_layout_row(&ctx, NK_STATIC, 16, 2, ratio);
+
+                const RenderStatistics &rs = window->view->statistics();
+                S("Geodata draws:", rs.geodataDrawCalls, "");
+                S("Batched quads:", rs.geodataBatchedQuads, "");
+                S("Uniform buffers:", rs.uniformBuffers, "");
+                S("Uniform ranges:", rs.uniformRanges, "");
+                S("Uniform upload:", rs.uniformUploadBytes / 1024, " KB");
+                S("Surface draws:", rs.surfaceDrawCalls, "");
+                S("Indirect surfaces:", rs.surfaceIndirectDraws, "");
+                S("Opaque cpu time:", rs.opaqueCpuTimeUs, " us");
+                S("Depth feedback width:", rs.depthFeedbackWidth, "");
+                S("Depth feedback height:", rs.depthFeedbackHeight, "");
+                S("Depth readbacks:", rs.depthReadbacks, "");
+                S("Depth readbacks skipped:", rs.depthReadbacksSkipped, "");
+                S("Depth latency:", rs.depthFeedbackLatency, " frames");
+
+                const ContextStatistics &xs = window->context.statistics();
+                S("Shader programs:", xs.shaderPrograms, "");
+                S("Shaders from cache:", xs.shaderCacheHits, "");
+                S("Shaders load time:", xs.shaderLoadTimeUs / 1000, " ms");
+                S("Context init time:", xs.initializationTimeUs / 1000, " ms");
+                S("Mesh pool chunks:", xs.meshPoolChunks, "");
+                S("Mesh pool used:", xs.meshPoolUsedKB, " KB");
+                S("Mesh pool capacity:", xs.meshPoolCapacityKB, " KB");
+                S("Mesh pool free ranges:", xs.meshPoolFreeRanges, "");
+                S("Mesh pool largest free:", xs.meshPoolLargestFreeKB, " KB");
+                S("Texture pool:", xs.texturePoolTextures, "");
+                S("Texture pool memory:", xs.texturePoolMemoryKB, " KB");
+                S("Texture reuses:", xs.texturePoolReuses, "");
+                S("Texture creations:", xs.texturePoolCreations, "");
+
+                nk_tree_pop(&ctx);
+            }
         }
 
         // end window
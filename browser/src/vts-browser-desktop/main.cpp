@@ -33,6 +33,7 @@
 #include "mainWindow.hpp"
 #include "dataThread.hpp"
 #include "programOptions.hpp"
+#include "benchmark.hpp"
 
 #include <vts-renderer/highPerformanceGpuHint.h>
 
@@ -126,6 +127,20 @@ int main(int argc, char *argv[])
         renderOptions.colorToTexture = true;
         if (!programOptions(createOptions, mapOptions, fetcherOptions, camOptions, navOptions, renderOptions, appOptions, argc, argv))
             return 0;
+        if (!appOptions.benchmarkDecodePath.empty())
+        {
+            benchmarkDecode(appOptions.benchmarkDecodePath,
+                            appOptions.benchmarkIterations,
+                            mapOptions.maxTextureResolution
+                            ? mapOptions.maxTextureResolution : 128);
+            return 0;
+        }
+        if (!appOptions.benchmarkMeshesPath.empty())
+        {
+            benchmarkMeshes(appOptions.benchmarkMeshesPath,
+                            appOptions.benchmarkIterations);
+            return 0;
+        }
         struct GLFWwindow *renderWindow = nullptr;
         struct GLFWwindow *dataWindow = nullptr;
         initializeGlfw(renderWindow, dataWindow);
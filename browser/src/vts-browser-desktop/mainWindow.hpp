@@ -66,8 +66,11 @@ struct AppOptions
     std::vector<MapPaths> paths;
     std::string initialPosition;
     std::string initialView;
+    std::string benchmarkDecodePath;
+    std::string benchmarkMeshesPath;
     double guiScale = 1;
     uint32 oversampleRender = 1;
+    uint32 benchmarkIterations = 10;
     int renderCompas = 0;
     int simulatedFpsSlowdown = 0;
     bool screenshotOnFullRender = false;
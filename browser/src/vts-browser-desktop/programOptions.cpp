@@ -99,6 +99,21 @@ bool programOptions(vts::MapCreateOptions &createOptions,
             ->implicit_value(!appOptions.closeOnFullRender),
             "Quit the application when it finishes rendering."
         )
+        ("benchmark.decode",
+            po::value<std::string>(&appOptions.benchmarkDecodePath),
+            "Decode all images in the directory, print the timings and quit. "
+            "The downscaled case uses maxTextureResolution, or 128 if unset."
+        )
+        ("benchmark.meshes",
+            po::value<std::string>(&appOptions.benchmarkMeshesPath),
+            "Optimize all obj meshes in the directory, "
+            "print the cache miss ratios and quit."
+        )
+        ("benchmark.iterations",
+            po::value<uint32>(&appOptions.benchmarkIterations)
+            ->default_value(appOptions.benchmarkIterations),
+            "Number of passes over the benchmark data."
+        )
         ("render.atmosphere",
             po::value<bool>(&renderOptions.renderAtmosphere)
             ->default_value(renderOptions.renderAtmosphere)
@@ -117,6 +132,10 @@ bool programOptions(vts::MapCreateOptions &createOptions,
             ->implicit_value(2),
             "Rendering resolution multiplier."
         )
+        ("render.shaderCache",
+            po::value<std::string>(&vts::renderer::Shader::binaryCachePath),
+            "Directory for caching compiled shader programs."
+        )
         ("gui.scale",
             po::value<double>(&appOptions.guiScale)
             ->default_value(appOptions.guiScale)
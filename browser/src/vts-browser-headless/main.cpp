@@ -0,0 +1,508 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// renders images of a list of positions without any window system
+//   (eg. with mesa software rasterizer and its surfaceless platform)
+// two cameras alternate: while one is rendered and saved,
+//   the other one is already loading resources for the next position
+
+#include <vts-browser/log.hpp>
+#include <vts-browser/map.hpp>
+#include <vts-browser/mapOptions.hpp>
+#include <vts-browser/camera.hpp>
+#include <vts-browser/cameraOptions.hpp>
+#include <vts-browser/cameraStatistics.hpp>
+#include <vts-browser/navigation.hpp>
+#include <vts-browser/navigationOptions.hpp>
+#include <vts-browser/position.hpp>
+#include <vts-browser/resources.hpp>
+#include <vts-browser/buffer.hpp>
+#include <vts-browser/fetcher.hpp>
+#include <vts-browser/boostProgramOptions.hpp>
+#include <vts-renderer/renderer.hpp>
+#include <vts-renderer/classes.hpp>
+
+#include <glad/glad.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <boost/program_options.hpp>
+
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+
+namespace po = boost::program_options;
+
+namespace
+{
+
+typedef std::chrono::steady_clock Clock;
+
+struct AppOptions
+{
+    std::string mapconfig = "https://cdn.melown.com/mario/store/melown2015/map-config/melown/Melown-Earth-Intergeo-2017/mapConfig.json";
+    std::string auth;
+    std::string positionsPath;
+    std::string outputPath = ".";
+    uint32 width = 1024;
+    uint32 height = 768;
+    uint32 settleFrames = 3; // minimum frames rendered for each image
+    double timeout = 60; // seconds for each image
+};
+
+EGLDisplay display = EGL_NO_DISPLAY;
+EGLContext renderContext = EGL_NO_CONTEXT;
+EGLContext dataContext = EGL_NO_CONTEXT;
+
+void initializeEgl()
+{
+    // prefer the surfaceless platform, it needs neither window system nor gpu
+    const char *clientExts = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay
+        = (PFNEGLGETPLATFORMDISPLAYEXTPROC)
+        eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay && clientExts
+        && strstr(clientExts, "EGL_MESA_platform_surfaceless"))
+    {
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,
+            EGL_DEFAULT_DISPLAY, nullptr);
+    }
+    if (display == EGL_NO_DISPLAY)
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (display == EGL_NO_DISPLAY
+        || !eglInitialize(display, nullptr, nullptr))
+        throw std::runtime_error("Failed to initialize EGL display");
+
+    // the renderer uses its own frame buffers, no surfaces are needed
+    const char *exts = eglQueryString(display, EGL_EXTENSIONS);
+    if (!exts || !strstr(exts, "EGL_KHR_surfaceless_context"))
+        throw std::runtime_error("EGL does not support surfaceless contexts");
+    if (!eglBindAPI(EGL_OPENGL_API))
+        throw std::runtime_error("EGL does not support OpenGL");
+
+    const EGLint configAttribs[] = {
+        EGL_SURFACE_TYPE, 0,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    EGLConfig config = nullptr;
+    EGLint count = 0;
+    if (!eglChooseConfig(display, configAttribs, &config, 1, &count)
+        || count == 0)
+        throw std::runtime_error("Failed to choose EGL config");
+
+    // use OpenGL version 3.3 core profile
+    const EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION_KHR, 3,
+        EGL_CONTEXT_MINOR_VERSION_KHR, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR,
+        EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+        EGL_NONE
+    };
+    renderContext = eglCreateContext(display, config,
+        EGL_NO_CONTEXT, contextAttribs);
+    dataContext = eglCreateContext(display, config,
+        renderContext, contextAttribs);
+    if (renderContext == EGL_NO_CONTEXT || dataContext == EGL_NO_CONTEXT)
+        throw std::runtime_error("Failed to create OpenGL contexts");
+
+    if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+        renderContext))
+        throw std::runtime_error("Failed to make OpenGL context current");
+}
+
+void finalizeEgl()
+{
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(display, dataContext);
+    eglDestroyContext(display, renderContext);
+    eglTerminate(display);
+}
+
+void dataEntry(vts::Map *map)
+{
+    vts::setLogThreadName("data");
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, dataContext);
+    vts::renderer::installGlDebugCallback();
+    map->dataAllRun();
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+}
+
+// encodes and saves the images on separate thread
+class ImageWriter
+{
+public:
+    ImageWriter() : thr(&ImageWriter::run, this)
+    {}
+
+    ~ImageWriter()
+    {
+        {
+            std::unique_lock<std::mutex> lock(mut);
+            stop = true;
+        }
+        cond.notify_all();
+        thr.join();
+    }
+
+    void push(const std::string &path, vts::GpuTextureSpec &&spec)
+    {
+        std::unique_lock<std::mutex> lock(mut);
+        // limit the memory if the encoding is slower than the rendering
+        cond.wait(lock, [&]() { return queue.size() < MaxQueue; });
+        queue.emplace_back(path, std::move(spec));
+        cond.notify_all();
+    }
+
+private:
+    void run()
+    {
+        vts::setLogThreadName("writer");
+        while (true)
+        {
+            std::pair<std::string, vts::GpuTextureSpec> item;
+            {
+                std::unique_lock<std::mutex> lock(mut);
+                cond.wait(lock, [&]() { return stop || !queue.empty(); });
+                if (queue.empty())
+                    return;
+                item = std::move(queue.front());
+                queue.pop_front();
+            }
+            cond.notify_all();
+            item.second.verticalFlip();
+            vts::writeLocalFileBuffer(item.first, item.second.encodePng());
+        }
+    }
+
+    static const uint32 MaxQueue = 4;
+    std::deque<std::pair<std::string, vts::GpuTextureSpec>> queue;
+    std::mutex mut;
+    std::condition_variable cond;
+    bool stop = false;
+    std::thread thr;
+};
+
+vts::GpuTextureSpec readImage(vts::renderer::RenderView *view)
+{
+    const vts::renderer::RenderOptions &ro = view->options();
+    const vts::renderer::RenderVariables &rv = view->variables();
+    vts::GpuTextureSpec spec;
+    spec.width = ro.width;
+    spec.height = ro.height;
+    spec.components = 3;
+    spec.buffer.resize(spec.expectedSize());
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, rv.frameReadBufferId);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, spec.width, spec.height, GL_RGB,
+        GL_UNSIGNED_BYTE, spec.buffer.data());
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    return spec;
+}
+
+std::vector<std::string> loadPositions(const std::string &path)
+{
+    std::ifstream f(path);
+    if (!f)
+        throw std::runtime_error("Failed to open positions file");
+    std::vector<std::string> res;
+    std::string line;
+    while (std::getline(f, line))
+    {
+        if (line.empty() || line[0] == '#')
+            continue;
+        res.push_back(line);
+    }
+    return res;
+}
+
+bool programOptions(vts::MapCreateOptions &createOptions,
+                    vts::MapRuntimeOptions &mapOptions,
+                    vts::FetcherOptions &fetcherOptions,
+                    vts::CameraOptions &camOptions,
+                    vts::renderer::RenderOptions &renderOptions,
+                    AppOptions &appOptions,
+                    int argc, char *argv[])
+{
+    po::options_description desc("Options");
+    desc.add_options()
+        ("help", "Show this help.")
+        ("url",
+            po::value<std::string>(&appOptions.mapconfig)
+            ->default_value(appOptions.mapconfig),
+            "Mapconfig URL."
+        )
+        ("auth",
+            po::value<std::string>(&appOptions.auth),
+            "Authentication URL."
+        )
+        ("positions",
+            po::value<std::string>(&appOptions.positionsPath)->required(),
+            "File with positions, one per line.\n"
+            "Uses url format, eg.:\n"
+            "obj,long,lat,fix,height,pitch,yaw,roll,extent,fov"
+        )
+        ("output",
+            po::value<std::string>(&appOptions.outputPath)
+            ->default_value(appOptions.outputPath),
+            "Directory for the images."
+        )
+        ("width",
+            po::value<uint32>(&appOptions.width)
+            ->default_value(appOptions.width),
+            "Image width."
+        )
+        ("height",
+            po::value<uint32>(&appOptions.height)
+            ->default_value(appOptions.height),
+            "Image height."
+        )
+        ("settleFrames",
+            po::value<uint32>(&appOptions.settleFrames)
+            ->default_value(appOptions.settleFrames),
+            "Minimum number of frames rendered for each image."
+        )
+        ("timeout",
+            po::value<double>(&appOptions.timeout)
+            ->default_value(appOptions.timeout),
+            "Seconds to wait for each image to complete."
+        )
+        ("render.atmosphere",
+            po::value<bool>(&renderOptions.renderAtmosphere)
+            ->default_value(renderOptions.renderAtmosphere)
+            ->implicit_value(!renderOptions.renderAtmosphere),
+            "Render atmosphere."
+        )
+        ("render.antialiasing",
+            po::value<uint32>(&renderOptions.antialiasingSamples)
+            ->default_value(renderOptions.antialiasingSamples)
+            ->implicit_value(16),
+            "Antialiasing samples count."
+        )
+        ("render.shaderCache",
+            po::value<std::string>(&vts::renderer::Shader::binaryCachePath),
+            "Directory for caching compiled shader programs."
+        )
+        ;
+
+    vts::optionsConfigLog(desc);
+    vts::optionsConfigMapCreate(desc, &createOptions);
+    vts::optionsConfigMapRuntime(desc, &mapOptions);
+    vts::optionsConfigCamera(desc, &camOptions);
+    vts::optionsConfigFetcherOptions(desc, &fetcherOptions);
+
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+
+    if (vm.count("help"))
+    {
+        std::cout << "Usage: " << argv[0] << " [options]" << std::endl << desc << std::endl;
+        return false;
+    }
+
+    po::notify(vm);
+    return true;
+}
+
+struct Slot
+{
+    std::shared_ptr<vts::Camera> cam;
+    std::shared_ptr<vts::Navigation> nav;
+    std::shared_ptr<vts::renderer::RenderView> view;
+    Clock::time_point start;
+    uint32 index = -1; // of the position, -1 for idle
+    uint32 frames = 0; // rendered by the view (not background updates)
+};
+
+void run(vts::Map &map, vts::renderer::RenderContext &context,
+    const std::vector<std::string> &positions,
+    const vts::CameraOptions &camOptions,
+    const vts::renderer::RenderOptions &renderOptions,
+    const AppOptions &appOptions)
+{
+    ImageWriter writer;
+
+    Slot slots[2];
+    for (Slot &s : slots)
+    {
+        s.cam = map.createCamera();
+        s.cam->options() = camOptions;
+        s.cam->setViewportSize(appOptions.width, appOptions.height);
+        s.nav = s.cam->createNavigation();
+        s.nav->options().type = vts::NavigationType::Instant;
+        s.view = context.createView(s.cam.get());
+        vts::renderer::RenderOptions &ro = s.view->options();
+        ro = renderOptions;
+        ro.width = appOptions.width;
+        ro.height = appOptions.height;
+    }
+
+    // wait for the mapconfig
+    Clock::time_point last = Clock::now();
+    auto elapsed = [&]() -> double
+    {
+        Clock::time_point now = Clock::now();
+        double r = std::chrono::duration<double>(now - last).count();
+        last = now;
+        return r;
+    };
+    while (!map.getMapconfigReady())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        map.renderUpdate(elapsed());
+    }
+
+    uint32 next = 0;
+    auto assign = [&](Slot &s)
+    {
+        s.frames = 0;
+        s.start = Clock::now();
+        if (next < positions.size())
+        {
+            s.index = next++;
+            s.nav->setPosition(vts::Position(positions[s.index]));
+        }
+        else
+            s.index = -1;
+    };
+    for (Slot &s : slots)
+        assign(s);
+
+    const Clock::time_point begin = Clock::now();
+    uint32 done = 0;
+    uint32 current = 0;
+    while (slots[current].index != (uint32)-1)
+    {
+        map.renderUpdate(elapsed());
+        for (Slot &s : slots)
+        {
+            if (s.index == (uint32)-1)
+                continue;
+            s.cam->renderUpdate(); // this also requests the resources
+        }
+
+        Slot &c = slots[current];
+        c.view->render();
+        c.frames++;
+
+        const vts::CameraStatistics &cs = c.cam->statistics();
+        bool complete = c.frames >= appOptions.settleFrames
+            && cs.currentNodeMetaUpdates == 0
+            && cs.currentNodeDrawsUpdates == 0;
+        bool timeout = std::chrono::duration<double>(
+            Clock::now() - c.start).count() > appOptions.timeout;
+        if (!complete && !timeout)
+            continue;
+
+        std::stringstream name;
+        name << appOptions.outputPath << "/"
+            << std::setw(6) << std::setfill('0') << c.index << ".png";
+        {
+            std::stringstream s;
+            s << "Image <" << name.str() << "> "
+                << (complete ? "complete" : "timed out")
+                << " after " << c.frames << " frames";
+            vts::log(complete ? vts::LogLevel::info3
+                : vts::LogLevel::warn3, s.str());
+        }
+        writer.push(name.str(), readImage(c.view.get()));
+        done++;
+
+        // the other camera has been loading its position meanwhile
+        assign(c);
+        current = 1 - current;
+        slots[current].start = Clock::now();
+    }
+
+    double duration = std::chrono::duration<double>(
+        Clock::now() - begin).count();
+    std::stringstream s;
+    s << "Rendered " << done << " images in " << std::fixed
+        << std::setprecision(1) << duration << " s, "
+        << (duration > 0 ? done * 60 / duration : 0) << " images per minute";
+    vts::log(vts::LogLevel::info4, s.str());
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    try
+    {
+        vts::setLogThreadName("main");
+
+        vts::MapCreateOptions createOptions;
+        createOptions.clientId = "vts-browser-headless";
+        vts::MapRuntimeOptions mapOptions;
+        vts::FetcherOptions fetcherOptions;
+        vts::CameraOptions camOptions;
+        AppOptions appOptions;
+        vts::renderer::RenderOptions renderOptions;
+        renderOptions.colorToTargetFrameBuffer = false; // there is no window
+        renderOptions.colorToTexture = true;
+        if (!programOptions(createOptions, mapOptions, fetcherOptions,
+            camOptions, renderOptions, appOptions, argc, argv))
+            return 0;
+        const std::vector<std::string> positions
+            = loadPositions(appOptions.positionsPath);
+
+        initializeEgl();
+        vts::renderer::loadGlFunctions(
+            (GLADloadproc)&eglGetProcAddress);
+
+        {
+            vts::renderer::RenderContext context;
+            vts::Map map(createOptions, vts::Fetcher::create(fetcherOptions));
+            map.options() = mapOptions;
+            context.bindLoadFunctions(&map);
+            std::thread dataThread(&dataEntry, &map);
+            map.setMapconfigPath(appOptions.mapconfig, appOptions.auth);
+            run(map, context, positions, camOptions,
+                renderOptions, appOptions);
+            map.renderFinalize(); // this allows the data thread to finish
+            dataThread.join();
+        }
+
+        finalizeEgl();
+        return 0;
+    }
+    catch(const std::exception &e)
+    {
+        std::stringstream s;
+        s << "Exception <" << e.what() << ">";
+        vts::log(vts::LogLevel::err4, s.str());
+        return 1;
+    }
+}
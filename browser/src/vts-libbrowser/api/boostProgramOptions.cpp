@@ -138,6 +138,15 @@ void optionsConfigMapRuntime(
         po::value<uint32>(&opts->maxConcurrentDownloads),
         "Maximum size of the queue for the resources to be downloaded.")
 
+    ((section + "maxHostConcurrentDownloads").c_str(),
+        po::value<uint32>(&opts->maxHostConcurrentDownloads),
+        "Maximum number of concurrent downloads from single host.")
+
+    ((section + "adaptiveHostConcurrency").c_str(),
+        po::value<bool>(&opts->adaptiveHostConcurrency)
+        ->implicit_value(!opts->adaptiveHostConcurrency),
+        "Adapt the concurrency limit of each host to its latency.")
+
     ((section + "maxFetchRedirections").c_str(),
         po::value<uint32>(&opts->maxFetchRedirections),
         "Maximum number of redirections before the download fails.")
@@ -150,6 +159,16 @@ void optionsConfigMapRuntime(
         po::value<uint32>(&opts->fetchFirstRetryTimeOffset),
         "Delay in seconds for first resource download retry.")
 
+    ((section + "maxTextureResolution").c_str(),
+        po::value<uint32>(&opts->maxTextureResolution),
+        "Surface textures larger than this are downscaled "
+        "while decoding (zero keeps the full resolution).")
+
+    ((section + "optimizeMeshes").c_str(),
+        po::value<bool>(&opts->optimizeMeshes)
+        ->implicit_value(!opts->optimizeMeshes),
+        "Reorder surface meshes for the gpu vertex cache.")
+
     ((section + "debugSaveCorruptedFiles").c_str(),
         po::value<bool>(&opts->debugSaveCorruptedFiles)
         ->implicit_value(!opts->debugSaveCorruptedFiles),
@@ -37,6 +37,7 @@
 
 #include <cstring>
 #include <map>
+#include <algorithm>
 
 void initializeBrowserData();
 namespace
@@ -106,10 +107,11 @@ Buffer::~Buffer()
     this->free();
 }
 
-Buffer::Buffer(Buffer &&other) noexcept : data_(other.data_), size_(other.size_)
+Buffer::Buffer(Buffer &&other) noexcept : data_(other.data_), size_(other.size_), deleter_(std::move(other.deleter_))
 {
     other.data_ = nullptr;
     other.size_ = 0;
+    other.deleter_ = nullptr;
 }
 
 Buffer &Buffer::operator = (Buffer &&other) noexcept
@@ -118,8 +120,10 @@ Buffer &Buffer::operator = (Buffer &&other) noexcept
     this->free();
     size_ = other.size_;
     data_ = other.data_;
+    deleter_ = std::move(other.deleter_);
     other.data_ = nullptr;
     other.size_ = 0;
+    other.deleter_ = nullptr;
     return *this;
 }
 
@@ -130,6 +134,24 @@ Buffer Buffer::copy() const
     return r;
 }
 
+Buffer Buffer::adopt(char *data, uint32 size, std::function<void(char *)> deleter)
+{
+    assert(deleter);
+    Buffer r;
+    r.data_ = data;
+    r.size_ = size;
+    r.deleter_ = std::move(deleter);
+    return r;
+}
+
+Buffer Buffer::adopt(std::string &&str)
+{
+    if (str.empty())
+        return Buffer();
+    std::string *s = new std::string(std::move(str));
+    return adopt(&(*s)[0], s->size(), [s](char *) { delete s; });
+}
+
 std::string Buffer::str() const
 {
     return std::string(data_, size_);
@@ -148,6 +170,14 @@ void Buffer::allocate(uint32 size)
 
 void Buffer::resize(uint32 size)
 {
+    if (deleter_)
+    {
+        // adopted memory cannot be reallocated
+        Buffer tmp(size);
+        memcpy(tmp.data_, data_, std::min(size, size_));
+        *this = std::move(tmp);
+        return;
+    }
     char *tmp = (char*)realloc(data_, size);
     if (!tmp)
     {
@@ -166,7 +196,14 @@ void Buffer::zero()
 
 void Buffer::free()
 {
-    ::free(data_);
+    if (deleter_)
+    {
+        if (data_)
+            deleter_(data_);
+        deleter_ = nullptr;
+    }
+    else
+        ::free(data_);
     data_ = nullptr;
     size_ = 0;
 }
@@ -458,6 +458,21 @@ void vtsMapConvert(vtsHMap map, const double pointFrom[3], double pointTo[3], ui
     C_END
 }
 
+bool vtsMapGetTerrainAltitudes(vtsHMap map, const double *navPoints, double *altitudes, uint32 count, double resolution)
+{
+    C_BEGIN
+    return map->p->getTerrainAltitudes(navPoints, altitudes, count, resolution);
+    C_END
+    return false;
+}
+
+void vtsMapConvertArray(vtsHMap map, const double *pointsFrom, double *pointsTo, uint32 count, uint32 srsFrom, uint32 srsTo)
+{
+    C_BEGIN
+    map->p->convert(pointsFrom, pointsTo, count, (vts::Srs)srsFrom, (vts::Srs)srsTo);
+    C_END
+}
+
 ////////////////////////////////////////////////////////////////////////////
 // CAMERA
 ////////////////////////////////////////////////////////////////////////////
@@ -551,6 +566,13 @@ void vtsCameraSuggestedNearFar(vtsHCamera cam, double *near_, double *far_)
     C_END
 }
 
+void vtsCameraGetSurfaceAltitudes(vtsHCamera cam, const double *navPoints, double *altitudes, uint32 count, double sampleSize)
+{
+    C_BEGIN
+    cam->p->getSurfaceAltitudes(navPoints, altitudes, count, sampleSize);
+    C_END
+}
+
 void vtsCameraRenderUpdate(vtsHCamera cam)
 {
     C_BEGIN
@@ -1239,6 +1261,27 @@ vtsHFetcher vtsFetcherCreateDefault(const char *createOptions)
     return nullptr;
 }
 
+vtsHFetcher vtsFetcherCreateRecording(vtsHFetcher fetcher,
+    const char *archivePath)
+{
+    C_BEGIN
+    vtsHFetcher r = new vtsCFetcher();
+    r->p = vts::Fetcher::createRecording(fetcher->p, archivePath);
+    return r;
+    C_END
+    return nullptr;
+}
+
+vtsHFetcher vtsFetcherCreateReplay(const char *archivePath)
+{
+    C_BEGIN
+    vtsHFetcher r = new vtsCFetcher();
+    r->p = vts::Fetcher::createReplay(archivePath);
+    return r;
+    C_END
+    return nullptr;
+}
+
 void vtsFetcherDestroy(vtsHFetcher fetcher)
 {
     C_BEGIN
@@ -36,6 +36,7 @@
 #include "../geodata.hpp"
 #include "../position.hpp"
 #include "../resources.hpp"
+#include "../terrainHeights.hpp"
 
 #include <vts-libs/registry/json.hpp>
 #include <vts-libs/registry/io.hpp>
@@ -307,6 +308,31 @@ void Map::convert(const std::array<double, 3> &pointFrom, double pointTo[3], Srs
     convert(pointFrom.data(), pointTo, srsFrom, srsTo);
 }
 
+void Map::convert(const double *pointsFrom, double *pointsTo, uint32 count, Srs srsFrom, Srs srsTo) const
+{
+    if (!getMapconfigAvailable())
+    {
+        LOGTHROW(err4, std::logic_error) << "Map is not yet available.";
+    }
+    impl->convertor->convert(pointsFrom, pointsTo, count, srsFrom, srsTo);
+}
+
+bool Map::getTerrainAltitudes(const double *navPoints, double *altitudes, uint32 count, double resolution)
+{
+    if (!getMapconfigReady())
+    {
+        for (uint32 i = 0; i < count; i++)
+            altitudes[i] = nan1();
+        return false;
+    }
+    if (!impl->terrainHeights)
+        impl->terrainHeights = std::make_shared<TerrainHeights>(impl.get());
+    std::vector<vec3> pos(count);
+    for (uint32 i = 0; i < count; i++)
+        pos[i] = rawToVec3(navPoints + i * 3);
+    return impl->terrainHeights->query(pos.data(), altitudes, count, resolution);
+}
+
 std::vector<std::string> Map::getResourceSurfaces() const
 {
     if (!getMapconfigAvailable())
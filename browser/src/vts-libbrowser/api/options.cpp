@@ -103,12 +103,16 @@ void MapRuntimeOptions::applyJson(const std::string &json)
     AJ(renderTilesScale, asDouble);
     AJ(targetResourcesMemoryKB, asUInt);
     AJ(maxConcurrentDownloads, asUInt);
+    AJ(maxHostConcurrentDownloads, asUInt);
+    AJ(adaptiveHostConcurrency, asBool);
     AJ(maxCacheWriteQueueLength, asUInt);
     AJ(maxResourceProcessesPerTick, asUInt);
     AJ(maxFetchRedirections, asUInt);
     AJ(maxFetchRetries, asUInt);
     AJ(fetchFirstRetryTimeOffset, asUInt);
+    AJ(maxTextureResolution, asUInt);
     AJ(measurementUnitsSystem, asUInt);
+    AJ(optimizeMeshes, asBool);
     AJ(debugVirtualSurfaces, asBool);
     AJ(debugSaveCorruptedFiles, asBool);
     AJ(debugValidateGeodataStyles, asBool);
@@ -124,12 +128,16 @@ std::string MapRuntimeOptions::toJson() const
     TJ(renderTilesScale, asDouble);
     TJ(targetResourcesMemoryKB, asUInt);
     TJ(maxConcurrentDownloads, asUInt);
+    TJ(maxHostConcurrentDownloads, asUInt);
+    TJ(adaptiveHostConcurrency, asBool);
     TJ(maxCacheWriteQueueLength, asUInt);
     TJ(maxResourceProcessesPerTick, asUInt);
     TJ(maxFetchRedirections, asUInt);
     TJ(maxFetchRetries, asUInt);
     TJ(fetchFirstRetryTimeOffset, asUInt);
+    TJ(maxTextureResolution, asUInt);
     TJ(measurementUnitsSystem, asUInt);
+    TJ(optimizeMeshes, asBool);
     TJ(debugVirtualSurfaces, asBool);
     TJ(debugSaveCorruptedFiles, asBool);
     TJ(debugValidateGeodataStyles, asBool);
@@ -52,9 +52,31 @@ std::string MapStatistics::toJson() const
     TJ(resourcesQueueUpload, asUint);
     TJ(resourcesQueueAtmosphere, asUint);
     TJ(resourcesAccessed, asUint);
+    TJ(resourcesRevalidated, asUint);
+    TJ(resourcesNotModified, asUint);
+    TJ(revalidationSavedKB, asUint);
     TJ(currentGpuMemUseKB, asUint);
     TJ(currentRamMemUseKB, asUint);
     TJ(renderTicks, asUint);
+    TJ(meshTrianglesOptimized, asUint);
+    TJ(meshCacheMissesOriginal, asUint);
+    TJ(meshCacheMissesOptimized, asUint);
+    for (const HostStatistics &h : hosts)
+    {
+        Json::Value w;
+        w["host"] = h.host;
+        w["bytesDownloaded"] = (Json::UInt64)h.bytesDownloaded;
+        w["downloaded"] = h.downloaded;
+        w["failed"] = h.failed;
+        w["inFlight"] = h.inFlight;
+        w["concurrencyLimit"] = h.concurrencyLimit;
+        w["latencyP50"] = h.latencyP50;
+        w["latencyP90"] = h.latencyP90;
+        w["latencyP99"] = h.latencyP99;
+        w["latencyMin"] = h.latencyMin;
+        w["throughput"] = h.throughput;
+        v["hosts"].append(w);
+    }
     return jsonToString(v);
 }
 
@@ -33,6 +33,7 @@
 #include <map>
 
 #include <vts-libs/registry/referenceframe.hpp>
+#include <vts-libs/vts/nodeinfo.hpp>
 
 #include "include/vts-browser/cameraCredits.hpp"
 #include "include/vts-browser/cameraDraws.hpp"
@@ -48,6 +49,8 @@ namespace vts
 enum class Validity;
 
 class MapImpl;
+class Mapconfig;
+class CoordManip;
 class Camera;
 class TraverseNode;
 class NavigationImpl;
@@ -90,6 +93,25 @@ public:
     std::vector<OldDraw> blendDraws;
 };
 
+// traverse nodes resolved by the altitude queries
+//   shared by all queries within single render tick
+class CameraAltitudeCache
+{
+public:
+    struct Node
+    {
+        TraverseNode *trav = nullptr;
+        uint32 division = 0;
+    };
+
+    std::vector<Node> nodes;
+    std::unordered_map<uint32, TraverseNode *> divisionRoots;
+    TraverseNode *root = nullptr;
+    uint32 tick = (uint32)-1;
+
+    void clear();
+};
+
 class CameraImpl : private Immovable
 {
 public:
@@ -102,6 +124,7 @@ public:
     CameraStatistics statistics;
     std::vector<TileId> gridLoadRequests;
     std::vector<CurrentDraw> currentDraws;
+    CameraAltitudeCache altitudeCache;
     std::unordered_map<TraverseNode*, SubtilesMerger> opaqueSubtiles;
     std::map<std::weak_ptr<MapLayer>, CameraMapLayer, std::owner_less<std::weak_ptr<MapLayer>>> layers;
     // *Actual = corresponds to current camera settings
@@ -163,11 +186,20 @@ public:
     void renderUpdate();
     void suggestedNearFar(double &near_, double &far_);
     bool getSurfaceOverEllipsoid(double &result, const vec3 &navPos, double sampleSize = -1, bool renderDebug = false);
+    // results are nan where the altitude is not available
+    void getSurfaceOverEllipsoid(const vec3 *navPos, double *results, uint32 count, double sampleSize = -1, bool renderDebug = false);
+    TraverseNode *findTravSdsCached(TraverseNode *divisionRoot, uint32 division, const vec2 &pointSds, uint32 maxLod);
     double getSurfaceAltitudeSamples();
 };
 
 void updateNavigation(std::weak_ptr<NavigationImpl> &nav, double elapsedTime);
 
+// altitude query steps shared by cameras and snapshots
+//   divisions are (uint32)-1 for points outside all division nodes
+void altitudeDivisions(const Mapconfig &mapconfig, CoordManip &convertor, const vec3 *navPos, uint32 count, vec3 *sds, uint32 *divisions);
+uint32 altitudeCorners(const vtslibs::vts::NodeInfo &info, const vec2 &pointSds, double sampleSize, vec2 points[4]);
+double altitudeInterpolation(const vec2 &query, const vec2 points[4], double values[4]);
+
 } // namespace vts
 
 #endif
@@ -155,17 +155,6 @@ double quadrilateralSolver(const vec2 &p,
     return nan1(); // the query is outside the quadrilateral
 }
 
-double altitudeInterpolation(
-    const vec2 &query,
-    const vec2 points[4],
-    double values[4])
-{
-    return quadrilateralSolver(query,
-        points[0], points[1], points[2], points[3],
-        values[0], values[1], values[2], values[3]
-    );
-}
-
 TraverseNode *findTravSds(CameraImpl *camera, TraverseNode *where,
         const vec2 &pointSds, uint32 maxLod)
 {
@@ -198,147 +187,284 @@ TraverseNode *findTravSds(CameraImpl *camera, TraverseNode *where,
 
 } // namespace
 
-bool CameraImpl::getSurfaceOverEllipsoid(
-    double &result, const vec3 &navPos,
-    double sampleSize, bool renderDebug)
+void altitudeDivisions(const Mapconfig &mapconfig, CoordManip &convertor,
+    const vec3 *navPos, uint32 count, vec3 *sds, uint32 *divisions)
 {
-    OPTICK_EVENT();
-    assert(map->convertor);
-    assert(!map->layers.empty());
+    for (uint32 i = 0; i < count; i++)
+        divisions[i] = (uint32)-1;
 
-    TraverseNode *root = map->layers[0]->traverseRoot.get();
-    if (!root || !root->meta)
-        return false;
-
-    if (sampleSize <= 0)
-        sampleSize = getSurfaceAltitudeSamples();
-
-    // find surface division coordinates (and appropriate node info)
-    vec2 sds;
-    boost::optional<NodeInfo> info;
+    // all pending points are converted at once for each division node
+    std::vector<uint32> pending(count);
+    for (uint32 i = 0; i < count; i++)
+        pending[i] = i;
+    std::vector<vec3> pendingPos, converted;
     uint32 index = 0;
-    for (const auto &it : map->mapconfig->referenceFrame.division.nodes)
+    for (const auto &it : mapconfig.referenceFrame.division.nodes)
     {
         struct I {
             uint32 &i; I(uint32 &i) : i(i) {} ~I() { ++i; }
         } inc(index);
+        if (pending.empty())
+            break;
         if (it.second.partitioning.mode
                 != vtslibs::registry::PartitioningMode::bisection)
             continue;
-        const NodeInfo &ni
-            = map->mapconfig->referenceDivisionNodeInfos[index];
+        const NodeInfo &ni = mapconfig.referenceDivisionNodeInfos[index];
+        pendingPos.resize(pending.size());
+        converted.resize(pending.size());
+        for (uint32 j = 0; j < pending.size(); j++)
+            pendingPos[j] = navPos[pending[j]];
         try
         {
-            sds = vec3to2(map->convertor->convert(navPos,
-                Srs::Navigation, it.second.srs));
-            if (!ni.inside(vecToUblas<math::Point2>(sds)))
-                continue;
-            info = ni;
-            break;
+            convertor.convert(pendingPos.data(), converted.data(),
+                pending.size(), Srs::Navigation, it.second.srs);
         }
-        catch(const std::exception &)
+        catch (const std::exception &)
         {
-            // do nothing
+            // convert individually to isolate the failing points
+            for (uint32 j = 0; j < pending.size(); j++)
+            {
+                try
+                {
+                    converted[j] = convertor.convert(pendingPos[j],
+                        Srs::Navigation, it.second.srs);
+                }
+                catch (const std::exception &)
+                {
+                    converted[j] = nan3();
+                }
+            }
         }
+        uint32 k = 0;
+        for (uint32 j = 0; j < pending.size(); j++)
+        {
+            const uint32 p = pending[j];
+            const vec2 s = vec3to2(converted[j]);
+            if (!std::isnan(s[0]) && !std::isnan(s[1])
+                && ni.inside(vecToUblas<math::Point2>(s)))
+            {
+                sds[p] = converted[j];
+                divisions[p] = index;
+            }
+            else
+                pending[k++] = p;
+        }
+        pending.resize(k);
     }
-    if (!info)
-        return false;
+}
 
+uint32 altitudeCorners(const NodeInfo &info, const vec2 &pointSds,
+    double sampleSize, vec2 points[4])
+{
     // desired lod
     uint32 desiredLod = std::max(0.0,
-        -std::log2(sampleSize / info->extents().size()));
+        -std::log2(sampleSize / info.extents().size()));
 
     // find corner positions
-    vec2 points[4];
+    NodeInfo i = info;
+    while (i.nodeId().lod < desiredLod)
     {
-        NodeInfo i = *info;
-        while (i.nodeId().lod < desiredLod)
+        for (auto j : vtslibs::vts::children(i.nodeId()))
         {
-            for (auto j : vtslibs::vts::children(i.nodeId()))
-            {
-                NodeInfo k = i.child(j);
-                if (!k.inside(vecToUblas<math::Point2>(sds)))
-                    continue;
-                i = k;
-                break;
-            }
+            NodeInfo k = i.child(j);
+            if (!k.inside(vecToUblas<math::Point2>(pointSds)))
+                continue;
+            i = k;
+            break;
         }
-        math::Extents2 ext = i.extents();
-        vec2 center = vecFromUblas<vec2>(ext.ll + ext.ur) * 0.5;
-        vec2 size = vecFromUblas<vec2>(ext.ur - ext.ll);
-        vec2 p = sds;
-        if (sds(0) < center(0))
-            p(0) -= size(0);
-        if (sds(1) < center(1))
-            p(1) -= size(1);
-        points[0] = p;
-        points[1] = p + vec2(size(0), 0);
-        points[2] = p + vec2(0, size(1));
-        points[3] = p + size;
-        // todo periodicity
     }
+    math::Extents2 ext = i.extents();
+    vec2 center = vecFromUblas<vec2>(ext.ll + ext.ur) * 0.5;
+    vec2 size = vecFromUblas<vec2>(ext.ur - ext.ll);
+    vec2 p = pointSds;
+    if (pointSds(0) < center(0))
+        p(0) -= size(0);
+    if (pointSds(1) < center(1))
+        p(1) -= size(1);
+    points[0] = p;
+    points[1] = p + vec2(size(0), 0);
+    points[2] = p + vec2(0, size(1));
+    points[3] = p + size;
+    // todo periodicity
+    return desiredLod;
+}
+
+double altitudeInterpolation(
+    const vec2 &query,
+    const vec2 points[4],
+    double values[4])
+{
+    return quadrilateralSolver(query,
+        points[0], points[1], points[2], points[3],
+        values[0], values[1], values[2], values[3]
+    );
+}
 
-    // find the actual corners
-    TraverseNode *travRoot = findTravById(root, info->nodeId());
-    if (!travRoot || !travRoot->meta)
+void CameraAltitudeCache::clear()
+{
+    nodes.clear();
+    divisionRoots.clear();
+    root = nullptr;
+    tick = (uint32)-1;
+}
+
+TraverseNode *CameraImpl::findTravSdsCached(TraverseNode *divisionRoot,
+    uint32 division, const vec2 &pointSds, uint32 maxLod)
+{
+    // start the descent at the deepest node resolved by previous queries
+    TraverseNode *start = divisionRoot;
+    math::Point2 ublasSds = vecToUblas<math::Point2>(pointSds);
+    for (const auto &it : altitudeCache.nodes)
+    {
+        if (it.division != division || !it.trav->meta
+            || it.trav->id.lod > maxLod
+            || it.trav->id.lod <= start->id.lod)
+            continue;
+        if (math::inside(it.trav->meta->extents, ublasSds))
+            start = it.trav;
+    }
+    TraverseNode *t = findTravSds(this, start, pointSds, maxLod);
+    if (t != start)
+    {
+        if (altitudeCache.nodes.size() >= 256)
+            altitudeCache.nodes.erase(altitudeCache.nodes.begin());
+        CameraAltitudeCache::Node n;
+        n.trav = t;
+        n.division = division;
+        altitudeCache.nodes.push_back(n);
+    }
+    return t;
+}
+
+bool CameraImpl::getSurfaceOverEllipsoid(
+    double &result, const vec3 &navPos,
+    double sampleSize, bool renderDebug)
+{
+    double res = nan1();
+    getSurfaceOverEllipsoid(&navPos, &res, 1, sampleSize, renderDebug);
+    if (std::isnan(res))
         return false;
-    double altitudes[4];
-    const TraverseNode *nodes[4];
-    for (int i = 0; i < 4; i++)
+    result = res;
+    return true;
+}
+
+void CameraImpl::getSurfaceOverEllipsoid(
+    const vec3 *navPos, double *results, uint32 count,
+    double sampleSize, bool renderDebug)
+{
+    OPTICK_EVENT();
+    assert(map->convertor);
+    assert(!map->layers.empty());
+
+    for (uint32 i = 0; i < count; i++)
+        results[i] = nan1();
+
+    TraverseNode *root = map->layers[0]->traverseRoot.get();
+    if (!root || !root->meta || count == 0)
+        return;
+
+    // resolved nodes are valid until the next traverse clearing
+    if (altitudeCache.tick != map->renderTickIndex
+        || altitudeCache.root != root)
     {
-        auto t = findTravSds(this, travRoot, points[i], desiredLod);
-        if (!t)
-            return false;
-        if (!t->meta->surrogateNav)
-            return false;
-        const math::Extents2 &ext = t->meta->extents;
-        points[i] = vecFromUblas<vec2>(ext.ll + ext.ur) * 0.5;
-        altitudes[i] = *t->meta->surrogateNav;
-        nodes[i] = t;
+        altitudeCache.clear();
+        altitudeCache.tick = map->renderTickIndex;
+        altitudeCache.root = root;
     }
 
-    // interpolate
-    double res = altitudeInterpolation(sds, points, altitudes);
+    if (sampleSize <= 0)
+        sampleSize = getSurfaceAltitudeSamples();
 
-    // debug visualization
-    if (renderDebug)
+    // find surface division coordinates (and appropriate node info)
+    std::vector<vec3> sds(count);
+    std::vector<uint32> divisions(count);
+    altitudeDivisions(*map->mapconfig, *map->convertor,
+        navPos, count, sds.data(), divisions.data());
+
+    for (uint32 q = 0; q < count; q++)
     {
-        RenderInfographicsTask task;
-        task.mesh = map->getMesh("internal://data/meshes/sphere.obj");
-        task.mesh->priority = inf1();
-        if (*task.mesh)
+        if (divisions[q] == (uint32)-1)
+            continue;
+        const uint32 division = divisions[q];
+        const NodeInfo &info
+            = map->mapconfig->referenceDivisionNodeInfos[division];
+        const vec2 pointSds = vec3to2(sds[q]);
+
+        // find corner positions
+        vec2 points[4];
+        uint32 desiredLod = altitudeCorners(info, pointSds,
+            sampleSize, points);
+
+        // find the actual corners
+        auto dr = altitudeCache.divisionRoots.find(division);
+        if (dr == altitudeCache.divisionRoots.end())
+        {
+            dr = altitudeCache.divisionRoots.emplace(division,
+                findTravById(root, info.nodeId())).first;
+        }
+        TraverseNode *travRoot = dr->second;
+        if (!travRoot || !travRoot->meta)
+            continue;
+        double altitudes[4];
+        const TraverseNode *nodes[4];
+        bool valid = true;
+        for (int i = 0; i < 4; i++)
         {
-            float c = std::isnan(res) ? 0.0 : 1.0;
-            task.color = vec4f(c, c, c, 0.7f);
-            double scaleSum = 0;
-            for (int i = 0; i < 4; i++)
+            auto t = findTravSdsCached(travRoot, division,
+                points[i], desiredLod);
+            if (!t || !t->meta->surrogateNav)
             {
-                const TraverseNode *t = nodes[i];
-                double scale = t->meta->extents.size() * 0.035;
-                task.model = translationMatrix(*t->meta->surrogatePhys)
-                        * scaleMatrix(scale);
-                draws.infographics.push_back(convert(task));
-                scaleSum += scale;
+                valid = false;
+                break;
             }
-            if (!std::isnan(res))
+            const math::Extents2 &ext = t->meta->extents;
+            points[i] = vecFromUblas<vec2>(ext.ll + ext.ur) * 0.5;
+            altitudes[i] = *t->meta->surrogateNav;
+            nodes[i] = t;
+        }
+        if (!valid)
+            continue;
+
+        // interpolate
+        double res = altitudeInterpolation(pointSds, points, altitudes);
+
+        // debug visualization
+        if (renderDebug)
+        {
+            RenderInfographicsTask task;
+            task.mesh = map->getMesh("internal://data/meshes/sphere.obj");
+            task.mesh->priority = inf1();
+            if (*task.mesh)
             {
-                vec3 p = navPos;
-                p[2] = res;
-                p = map->convertor->convert(p,
-                    Srs::Navigation, Srs::Physical);
-                task.model = translationMatrix(p)
-                    * scaleMatrix(scaleSum / 4);
-                task.color = vec4f(c, c, c, 1.f);
-                draws.infographics.push_back(convert(task));
+                float c = std::isnan(res) ? 0.0 : 1.0;
+                task.color = vec4f(c, c, c, 0.7f);
+                double scaleSum = 0;
+                for (int i = 0; i < 4; i++)
+                {
+                    const TraverseNode *t = nodes[i];
+                    double scale = t->meta->extents.size() * 0.035;
+                    task.model = translationMatrix(*t->meta->surrogatePhys)
+                            * scaleMatrix(scale);
+                    draws.infographics.push_back(convert(task));
+                    scaleSum += scale;
+                }
+                if (!std::isnan(res))
+                {
+                    vec3 p = navPos[q];
+                    p[2] = res;
+                    p = map->convertor->convert(p,
+                        Srs::Navigation, Srs::Physical);
+                    task.model = translationMatrix(p)
+                        * scaleMatrix(scaleSum / 4);
+                    task.color = vec4f(c, c, c, 1.f);
+                    draws.infographics.push_back(convert(task));
+                }
             }
         }
-    }
 
-    // output
-    if (std::isnan(res))
-        return false;
-    result = res;
-    return true;
+        // output
+        results[q] = res;
+    }
 }
 
 double CameraImpl::getSurfaceAltitudeSamples()
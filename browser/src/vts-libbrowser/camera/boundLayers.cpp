@@ -153,6 +153,7 @@ Validity BoundParamInfo::prepareDepth(CameraImpl *impl, double priority)
     transparent = bound->isTransparent || (!!alpha && *alpha < 1);
 
     textureColor = impl->map->getTexture(bound->urlExtTex(vars));
+    textureColor->allowDownscale = true;
     textureColor->updatePriority(priority);
     textureColor->updateAvailability(bound->availability);
     switch (impl->map->getResourceValidity(textureColor))
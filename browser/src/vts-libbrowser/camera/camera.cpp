@@ -77,6 +77,7 @@ void CameraImpl::clear()
     OPTICK_EVENT();
     draws.clear();
     credits.clear();
+    altitudeCache.clear();
 
     // reset statistics
     {
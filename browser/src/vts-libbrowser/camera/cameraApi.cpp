@@ -122,6 +122,20 @@ void Camera::suggestedNearFar(double &near_, double &far_)
         near_ = far_ = 0;
 }
 
+void Camera::getSurfaceAltitudes(const double *navPoints, double *altitudes, uint32 count, double sampleSize)
+{
+    if (!impl->map->mapconfigReady)
+    {
+        for (uint32 i = 0; i < count; i++)
+            altitudes[i] = nan1();
+        return;
+    }
+    std::vector<vec3> pos(count);
+    for (uint32 i = 0; i < count; i++)
+        pos[i] = rawToVec3(navPoints + i * 3);
+    impl->getSurfaceOverEllipsoid(pos.data(), altitudes, count, sampleSize);
+}
+
 void Camera::renderUpdate()
 {
     impl->renderUpdate();
@@ -0,0 +1,287 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "../include/vts-browser/camera.hpp"
+#include "../include/vts-browser/mapSnapshot.hpp"
+#include "../include/vts-browser/position.hpp"
+
+#include "../camera.hpp"
+#include "../hashTileId.hpp"
+#include "../navigation.hpp"
+#include "../traverseNode.hpp"
+#include "../coordsManip.hpp"
+#include "../mapLayer.hpp"
+#include "../mapConfig.hpp"
+#include "../position.hpp"
+#include "../map.hpp"
+
+#include <optick.h>
+
+namespace vts
+{
+
+using vtslibs::vts::NodeInfo;
+
+class MapSnapshotImpl : private Immovable
+{
+public:
+    // the mapconfig is not modified once decoded,
+    //   a reload creates a new instance (see MapImpl::purgeMapconfig)
+    std::shared_ptr<Mapconfig> mapconfig;
+    std::shared_ptr<CoordManip> convertor; // synchronized
+    // metadata resolved by the traversal, shared with the traverse nodes
+    std::unordered_map<TileId, std::shared_ptr<const MetaNode>> nodes;
+    CameraCredits credits;
+    Position position;
+    mat4 view;
+    mat4 proj;
+    vec3 eye, target, up;
+    double altitudeSamples = 0;
+    uint32 renderTick = 0;
+    uint32 windowWidth = 0;
+    uint32 windowHeight = 0;
+    bool hasPosition = false;
+
+    MapSnapshotImpl(CameraImpl *cam);
+    void collectNodes(TraverseNode *trav);
+    const MetaNode *findNode(const TileId &divisionRoot,
+        const vec2 &pointSds, uint32 maxLod) const;
+    void getSurfaceOverEllipsoid(const vec3 *navPos, double *results,
+        uint32 count, double sampleSize) const;
+};
+
+MapSnapshotImpl::MapSnapshotImpl(CameraImpl *cam)
+{
+    OPTICK_EVENT();
+    MapImpl *map = cam->map;
+    renderTick = map->renderTickIndex;
+    windowWidth = cam->windowWidth;
+    windowHeight = cam->windowHeight;
+    eye = cam->eye;
+    target = cam->target;
+    up = cam->up;
+    view = lookAt(eye, target, up);
+    proj = cam->apiProj;
+    altitudeSamples = cam->getSurfaceAltitudeSamples();
+    credits.imagery = cam->credits.imagery;
+    credits.geodata = cam->credits.geodata;
+
+    if (!map->mapconfigReady)
+        return;
+
+    mapconfig = map->mapconfig;
+    convertor = mapconfig->convertorQuery;
+    auto nav = cam->navigation.lock();
+    if (nav)
+    {
+        position = p2p(nav->getPosition());
+        hasPosition = true;
+    }
+    if (!map->layers.empty())
+        collectNodes(map->layers[0]->traverseRoot.get());
+}
+
+void MapSnapshotImpl::collectNodes(TraverseNode *trav)
+{
+    if (!trav || !trav->meta)
+        return;
+    nodes[trav->id] = trav->meta;
+    for (auto &it : trav->childs)
+        collectNodes(&it);
+}
+
+const MetaNode *MapSnapshotImpl::findNode(const TileId &divisionRoot,
+    const vec2 &pointSds, uint32 maxLod) const
+{
+    auto it = nodes.find(divisionRoot);
+    if (it == nodes.end())
+        return nullptr;
+    const MetaNode *where = it->second.get();
+    math::Point2 ublasSds = vecToUblas<math::Point2>(pointSds);
+    while (where->tileId.lod < maxLod)
+    {
+        const MetaNode *next = nullptr;
+        for (const TileId &c : vtslibs::vts::children(where->tileId))
+        {
+            auto ci = nodes.find(c);
+            if (ci == nodes.end()
+                || !math::inside(ci->second->extents, ublasSds))
+                continue;
+            next = ci->second.get();
+            break;
+        }
+        if (!next)
+            break;
+        where = next;
+    }
+    return where;
+}
+
+void MapSnapshotImpl::getSurfaceOverEllipsoid(const vec3 *navPos,
+    double *results, uint32 count, double sampleSize) const
+{
+    OPTICK_EVENT();
+
+    for (uint32 i = 0; i < count; i++)
+        results[i] = nan1();
+
+    if (!mapconfig || nodes.empty() || count == 0)
+        return;
+
+    if (sampleSize <= 0)
+        sampleSize = altitudeSamples;
+
+    // find surface division coordinates (and appropriate node info)
+    std::vector<vec3> sds(count);
+    std::vector<uint32> divisions(count);
+    altitudeDivisions(*mapconfig, *convertor,
+        navPos, count, sds.data(), divisions.data());
+
+    for (uint32 q = 0; q < count; q++)
+    {
+        if (divisions[q] == (uint32)-1)
+            continue;
+        const NodeInfo &info
+            = mapconfig->referenceDivisionNodeInfos[divisions[q]];
+        const vec2 pointSds = vec3to2(sds[q]);
+
+        // find corner positions
+        vec2 points[4];
+        uint32 desiredLod = altitudeCorners(info, pointSds,
+            sampleSize, points);
+
+        // find the actual corners
+        double altitudes[4];
+        bool valid = true;
+        for (int i = 0; i < 4; i++)
+        {
+            const MetaNode *m = findNode(info.nodeId(),
+                points[i], desiredLod);
+            if (!m || !m->surrogateNav)
+            {
+                valid = false;
+                break;
+            }
+            points[i] = vecFromUblas<vec2>(m->extents.ll + m->extents.ur)
+                * 0.5;
+            altitudes[i] = *m->surrogateNav;
+        }
+        if (!valid)
+            continue;
+
+        // interpolate
+        results[q] = altitudeInterpolation(pointSds, points, altitudes);
+    }
+}
+
+std::shared_ptr<MapSnapshot> Camera::createSnapshot()
+{
+    return std::make_shared<MapSnapshot>(impl.get());
+}
+
+MapSnapshot::MapSnapshot(CameraImpl *cam)
+{
+    assert(cam);
+    impl = std::make_unique<MapSnapshotImpl>(cam);
+}
+
+MapSnapshot::~MapSnapshot()
+{}
+
+uint32 MapSnapshot::renderTick() const
+{
+    return impl->renderTick;
+}
+
+void MapSnapshot::getViewportSize(uint32 &width, uint32 &height) const
+{
+    width = impl->windowWidth;
+    height = impl->windowHeight;
+}
+
+void MapSnapshot::getView(double eye[3], double target[3],
+    double up[3]) const
+{
+    vecToRaw(impl->eye, eye);
+    vecToRaw(impl->target, target);
+    vecToRaw(impl->up, up);
+}
+
+void MapSnapshot::getView(double view[16]) const
+{
+    matToRaw(impl->view, view);
+}
+
+void MapSnapshot::getProj(double proj[16]) const
+{
+    matToRaw(impl->proj, proj);
+}
+
+bool MapSnapshot::getPosition(Position &position) const
+{
+    if (!impl->hasPosition)
+        return false;
+    position = impl->position;
+    return true;
+}
+
+const CameraCredits &MapSnapshot::credits() const
+{
+    return impl->credits;
+}
+
+void MapSnapshot::convert(const double pointFrom[3], double pointTo[3],
+    Srs srsFrom, Srs srsTo) const
+{
+    if (!impl->convertor)
+    {
+        LOGTHROW(err4, std::logic_error) << "Map is not yet available.";
+    }
+    vec3 a = rawToVec3(pointFrom);
+    a = impl->convertor->convert(a, srsFrom, srsTo);
+    vecToRaw(a, pointTo);
+}
+
+void MapSnapshot::convert(const double *pointsFrom, double *pointsTo,
+    uint32 count, Srs srsFrom, Srs srsTo) const
+{
+    if (!impl->convertor)
+    {
+        LOGTHROW(err4, std::logic_error) << "Map is not yet available.";
+    }
+    impl->convertor->convert(pointsFrom, pointsTo, count, srsFrom, srsTo);
+}
+
+void MapSnapshot::getSurfaceAltitudes(const double *navPoints,
+    double *altitudes, uint32 count, double sampleSize) const
+{
+    std::vector<vec3> pos(count);
+    for (uint32 i = 0; i < count; i++)
+        pos[i] = rawToVec3(navPoints + i * 3);
+    impl->getSurfaceOverEllipsoid(pos.data(), altitudes, count, sampleSize);
+}
+
+} // namespace vts
@@ -59,6 +59,7 @@ std::shared_ptr<GpuTexture> CameraImpl::travInternalTexture(TraverseNode *trav,
 {
     UrlTemplate::Vars vars(trav->id, trav->meta->localId, subMeshIndex);
     std::shared_ptr<GpuTexture> res = map->getTexture(trav->surface->urlIntTex(vars));
+    res->allowDownscale = true;
     map->touchResource(res);
     res->updatePriority(trav->priority);
     return res;
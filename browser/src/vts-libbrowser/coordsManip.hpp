@@ -49,7 +49,11 @@ public:
             vtslibs::vts::MapConfig &mapconfig,
             const std::string &searchSrs,
             const std::string &customSrs1,
-            const std::string &customSrs2);
+            const std::string &customSrs2,
+            bool synchronized = false);
+
+    // synchronized manipulators may be shared by multiple threads
+    //   the conversions are serialized by an internal mutex
 
     vec3 navToPhys(const vec3 &value);
     vec3 physToNav(const vec3 &value);
@@ -59,6 +63,14 @@ public:
     vec3 convert(const vec3 &value, const std::string &from, Srs to);
     vec3 convert(const vec3 &value, Srs from, const std::string &to);
 
+    // batch conversions
+    //   the convertor is resolved once for all the points
+    //   values and results may be the same array
+    void convert(const vec3 *values, vec3 *results, std::size_t count, Srs from, Srs to);
+    void convert(const vec3 *values, vec3 *results, std::size_t count, const std::string &from, Srs to);
+    void convert(const vec3 *values, vec3 *results, std::size_t count, Srs from, const std::string &to);
+    void convert(const double *values, double *results, std::size_t count, Srs from, Srs to);
+
     vec3 geoDirect(const vec3 &position, double distance, double azimuthIn, double &azimuthOut);
     vec3 geoDirect(const vec3 &position, double distance, double azimuthIn);
     void geoInverse(const vec3 &posA, const vec3 &posB, double &distance, double &azimuthA, double &azimuthB);
@@ -0,0 +1,91 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef FETCHHOSTS_HPP_qe8w5nz3
+#define FETCHHOSTS_HPP_qe8w5nz3
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "include/vts-browser/mapStatistics.hpp"
+
+namespace vts
+{
+
+// downloads scheduling and statistics for each host
+//   each host has its own limit of concurrent downloads,
+//   optionally adapted to the measured latency
+// accessed from the fetcher thread and the fetcher callbacks
+class FetchHosts : private Immovable
+{
+public:
+    // eg. https://example.com:8080/path -> example.com:8080
+    static std::string hostOf(const std::string &url);
+
+    // hosts that have reached their concurrency limit
+    void saturated(std::vector<std::string> &result,
+        uint32 maxLimit, bool adaptive);
+
+    void started(const std::string &host);
+    void finished(const std::string &host, double latency,
+        uint32 bytes, uint32 code, uint32 maxLimit, bool adaptive);
+
+    void statistics(std::vector<HostStatistics> &result,
+        uint32 maxLimit, bool adaptive);
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Host
+    {
+        Host();
+
+        std::vector<double> latencies; // recent downloads, milliseconds
+        uint32 latenciesNext = 0;
+        double latencyMin;
+        double latencyAvg = 0; // moving average
+        double limit; // fractional, adapted continuously
+        double throughput = 0;
+        Clock::time_point windowStart;
+        uint64 windowBytes = 0;
+        uint64 bytes = 0;
+        uint32 downloaded = 0;
+        uint32 failed = 0;
+        uint32 inFlight = 0;
+    };
+
+    static uint32 limit(const Host &h, uint32 maxLimit, bool adaptive);
+
+    std::unordered_map<std::string, Host> hosts;
+    std::mutex mut;
+};
+
+} // namespace vts
+
+#endif
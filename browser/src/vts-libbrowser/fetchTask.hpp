@@ -29,6 +29,7 @@
 
 #include <memory>
 #include <string>
+#include <chrono>
 
 #include "include/vts-browser/fetcher.hpp"
 
@@ -50,7 +51,17 @@ public:
     MapImpl *const map = nullptr;
     std::shared_ptr<void> availTest; // vtslibs::registry::BoundLayer::Availability
     std::weak_ptr<Resource> resource;
+    std::string host; // of the current url
+    std::chrono::steady_clock::time_point fetchStart;
     uint32 redirectionsCount = 0;
+
+    // content of an expired cache entry
+    //   reused when the server responds with 304 not modified
+    Buffer staleContent;
+    std::string staleEtag;
+    sint64 staleLastModified = -1;
+    bool staleAvailFailed = false;
+    bool revalidating = false;
 };
 
 } // namespace vts
@@ -164,11 +164,13 @@ void Task::done(utility::ResourceFetcher::MultiQuery &&queries)
         }
         else
         {
-            task->reply.content.allocate(body.data.size());
-            memcpy(task->reply.content.data(), body.data.data(),
-                   body.data.size());
+            // the queries are owned by this callback,
+            //   the body is moved into the reply instead of copying it
+            task->reply.content = Buffer::adopt(std::move(
+                const_cast<std::string &>(body.data)));
             task->reply.contentType = body.contentType;
             task->reply.expires = body.expires;
+            task->reply.lastModified = body.lastModified;
             task->reply.code = 200;
 
             // testing start
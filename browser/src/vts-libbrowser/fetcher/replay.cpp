@@ -0,0 +1,388 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "../include/vts-browser/fetcher.hpp"
+
+#include <dbglog/dbglog.hpp>
+
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <sstream>
+#include <unordered_map>
+#include <cstring>
+
+namespace vts
+{
+
+namespace
+{
+
+// archive layout (native endianness):
+//   magic
+//   records until the end of file:
+//     string url, uint32 resourceType
+//     uint32 headers count, pairs of strings
+//     uint32 code, string contentType, string redirectUrl
+//     sint64 expires, double duration (milliseconds)
+//     uint32 content size, content
+// string = uint32 length, characters
+const char ArchiveMagic[8] = { 'v', 't', 's', 'f', 'r', 'e', 'c', '1' };
+
+typedef std::chrono::steady_clock Clock;
+
+struct Record
+{
+    std::string url;
+    std::map<std::string, std::string> headers;
+    uint32 resourceType = 0;
+    uint32 code = 0;
+    std::string contentType;
+    std::string redirectUrl;
+    sint64 expires = -1;
+    double duration = 0;
+    Buffer content;
+};
+
+void writeRaw(std::ostream &out, const void *data, std::size_t size)
+{
+    out.write((const char *)data, size);
+}
+
+template<class T>
+void writeValue(std::ostream &out, T value)
+{
+    writeRaw(out, &value, sizeof(T));
+}
+
+void writeString(std::ostream &out, const std::string &str)
+{
+    writeValue<uint32>(out, str.size());
+    writeRaw(out, str.data(), str.size());
+}
+
+void readRaw(std::istream &in, void *data, std::size_t size)
+{
+    in.read((char *)data, size);
+    if (!in)
+        LOGTHROW(info1, std::runtime_error) << "Truncated fetcher archive";
+}
+
+template<class T>
+T readValue(std::istream &in)
+{
+    T value;
+    readRaw(in, &value, sizeof(T));
+    return value;
+}
+
+std::string readString(std::istream &in)
+{
+    std::string str(readValue<uint32>(in), '\0');
+    if (!str.empty())
+        readRaw(in, &str[0], str.size());
+    return str;
+}
+
+void writeRecord(std::ostream &out, const FetchTask &task, double duration)
+{
+    writeString(out, task.query.url);
+    writeValue<uint32>(out, (uint32)task.query.resourceType);
+    writeValue<uint32>(out, task.query.headers.size());
+    for (const auto &it : task.query.headers)
+    {
+        writeString(out, it.first);
+        writeString(out, it.second);
+    }
+    writeValue<uint32>(out, task.reply.code);
+    writeString(out, task.reply.contentType);
+    writeString(out, task.reply.redirectUrl);
+    writeValue<sint64>(out, task.reply.expires);
+    writeValue<double>(out, duration);
+    writeValue<uint32>(out, task.reply.content.size());
+    writeRaw(out, task.reply.content.data(), task.reply.content.size());
+}
+
+bool readRecord(std::istream &in, Record &r)
+{
+    if (in.peek() == std::char_traits<char>::eof())
+        return false;
+    r.url = readString(in);
+    r.resourceType = readValue<uint32>(in);
+    uint32 headers = readValue<uint32>(in);
+    r.headers.clear();
+    for (uint32 i = 0; i < headers; i++)
+    {
+        std::string k = readString(in);
+        r.headers[k] = readString(in);
+    }
+    r.code = readValue<uint32>(in);
+    r.contentType = readString(in);
+    r.redirectUrl = readString(in);
+    r.expires = readValue<sint64>(in);
+    r.duration = readValue<double>(in);
+    r.content.allocate(readValue<uint32>(in));
+    readRaw(in, r.content.data(), r.content.size());
+    return true;
+}
+
+class RecordingFetcher;
+
+// intercepts the reply on its way to the original task
+class RecordingTask : public FetchTask
+{
+public:
+    RecordingTask(RecordingFetcher *fetcher,
+        const std::shared_ptr<FetchTask> &task) :
+        FetchTask(task->query), begin(Clock::now()),
+        fetcher(fetcher), task(task)
+    {}
+
+    void fetchDone() override;
+
+    const Clock::time_point begin;
+    RecordingFetcher *const fetcher;
+    const std::shared_ptr<FetchTask> task;
+};
+
+class RecordingFetcher : public Fetcher
+{
+public:
+    RecordingFetcher(const std::shared_ptr<Fetcher> &fetcher,
+        const std::string &archivePath) :
+        fetcher(fetcher),
+        out(archivePath, std::ios::binary | std::ios::trunc)
+    {
+        if (!fetcher)
+            LOGTHROW(err4, std::invalid_argument)
+                << "Recording fetcher needs a fetcher to record";
+        if (!out)
+            LOGTHROW(err4, std::runtime_error)
+                << "Failed to open fetcher archive <" << archivePath << ">";
+        writeRaw(out, ArchiveMagic, sizeof(ArchiveMagic));
+    }
+
+    void initialize() override
+    {
+        fetcher->initialize();
+    }
+
+    void finalize() override
+    {
+        fetcher->finalize();
+        std::lock_guard<std::mutex> lock(mut);
+        out.flush();
+    }
+
+    void update() override
+    {
+        fetcher->update();
+    }
+
+    void fetch(const std::shared_ptr<FetchTask> &task) override
+    {
+        fetcher->fetch(std::make_shared<RecordingTask>(this, task));
+    }
+
+    // called from the threads of the wrapped fetcher
+    void record(const FetchTask &task, double duration)
+    {
+        // serialize the record outside of the lock
+        //   and write it whole, so that an interrupted recording
+        //   ends with complete records
+        std::ostringstream ss(std::ios::binary);
+        writeRecord(ss, task, duration);
+        const std::string data = ss.str();
+        std::lock_guard<std::mutex> lock(mut);
+        writeRaw(out, data.data(), data.size());
+        out.flush();
+    }
+
+private:
+    const std::shared_ptr<Fetcher> fetcher;
+    std::mutex mut;
+    std::ofstream out;
+};
+
+void RecordingTask::fetchDone()
+{
+    double duration = std::chrono::duration<double, std::milli>(
+        Clock::now() - begin).count();
+    fetcher->record(*this, duration);
+    task->reply = std::move(reply);
+    task->fetchDone();
+}
+
+class ReplayFetcher : public Fetcher
+{
+public:
+    ReplayFetcher(const std::string &archivePath,
+        const FetcherReplayOptions &options) :
+        options(options), random(options.seed)
+    {
+        std::ifstream in(archivePath, std::ios::binary);
+        if (!in)
+            LOGTHROW(err4, std::runtime_error)
+                << "Failed to open fetcher archive <" << archivePath << ">";
+        char magic[sizeof(ArchiveMagic)];
+        readRaw(in, magic, sizeof(magic));
+        if (memcmp(magic, ArchiveMagic, sizeof(magic)) != 0)
+            LOGTHROW(err4, std::runtime_error)
+                << "Invalid fetcher archive <" << archivePath << ">";
+        Record r;
+        while (true)
+        {
+            try
+            {
+                if (!readRecord(in, r))
+                    break;
+            }
+            catch (const std::runtime_error &)
+            {
+                // eg. the recording was interrupted
+                LOG(warn3) << "Fetcher archive <" << archivePath
+                    << "> ends with an incomplete record, ignoring it";
+                break;
+            }
+            // the latest record of each url wins
+            std::string url = r.url;
+            records[url] = std::make_shared<Record>(std::move(r));
+            r = Record();
+        }
+        LOG(info2) << "Loaded " << records.size()
+            << " records from fetcher archive <" << archivePath << ">";
+    }
+
+    // both fetch and update are called from the fetcher thread
+    void fetch(const std::shared_ptr<FetchTask> &task) override
+    {
+        Pending p;
+        p.task = task;
+        p.order = order++;
+        auto it = records.find(task->query.url);
+        double delay = options.latency;
+        if (options.latencyJitter > 0)
+            delay += std::uniform_real_distribution<double>(
+                0, options.latencyJitter)(random);
+        if (it != records.end())
+        {
+            p.record = it->second;
+            delay += p.record->duration * options.durationScale;
+            if (options.bandwidth > 0)
+                delay += p.record->content.size() * 1000.0
+                    / options.bandwidth;
+        }
+        p.error = options.errorRate > 0
+            && std::uniform_real_distribution<double>(0, 1)(random)
+            < options.errorRate;
+        p.due = Clock::now() + std::chrono::microseconds(
+            (sint64)(delay * 1000));
+        pending.push(p);
+    }
+
+    void update() override
+    {
+        const Clock::time_point now = Clock::now();
+        while (!pending.empty() && pending.top().due <= now)
+        {
+            Pending p = pending.top();
+            pending.pop();
+            respond(p);
+            p.task->fetchDone();
+        }
+    }
+
+    void finalize() override
+    {
+        while (!pending.empty())
+            pending.pop();
+    }
+
+private:
+    struct Pending
+    {
+        Clock::time_point due;
+        uint64 order = 0;
+        std::shared_ptr<FetchTask> task;
+        std::shared_ptr<const Record> record;
+        bool error = false;
+
+        // earliest first, ties in the order of requests
+        bool operator < (const Pending &other) const
+        {
+            if (due != other.due)
+                return due > other.due;
+            return order > other.order;
+        }
+    };
+
+    void respond(Pending &p)
+    {
+        FetchTask::Reply &reply = p.task->reply;
+        if (p.error)
+        {
+            reply.code = FetchTask::ExtraCodes::SimulatedError;
+            return;
+        }
+        if (!p.record)
+        {
+            LOG(warn2) << "Url <" << p.task->query.url
+                << "> is missing in the fetcher archive";
+            reply.code = 404;
+            return;
+        }
+        const Record &r = *p.record;
+        reply.code = r.code;
+        reply.contentType = r.contentType;
+        reply.redirectUrl = r.redirectUrl;
+        reply.expires = r.expires;
+        reply.content = r.content.copy();
+    }
+
+    const FetcherReplayOptions options;
+    std::unordered_map<std::string, std::shared_ptr<const Record>> records;
+    std::priority_queue<Pending> pending;
+    std::mt19937 random;
+    uint64 order = 0;
+};
+
+} // namespace
+
+std::shared_ptr<Fetcher> Fetcher::createRecording(
+    const std::shared_ptr<Fetcher> &fetcher, const std::string &archivePath)
+{
+    return std::make_shared<RecordingFetcher>(fetcher, archivePath);
+}
+
+std::shared_ptr<Fetcher> Fetcher::createReplay(
+    const std::string &archivePath, const FetcherReplayOptions &options)
+{
+    return std::make_shared<ReplayFetcher>(archivePath, options);
+}
+
+} // namespace vts
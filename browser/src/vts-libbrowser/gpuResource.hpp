@@ -32,6 +32,7 @@
 
 #include <boost/container/small_vector.hpp>
 #include <vector>
+#include <atomic>
 
 namespace vtslibs { namespace vts {
 struct SubMesh;
@@ -63,6 +64,9 @@ public:
     GpuTextureSpec::FilterMode filterMode = GpuTextureSpec::FilterMode::Linear;
     GpuTextureSpec::WrapMode wrapMode = GpuTextureSpec::WrapMode::ClampToEdge;
     uint32 width = 0, height = 0;
+    // see MapRuntimeOptions::maxTextureResolution
+    // set from the render thread and read in the decode thread
+    std::atomic<bool> allowDownscale{ false };
 };
 
 class GpuAtmosphereDensityTexture : public GpuTexture
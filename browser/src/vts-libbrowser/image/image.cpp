@@ -35,7 +35,8 @@ namespace vts
 {
 
 void decodeImage(const Buffer &in, Buffer &out,
-                 uint32 &width, uint32 &height, uint32 &components)
+                 uint32 &width, uint32 &height, uint32 &components,
+                 const ImageDecodeOptions &options)
 {
     if (in.size() < 8)
         LOGTHROW(err1, std::runtime_error) << "insufficient image data";
@@ -46,12 +47,12 @@ void decodeImage(const Buffer &in, Buffer &out,
     if (memcmp(in.data(), pngSignature, sizeof(pngSignature)) == 0)
     {
         OPTICK_EVENT("decode png");
-        decodePng(in, out, width, height, components);
+        decodePng(in, out, width, height, components, options);
     }
     else if (memcmp(in.data(), jpegSignature, sizeof(jpegSignature)) == 0)
     {
         OPTICK_EVENT("decode jpeg");
-        decodeJpeg(in, out, width, height, components);
+        decodeJpeg(in, out, width, height, components, options);
     }
     else
     {
@@ -61,7 +62,16 @@ void decodeImage(const Buffer &in, Buffer &out,
         width = height = std::sqrt(in.size() / components);
         if (in.size() != width * height * components)
             LOGTHROW(err1, std::runtime_error) << "Raw image is not square";
-        out = in.copy();
+        if (options.verticalFlip)
+        {
+            uint32 lineSize = width * components;
+            out.allocate(in.size());
+            for (uint32 y = 0; y < height; y++)
+                memcpy(out.data() + (height - y - 1) * lineSize,
+                       in.data() + y * lineSize, lineSize);
+        }
+        else
+            out = in.copy();
     }
 }
 
@@ -32,14 +32,28 @@
 namespace vts
 {
 
+struct ImageDecodeOptions
+{
+    // zero keeps the original resolution
+    // otherwise jpeg images are downscaled (by powers of two, up to 1/8)
+    //   during the decompression to fit into this resolution
+    uint32 maxResolution = 0;
+
+    // store the rows bottom-up (as expected by opengl)
+    bool verticalFlip = false;
+};
+
 void decodePng(const Buffer &in, Buffer &out,
-               uint32 &width, uint32 &height, uint32 &components);
+               uint32 &width, uint32 &height, uint32 &components,
+               const ImageDecodeOptions &options = ImageDecodeOptions());
 
 void decodeJpeg(const Buffer &in, Buffer &out,
-                uint32 &width, uint32 &height, uint32 &components);
+                uint32 &width, uint32 &height, uint32 &components,
+                const ImageDecodeOptions &options = ImageDecodeOptions());
 
 void decodeImage(const Buffer &in, Buffer &out,
-                 uint32 &width, uint32 &height, uint32 &components);
+                 uint32 &width, uint32 &height, uint32 &components,
+                 const ImageDecodeOptions &options = ImageDecodeOptions());
 
 void encodePng(const Buffer &in, Buffer &out,
                uint32 width, uint32 height, uint32 components);
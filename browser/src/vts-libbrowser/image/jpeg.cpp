@@ -24,8 +24,10 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
-#include "../include/vts-browser/buffer.hpp"
+#include "image.hpp"
 
+#include <vector>
+#include <algorithm>
 #include <stdio.h> // needed for jpeglib
 #include <jpeglib.h>
 #include <dbglog/dbglog.hpp>
@@ -45,39 +47,74 @@ void jpegErrFunc(j_common_ptr cinfo)
             << jpegLastErrorMsg << ">";
 }
 
+// the decompressor is reused by all images decoded in the thread
+struct JpegDecoder
+{
+    jpeg_decompress_struct info;
+    jpeg_error_mgr errmgr;
+    std::vector<JSAMPROW> rows;
+
+    JpegDecoder()
+    {
+        info.err = jpeg_std_error(&errmgr);
+        errmgr.error_exit = &jpegErrFunc;
+        jpeg_create_decompress(&info);
+    }
+
+    ~JpegDecoder()
+    {
+        jpeg_destroy_decompress(&info);
+    }
+};
+
 } // namespace
 
 void decodeJpeg(const Buffer &in, Buffer &out,
-                uint32 &width, uint32 &height, uint32 &components)
+                uint32 &width, uint32 &height, uint32 &components,
+                const ImageDecodeOptions &options)
 {
-    jpeg_decompress_struct info;
-    jpeg_error_mgr errmgr;
-    info.err = jpeg_std_error(&errmgr);
-    errmgr.error_exit = &jpegErrFunc;
+    thread_local JpegDecoder decoder;
+    jpeg_decompress_struct &info = decoder.info;
     try
     {
-        jpeg_create_decompress(&info);
         jpeg_mem_src(&info, (unsigned char*)in.data(), in.size());
         jpeg_read_header(&info, TRUE);
+        if (options.maxResolution)
+        {
+            // downscale in the dct domain
+            uint32 denom = 1;
+            uint32 size = std::max(info.image_width, info.image_height);
+            while (denom < 8 && size > options.maxResolution * denom)
+                denom *= 2;
+            info.scale_num = 1;
+            info.scale_denom = denom;
+        }
         jpeg_start_decompress(&info);
         width = info.output_width;
         height = info.output_height;
-        components = info.num_components;
+        components = info.output_components;
         uint32 lineSize = components * width;
         out = Buffer(lineSize * height);
+
+        // the rows are written directly in their final order
+        std::vector<JSAMPROW> &rows = decoder.rows;
+        rows.resize(height);
+        for (uint32 y = 0; y < height; y++)
+        {
+            rows[y] = (JSAMPROW)out.data() + lineSize
+                * (options.verticalFlip ? height - y - 1 : y);
+        }
         while (info.output_scanline < info.output_height)
         {
-            unsigned char *ptr[1];
-            ptr[0] = (unsigned char*)out.data()
-                    + lineSize * info.output_scanline;
-            jpeg_read_scanlines(&info, ptr, 1);
+            jpeg_read_scanlines(&info, rows.data() + info.output_scanline,
+                info.output_height - info.output_scanline);
         }
         jpeg_finish_decompress(&info);
-        jpeg_destroy_decompress(&info);
     }
     catch (...)
     {
-        jpeg_destroy_decompress(&info);
+        // keeps the decompressor usable for next image
+        jpeg_abort_decompress(&info);
         throw;
     }
 }
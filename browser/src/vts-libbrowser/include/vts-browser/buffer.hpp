@@ -29,6 +29,7 @@
 
 #include <iostream>
 #include <string>
+#include <functional>
 
 #include "foundation.hpp"
 
@@ -54,6 +55,15 @@ public:
     // explicitly create a copy
     Buffer copy() const;
 
+    // takes ownership of memory allocated elsewhere, without copying
+    //   the deleter is called with the data instead of free
+    //   the memory must stay writable
+    static Buffer adopt(char *data, uint32 size, std::function<void(char *)> deleter);
+
+    // takes ownership of the string storage, without copying
+    //   (except for strings small enough to be stored inline)
+    static Buffer adopt(std::string &&str);
+
     // explicitly create string out of the buffer
     std::string str() const;
 
@@ -80,6 +90,7 @@ public:
 private:
     char *data_;
     uint32 size_;
+    std::function<void(char *)> deleter_; // empty for malloc-ed data
 };
 
 VTS_API void writeLocalFileBuffer(const std::string &path, const Buffer &buffer);
@@ -47,6 +47,7 @@ VTS_API void vtsCameraGetView(vtsHCamera cam, double eye[3], double target[3], d
 VTS_API void vtsCameraGetViewMatrix(vtsHCamera cam, double view[16]);
 VTS_API void vtsCameraGetProjMatrix(vtsHCamera cam, double proj[16]);
 VTS_API void vtsCameraSuggestedNearFar(vtsHCamera cam, double *near_, double *far_);
+VTS_API void vtsCameraGetSurfaceAltitudes(vtsHCamera cam, const double *navPoints, double *altitudes, uint32 count, double sampleSize);
 VTS_API void vtsCameraRenderUpdate(vtsHCamera cam);
 
 // credits
@@ -43,6 +43,7 @@ class CameraStatistics;
 class Map;
 class Navigation;
 class CameraImpl;
+class MapSnapshot;
 
 class VTS_API Camera : private Immovable
 {
@@ -64,8 +65,20 @@ public:
 
     void suggestedNearFar(double &near_, double &far_);
 
+    // surface altitudes (above ellipsoid) at navigation srs positions
+    //   positions are stored consecutively as x, y, z triplets
+    //   uses only the data that are already loaded
+    //   results are nan where the altitude is not available
+    //   sampleSize (in physical srs units) selects the level of detail,
+    //     non-positive value derives it from the current view
+    void getSurfaceAltitudes(const double *navPoints, double *altitudes, uint32 count, double sampleSize = -1);
+
     void renderUpdate();
 
+    // immutable copy of the current state for queries from other threads
+    //   call it after renderUpdate, on the rendering thread
+    std::shared_ptr<MapSnapshot> createSnapshot();
+
     CameraCredits &credits();
     CameraDraws &draws();
     CameraOptions &options();
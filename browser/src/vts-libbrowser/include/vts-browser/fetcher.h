@@ -34,6 +34,8 @@ extern "C" {
 #endif
 
 VTS_API vtsHFetcher vtsFetcherCreateDefault(const char *createOptions);
+VTS_API vtsHFetcher vtsFetcherCreateRecording(vtsHFetcher fetcher, const char *archivePath);
+VTS_API vtsHFetcher vtsFetcherCreateReplay(const char *archivePath);
 VTS_API void vtsFetcherDestroy(vtsHFetcher fetcher);
 
 // custom fetcher is not yet available in the C API
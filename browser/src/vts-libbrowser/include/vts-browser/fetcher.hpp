@@ -95,6 +95,11 @@ public:
         //   -2 = always revalidate
         sint64 expires = -1;
 
+        // validators used to revalidate expired cache entries
+        //   lastModified is absolute time in seconds, -1 = unknown
+        std::string etag;
+        sint64 lastModified = -1;
+
         // http status code, or one of the ExtraCodes
         uint32 code = 0;
     };
@@ -138,11 +143,43 @@ public:
     sint32 pipelining = 2;
 };
 
+class VTS_API FetcherReplayOptions
+{
+public:
+    // multiplies the recorded duration of each download
+    //   1 = reproduce the recorded timing, 0 = ignore it
+    double durationScale = 1;
+
+    // milliseconds added to each download
+    double latency = 0;
+
+    // maximum random milliseconds added to each download
+    double latencyJitter = 0;
+
+    // bytes per second, delays each download by its size
+    //   0 = unlimited
+    double bandwidth = 0;
+
+    // probability of replacing a reply with SimulatedError
+    double errorRate = 0;
+
+    // seed for the jitter and the errors
+    uint32 seed = 0;
+};
+
 class VTS_API Fetcher : private Immovable
 {
 public:
     static std::shared_ptr<Fetcher> create(const FetcherOptions &options);
 
+    // wraps another fetcher and stores all the downloads into an archive
+    //   including the request headers, which may contain credentials
+    static std::shared_ptr<Fetcher> createRecording(const std::shared_ptr<Fetcher> &fetcher, const std::string &archivePath);
+
+    // serves the downloads stored in an archive, without network access
+    //   urls missing in the archive are replied with 404
+    static std::shared_ptr<Fetcher> createReplay(const std::string &archivePath, const FetcherReplayOptions &options = {});
+
     virtual ~Fetcher();
     virtual void initialize();
     virtual void finalize();
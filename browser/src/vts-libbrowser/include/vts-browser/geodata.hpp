@@ -199,6 +199,9 @@ public:
     UnionData unionData;
     CommonData commonData;
     Type type;
+
+    // data prepared by the decodeGeodata callback
+    std::shared_ptr<void> userData;
 };
 
 } // namespace vts
@@ -71,6 +71,8 @@ VTS_API void vtsMapSetOptions(vtsHMap map, const char *options);
 
 // conversion
 VTS_API void vtsMapConvert(vtsHMap map, const double pointFrom[3], double pointTo[3], uint32 srsFrom, uint32 SrsTo);
+VTS_API bool vtsMapGetTerrainAltitudes(vtsHMap map, const double *navPoints, double *altitudes, uint32 count, double resolution);
+VTS_API void vtsMapConvertArray(vtsHMap map, const double *pointsFrom, double *pointsTo, uint32 count, uint32 srsFrom, uint32 srsTo);
 
 // map view functionality is not yet available in the C API
 
@@ -119,6 +119,17 @@ public:
     // srs conversion
     void convert(const double pointFrom[3], double pointTo[3], Srs srsFrom, Srs srsTo) const;
     void convert(const std::array<double, 3> &pointFrom, double pointTo[3], Srs srsFrom, Srs srsTo) const;
+    // converts count points stored consecutively as x, y, z triplets
+    void convert(const double *pointsFrom, double *pointsTo, uint32 count, Srs srsFrom, Srs srsTo) const;
+
+    // terrain altitudes (in navigation srs) at navigation srs positions
+    //   independent of the cameras, the data are downloaded on demand
+    //   positions are stored consecutively as x, y, z triplets
+    //   resolution is the desired spacing of the terrain samples
+    //   returns false while the data are loading,
+    //     call it again later (eg. next frame) with the same arguments
+    //   results are nan where the terrain is not available
+    bool getTerrainAltitudes(const double *navPoints, double *altitudes, uint32 count, double resolution);
 
     // surfaces and layers resources
     std::vector<std::string> getResourceSurfaces() const;
@@ -41,6 +41,11 @@ public:
     // invoked from Map::dataTick()
     std::function<void(class ResourceInfo &, class GpuTextureSpec &, const std::string &id)> loadTexture;
 
+    // optional function callback to prepare a texture for the upload
+    // invoked from the decode thread, before loadTexture
+    // it may generate mipmaps, compress the texture, etc.
+    std::function<void(class GpuTextureSpec &, const std::string &id)> decodeTexture;
+
     // function callback to upload a mesh to gpu
     // invoked from Map::dataTick()
     std::function<void(class ResourceInfo &, class GpuMeshSpec &, const std::string &id)> loadMesh;
@@ -53,6 +58,12 @@ public:
     // invoked from Map::dataTick()
     std::function<void(class ResourceInfo &, class GpuGeodataSpec &, const std::string &id)> loadGeodata;
 
+    // optional function callback to prepare geodata for the upload
+    // invoked from the decode thread, before loadGeodata
+    // it may do the cpu heavy work (buffers, texts layout, etc.)
+    //   and store the results in GpuGeodataSpec::userData
+    std::function<void(class GpuGeodataSpec &, const std::string &id)> decodeGeodata;
+
     // function callback when the mapconfig is downloaded
     // invoked from Map::renderTick()
     // suitable to change view, position, etc.
@@ -110,6 +110,14 @@ public:
     // maximum size of the queue for the resources to be downloaded
     uint32 maxConcurrentDownloads = 25;
 
+    // maximum number of concurrent downloads from single host
+    //   slow hosts do not take the downloads from the fast ones
+    uint32 maxHostConcurrentDownloads = 12;
+
+    // adapt the concurrency limit of each host to its measured latency
+    //   otherwise each host uses the maximum
+    bool adaptiveHostConcurrency = true;
+
     // maximum number of items waiting in queue to be written to disk cache
     // new resources will be skipped when the queue is full
     uint32 maxCacheWriteQueueLength = 500;
@@ -128,6 +136,12 @@ public:
     // each subsequent retry is delayed twice as long as before
     uint32 fetchFirstRetryTimeOffset = 1;
 
+    // surface textures larger than this are downscaled while decoding
+    //   (jpeg only, by powers of two, up to 1/8)
+    // useful on low memory devices or with coarse targetPixelRatioSurfaces
+    // zero keeps the full resolution
+    uint32 maxTextureResolution = 0;
+
     // 0 = US customary units
     // 1 = metric
     // when new instance of this structure is created,
@@ -135,6 +149,10 @@ public:
     //   from the environment locale settings
     uint32 measurementUnitsSystem;
 
+    // reorder triangles and vertices of surface meshes while decoding
+    //   to improve the gpu vertex cache utilization
+    bool optimizeMeshes = true;
+
     bool debugVirtualSurfaces = true;
     bool debugSaveCorruptedFiles = false;
     bool debugValidateGeodataStyles = false;
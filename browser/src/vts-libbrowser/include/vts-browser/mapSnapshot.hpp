@@ -0,0 +1,82 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MAP_SNAPSHOT_HPP_kd7g2wqz
+#define MAP_SNAPSHOT_HPP_kd7g2wqz
+
+#include <memory>
+
+#include "foundation.hpp"
+
+namespace vts
+{
+
+class CameraImpl;
+class CameraCredits;
+class Position;
+class MapSnapshotImpl;
+
+// immutable copy of the camera state at the time of its creation
+//   create it on the rendering thread (see Camera::createSnapshot)
+//   all the query methods may be used from any thread,
+//     concurrently with the rendering
+class VTS_API MapSnapshot : private Immovable
+{
+public:
+    explicit MapSnapshot(CameraImpl *cam);
+    ~MapSnapshot();
+
+    // render tick at which the snapshot was taken
+    uint32 renderTick() const;
+
+    void getViewportSize(uint32 &width, uint32 &height) const;
+    void getView(double eye[3], double target[3], double up[3]) const;
+    void getView(double view[16]) const;
+    void getProj(double proj[16]) const;
+
+    // returns false if the camera had no navigation
+    bool getPosition(Position &position) const;
+
+    const CameraCredits &credits() const;
+
+    // srs conversion
+    void convert(const double pointFrom[3], double pointTo[3], Srs srsFrom, Srs srsTo) const;
+    // converts count points stored consecutively as x, y, z triplets
+    void convert(const double *pointsFrom, double *pointsTo, uint32 count, Srs srsFrom, Srs srsTo) const;
+
+    // surface altitudes (above ellipsoid) at navigation srs positions
+    //   uses only the metadata resolved by the traversal at the time of the snapshot
+    //   results are nan where the altitude is not available
+    //   non-positive sampleSize derives it from the snapshot view
+    void getSurfaceAltitudes(const double *navPoints, double *altitudes, uint32 count, double sampleSize = -1) const;
+
+private:
+    std::unique_ptr<MapSnapshotImpl> impl;
+};
+
+} // namespace vts
+
+#endif
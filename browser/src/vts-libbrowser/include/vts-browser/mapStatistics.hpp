@@ -28,12 +28,32 @@
 #define MAP_STATISTICS_HPP_wqieufhbvgjh
 
 #include <string>
+#include <vector>
 
 #include "foundation.hpp"
 
 namespace vts
 {
 
+class VTS_API HostStatistics
+{
+public:
+    std::string host; // including port
+    uint64 bytesDownloaded = 0;
+    uint32 downloaded = 0;
+    uint32 failed = 0;
+    uint32 inFlight = 0;
+    // current limit of concurrent downloads from the host
+    uint32 concurrencyLimit = 0;
+    // of recent downloads, in milliseconds
+    double latencyP50 = 0;
+    double latencyP90 = 0;
+    double latencyP99 = 0;
+    double latencyMin = 0;
+    // bytes per second, moving average
+    double throughput = 0;
+};
+
 class VTS_API MapStatistics
 {
 public:
@@ -59,10 +79,25 @@ public:
     uint32 resourcesQueueAtmosphere = 0;
     uint32 resourcesAccessed = 0;
 
+    // expired cache entries requested with conditional headers
+    //   and those confirmed by the server as not modified
+    uint32 resourcesRevalidated = 0;
+    uint32 resourcesNotModified = 0;
+    uint32 revalidationSavedKB = 0;
+
     uint32 currentGpuMemUseKB = 0;
     uint32 currentRamMemUseKB = 0;
 
     uint32 renderTicks = 0;
+
+    // simulated vertex cache misses of the optimized meshes
+    // acmr (average cache miss ratio) = misses / triangles
+    uint32 meshTrianglesOptimized = 0;
+    uint32 meshCacheMissesOriginal = 0;
+    uint32 meshCacheMissesOptimized = 0;
+
+    // downloads per host, updated every render tick
+    std::vector<HostStatistics> hosts;
 };
 
 } // namespace vts
@@ -28,6 +28,7 @@
 #define RESOURCES_HPP_jhsegfshg
 
 #include <array>
+#include <vector>
 #include <memory>
 
 #include "buffer.hpp"
@@ -69,7 +70,12 @@ class VTS_API GpuTextureSpec
 {
 public:
     GpuTextureSpec() = default;
-    explicit GpuTextureSpec(const Buffer &buffer); // decode jpg or png file
+    // decode jpg or png file
+    // verticalFlip stores the rows bottom-up (without a separate pass)
+    // non-zero maxResolution downscales jpeg images while decoding
+    //   (see MapRuntimeOptions::maxTextureResolution)
+    explicit GpuTextureSpec(const Buffer &buffer, bool verticalFlip = false,
+                            uint32 maxResolution = 0);
     void verticalFlip();
 
     // image resolution
@@ -83,6 +89,7 @@ public:
 
     // enforce texture internal format, leave zero to deduce the format from type and components
     // the type must still be set appropriately since it defines buffer size
+    // a compressed format means that the buffer and the mipmaps contain the compressed blocks
     uint32 internalFormat = 0;
 
     // raw texture data
@@ -90,6 +97,10 @@ public:
     // the rows are in no way aligned to multi-byte boundaries (GL_UNPACK_ALIGNMENT = 1)
     Buffer buffer;
 
+    // optional precomputed mipmap levels 1, 2, ... (each half the size of the previous one)
+    // leave empty to let the renderer generate the mipmaps
+    std::vector<Buffer> mipmaps;
+
     // expected size based on width * height * components * gpuTypeSize(type)
     uint32 expectedSize() const;
 
@@ -147,6 +158,15 @@ public:
     GpuMeshSpec() = default;
     explicit GpuMeshSpec(const Buffer &buffer); // decode obj file
 
+    // reorders the triangles for the post-transform vertex cache
+    //   and the vertices in the order of their first use
+    // only indexed triangle lists are modified
+    void optimize();
+
+    // simulated average cache miss ratio (vertices per triangle)
+    // zero for meshes without indices
+    double vertexCacheMissRatio() const;
+
     // an array of vertex data
     // the interpretation of the data is defined by the 'attributes' member
     Buffer vertices;
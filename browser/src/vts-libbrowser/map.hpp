@@ -65,6 +65,8 @@ class MeshAggregate;
 class ExternalBoundLayer;
 class ExternalFreeLayer;
 class BoundMetaTile;
+class NavTile;
+class TerrainHeights;
 class SearchTaskImpl;
 class TilesetMapping;
 class GeodataFeatures;
@@ -91,6 +93,7 @@ public:
     std::shared_ptr<Mapconfig> mapconfig;
     std::shared_ptr<CoordManip> convertor;
     std::shared_ptr<Credits> credits;
+    std::shared_ptr<TerrainHeights> terrainHeights;
     std::vector<std::shared_ptr<MapLayer>> layers;
     std::vector<std::weak_ptr<CameraImpl>> cameras;
     std::vector<std::weak_ptr<SearchTask>> searchTasks;
@@ -135,6 +138,7 @@ public:
     std::shared_ptr<ExternalBoundLayer> getExternalBoundLayer(const std::string &name);
     std::shared_ptr<ExternalFreeLayer> getExternalFreeLayer(const std::string &name);
     std::shared_ptr<BoundMetaTile> getBoundMetaTile(const std::string &name);
+    std::shared_ptr<NavTile> getNavTile(const std::string &name);
     std::shared_ptr<SearchTaskImpl> getSearchTask(const std::string &name);
     std::shared_ptr<TilesetMapping> getTilesetMapping(const std::string &name);
     std::shared_ptr<GeodataFeatures> getGeoFeatures(const std::string &name);
@@ -0,0 +1,323 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "coordsAnalytic.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <cmath>
+#include <map>
+#include <sstream>
+
+namespace vts
+{
+
+namespace
+{
+
+const double pi = 3.14159265358979323846;
+const double degToRad = pi / 180;
+const double radToDeg = 180 / pi;
+
+typedef std::map<std::string, std::string> ProjParams;
+
+ProjParams parseProj(const std::string &def)
+{
+    ProjParams res;
+    std::istringstream ss(def);
+    std::string token;
+    while (ss >> token)
+    {
+        if (token.size() < 2 || token[0] != '+')
+            continue;
+        auto eq = token.find('=');
+        if (eq == std::string::npos)
+            res[token.substr(1)] = "";
+        else
+            res[token.substr(1, eq - 1)] = token.substr(eq + 1);
+    }
+    return res;
+}
+
+bool paramIs(const ProjParams &p, const std::string &name, double expected)
+{
+    auto it = p.find(name);
+    if (it == p.end())
+        return true; // proj default
+    try
+    {
+        return std::stod(it->second) == expected;
+    }
+    catch (...)
+    {
+        return false;
+    }
+}
+
+// parameters that change the meaning of the coordinates
+//   or introduce a datum shift, which the closed forms do not handle
+bool plain(const ProjParams &p)
+{
+    for (const char *n : { "geoidgrids", "axis", "pm", "vunits",
+        "to_meter", "vto_meter", "over", "lon_wrap" })
+        if (p.count(n))
+            return false;
+    auto u = p.find("units");
+    if (u != p.end() && u->second != "m")
+        return false;
+    auto t = p.find("towgs84");
+    if (t != p.end())
+    {
+        std::istringstream ss(t->second);
+        std::string v;
+        while (std::getline(ss, v, ','))
+            if (std::stod(v) != 0)
+                return false;
+    }
+    return true;
+}
+
+enum class Kind
+{
+    Unknown,
+    Geodetic,
+    Geocentric,
+    Mercator,
+};
+
+Kind kind(const ProjParams &p)
+{
+    if (!plain(p))
+        return Kind::Unknown;
+    auto it = p.find("proj");
+    if (it == p.end())
+        return Kind::Unknown;
+    const std::string &n = it->second;
+    if (n == "longlat" || n == "latlong" || n == "lonlat" || n == "latlon")
+        return Kind::Geodetic;
+    if (n == "geocent")
+        return Kind::Geocentric;
+    if (n == "merc" && paramIs(p, "lon_0", 0) && paramIs(p, "lat_ts", 0)
+        && paramIs(p, "x_0", 0) && paramIs(p, "y_0", 0)
+        && paramIs(p, "k", 1) && paramIs(p, "k_0", 1))
+        return Kind::Mercator;
+    return Kind::Unknown;
+}
+
+bool sameAxis(double a, double b)
+{
+    return std::abs(a - b) <= std::abs(a) * 1e-12;
+}
+
+double wrapLongitude(double lon)
+{
+    if (lon < -180 || lon > 180)
+        lon -= 360 * std::floor((lon + 180) / 360);
+    return lon;
+}
+
+bool finite(double x, double y, double z)
+{
+    return std::isfinite(x) && std::isfinite(y) && std::isfinite(z);
+}
+
+} // namespace
+
+AnalyticConvertor AnalyticConvertor::detect(
+    const std::string &projFrom, double aFrom, double bFrom,
+    const std::string &projTo, double aTo, double bTo)
+{
+    AnalyticConvertor res;
+    ProjParams pf, pt;
+    Kind kf, kt;
+    try
+    {
+        pf = parseProj(projFrom);
+        pt = parseProj(projTo);
+        kf = kind(pf);
+        kt = kind(pt);
+    }
+    catch (...)
+    {
+        return res;
+    }
+    if (!(aFrom > 0 && bFrom > 0 && aTo > 0 && bTo > 0))
+        return res;
+
+    if (kf == Kind::Geodetic && kt == Kind::Geocentric
+        && sameAxis(aFrom, aTo) && sameAxis(bFrom, bTo))
+        res.type = Type::GeodeticToGeocentric;
+    else if (kf == Kind::Geocentric && kt == Kind::Geodetic
+        && sameAxis(aFrom, aTo) && sameAxis(bFrom, bTo))
+        res.type = Type::GeocentricToGeodetic;
+    else if (kf == Kind::Geodetic && kt == Kind::Mercator
+        && sameAxis(aTo, bTo))
+        res.type = Type::GeodeticToMercator;
+    else if (kf == Kind::Mercator && kt == Kind::Geodetic
+        && sameAxis(aFrom, bFrom))
+        res.type = Type::MercatorToGeodetic;
+    else
+        return res;
+
+    // the axes of the ellipsoidal (or spherical) side
+    bool fromSide = res.type == Type::GeocentricToGeodetic
+        || res.type == Type::MercatorToGeodetic;
+    res.a = fromSide ? aFrom : aTo;
+    res.b = fromSide ? bFrom : bTo;
+    return res;
+}
+
+bool AnalyticConvertor::operator()(const double value[3], double result[3]) const
+{
+    double x = value[0], y = value[1], z = value[2];
+    switch (type)
+    {
+    case Type::GeodeticToGeocentric:
+    {
+        if (std::abs(y) > 90)
+            return false;
+        const double e2 = 1 - (b * b) / (a * a);
+        const double lon = x * degToRad;
+        const double lat = y * degToRad;
+        const double sl = std::sin(lat);
+        const double cl = std::cos(lat);
+        const double n = a / std::sqrt(1 - e2 * sl * sl);
+        x = (n + z) * cl * std::cos(lon);
+        y = (n + z) * cl * std::sin(lon);
+        z = (n * (1 - e2) + z) * sl;
+    } break;
+    case Type::GeocentricToGeodetic:
+    {
+        // Heikkinen's closed form
+        const double a2 = a * a;
+        const double b2 = b * b;
+        const double e2 = 1 - b2 / a2;
+        const double ep2 = a2 / b2 - 1;
+        const double p = std::sqrt(x * x + y * y);
+        if (p < a * 1e-12)
+        {
+            // on the polar axis
+            x = 0;
+            y = z < 0 ? -90 : 90;
+            z = std::abs(z) - b;
+            break;
+        }
+        const double f = 54 * b2 * z * z;
+        const double g = p * p + (1 - e2) * z * z - e2 * (a2 - b2);
+        const double c = e2 * e2 * f * p * p / (g * g * g);
+        const double s = std::cbrt(1 + c + std::sqrt(c * c + 2 * c));
+        const double k = s + 1 + 1 / s;
+        const double pp = f / (3 * k * k * g * g);
+        const double q = std::sqrt(1 + 2 * e2 * e2 * pp);
+        const double r0 = -(pp * e2 * p) / (1 + q)
+            + std::sqrt(a2 / 2 * (1 + 1 / q)
+                - pp * (1 - e2) * z * z / (q * (1 + q))
+                - pp * p * p / 2);
+        const double t = p - e2 * r0;
+        const double u = std::sqrt(t * t + z * z);
+        const double v = std::sqrt(t * t + (1 - e2) * z * z);
+        const double z0 = b2 * z / (a * v);
+        const double lon = std::atan2(y, x);
+        const double lat = std::atan2(z + ep2 * z0, p);
+        x = lon * radToDeg;
+        y = lat * radToDeg;
+        z = u * (1 - b2 / (a * v));
+    } break;
+    case Type::GeodeticToMercator:
+    {
+        if (std::abs(y) >= 90)
+            return false;
+        const double lon = wrapLongitude(x) * degToRad;
+        const double lat = y * degToRad;
+        x = a * lon;
+        y = a * std::log(std::tan(pi / 4 + lat / 2));
+    } break;
+    case Type::MercatorToGeodetic:
+    {
+        x = wrapLongitude(x / a * radToDeg);
+        y = (pi / 2 - 2 * std::atan(std::exp(-y / a))) * radToDeg;
+    } break;
+    default:
+        return false;
+    }
+    if (!finite(x, y, z))
+        return false;
+    result[0] = x;
+    result[1] = y;
+    result[2] = z;
+    return true;
+}
+
+std::vector<double> AnalyticConvertor::samplePoints() const
+{
+    static const double geodetic[] = {
+        0, 0, 0,
+        14.42, 50.09, 250,
+        -122.42, 37.77, -50,
+        151.21, -33.87, 8848,
+        179.9, 84.5, 1000,
+        -179.9, -84.5, 35000,
+        45, 60, 400000,
+    };
+    std::vector<double> res(std::begin(geodetic), std::end(geodetic));
+    AnalyticConvertor fwd(*this);
+    switch (type)
+    {
+    case Type::GeocentricToGeodetic:
+        fwd.type = Type::GeodeticToGeocentric;
+        break;
+    case Type::MercatorToGeodetic:
+        fwd.type = Type::GeodeticToMercator;
+        break;
+    default:
+        return res;
+    }
+    for (std::size_t i = 0; i < res.size(); i += 3)
+        fwd(res.data() + i, res.data() + i);
+    return res;
+}
+
+bool AnalyticConvertor::matches(const double first[3], const double second[3]) const
+{
+    switch (type)
+    {
+    case Type::GeocentricToGeodetic:
+    case Type::MercatorToGeodetic:
+    {
+        double dl = std::abs(first[0] - second[0]);
+        dl = std::min(dl, 360 - dl); // across the antimeridian
+        return dl <= 1e-8
+            && std::abs(first[1] - second[1]) <= 1e-8
+            && std::abs(first[2] - second[2]) <= 1e-3;
+    }
+    default:
+        return std::abs(first[0] - second[0]) <= 1e-3
+            && std::abs(first[1] - second[1]) <= 1e-3
+            && std::abs(first[2] - second[2]) <= 1e-3;
+    }
+}
+
+} // namespace vts
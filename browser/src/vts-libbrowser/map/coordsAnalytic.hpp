@@ -0,0 +1,76 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COORDSANALYTIC_HPP_sd8f4gh
+#define COORDSANALYTIC_HPP_sd8f4gh
+
+#include <string>
+#include <vector>
+
+namespace vts
+{
+
+// closed-form conversions between the most common srs pairs
+//   used in place of the generic proj pipeline when detected
+//   geodetic coordinates are longitude, latitude (in degrees) and height
+struct AnalyticConvertor
+{
+    enum class Type
+    {
+        None,
+        GeodeticToGeocentric,
+        GeocentricToGeodetic,
+        GeodeticToMercator, // spherical (web) mercator
+        MercatorToGeodetic,
+    };
+
+    Type type = Type::None;
+    double a = 0; // semi-major axis or sphere radius
+    double b = 0; // semi-minor axis
+
+    // a and b are the ellipsoid axes of the respective srs
+    static AnalyticConvertor detect(
+            const std::string &projFrom, double aFrom, double bFrom,
+            const std::string &projTo, double aTo, double bTo);
+
+    explicit operator bool() const { return type != Type::None; }
+
+    // returns false and leaves the result untouched
+    //   for points outside the domain of the closed form
+    //   value and result may be the same
+    bool operator()(const double value[3], double result[3]) const;
+
+    // points in the source srs used to validate against proj
+    std::vector<double> samplePoints() const;
+
+    // compares two results in the target srs
+    //   tolerance is 1e-8 degrees for angles and 1 mm for lengths
+    bool matches(const double first[3], const double second[3]) const;
+};
+
+} // namespace vts
+
+#endif
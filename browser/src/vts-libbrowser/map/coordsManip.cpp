@@ -25,6 +25,7 @@
  */
 
 #include "../coordsManip.hpp"
+#include "coordsAnalytic.hpp"
 
 #include "../include/vts-browser/mapCallbacks.hpp" // ensure that projFinderCallback is visible
 
@@ -38,6 +39,8 @@
 #include <unordered_map>
 #include <memory>
 #include <functional>
+#include <array>
+#include <mutex>
 
 namespace vts
 {
@@ -95,24 +98,66 @@ struct projInitClass
     }
 } projInitInstance;
 
+constexpr uint32 SrsCount = (uint32)Srs::Custom2 + 1;
+
+uint32 srsIndex(Srs srs)
+{
+    uint32 i = (uint32)srs;
+    if (i >= SrsCount)
+        LOGTHROW(fatal, std::invalid_argument) << "Invalid srs enum";
+    return i;
+}
+
+struct Convertor
+{
+    vtslibs::vts::CsConvertor proj;
+    AnalyticConvertor analytic;
+
+    Convertor(const std::string &a, const std::string &b,
+        vtslibs::vts::MapConfig &mapconfig, projCtx ctx) :
+        proj(a, b, mapconfig, ctx)
+    {}
+
+    vec3 operator() (const vec3 &value) const
+    {
+        vec3 res;
+        if (analytic && analytic(value.data(), res.data()))
+            return res;
+        return vecFromUblas<vec3>(proj(vecFromUblas<math::Point3>(value)));
+    }
+};
+
 class CoordManipImpl : public CoordManip
 {
 public:
+    typedef std::array<Convertor *, SrsCount> ConvertorsRow;
+
     vtslibs::vts::MapConfig &mapconfig;
-    std::unordered_map<std::string, std::unique_ptr<vtslibs::vts::CsConvertor>> convertors;
+    std::unordered_map<std::string, std::unique_ptr<Convertor>> convertors;
+    // pre-resolved convertors, avoids building the key on every conversion
+    std::array<ConvertorsRow, SrsCount> fixedConvertors;
+    std::unordered_map<std::string, ConvertorsRow> namedConvertors;
+    std::unordered_map<std::string, ConvertorsRow> toNamedConvertors;
     boost::optional<GeographicLib::Geodesic> geodesic_;
     projCtx ctx = nullptr;
+    std::mutex mut;
+    const bool synchronized;
 
     CoordManipImpl(
             vtslibs::vts::MapConfig &mapconfig,
             const std::string &searchSrs,
             const std::string &customSrs1,
-            const std::string &customSrs2) :
+            const std::string &customSrs2,
+            bool synchronized) :
         mapconfig(mapconfig),
-        ctx(pj_ctx_alloc())
+        ctx(pj_ctx_alloc()),
+        synchronized(synchronized)
     {
         LOG(info1) << "Creating coordinate systems manipulator";
 
+        for (ConvertorsRow &r : fixedConvertors)
+            r.fill(nullptr);
+
 #ifdef __EMSCRIPTEN__
         pj_ctx_set_fileapi(ctx, &projInitInstance.pjFileApi);
 #endif
@@ -136,6 +181,14 @@ public:
         pj_ctx_free(ctx);
     }
 
+    // the lock is empty for manipulators used by a single thread
+    std::unique_lock<std::mutex> lock()
+    {
+        if (synchronized)
+            return std::unique_lock<std::mutex>(mut);
+        return std::unique_lock<std::mutex>();
+    }
+
     void addSrsDef(const std::string &name, const std::string &def)
     {
         vtslibs::registry::Srs s;
@@ -169,36 +222,129 @@ public:
         }
     }
 
-    vtslibs::vts::CsConvertor &convertor(const std::string &a, const std::string &b)
+    AnalyticConvertor detectAnalytic(const std::string &a, const std::string &b, const Convertor &c)
+    {
+        AnalyticConvertor an;
+        try
+        {
+            const geo::SrsDefinition &sa = mapconfig.srs(a).srsDef;
+            const geo::SrsDefinition &sb = mapconfig.srs(b).srsDef;
+            auto ea = geo::ellipsoid(sa);
+            auto eb = geo::ellipsoid(sb);
+            an = AnalyticConvertor::detect(
+                sa.as(geo::SrsDefinition::Type::proj4).srs, ea[0], ea[2],
+                sb.as(geo::SrsDefinition::Type::proj4).srs, eb[0], eb[2]);
+            if (!an)
+                return an;
+
+            // validate the closed form against proj
+            const std::vector<double> samples = an.samplePoints();
+            for (std::size_t i = 0; i < samples.size(); i += 3)
+            {
+                vec3 v = rawToVec3(samples.data() + i);
+                vec3 p = vecFromUblas<vec3>(c.proj(vecFromUblas<math::Point3>(v)));
+                vec3 r;
+                if (!an(v.data(), r.data()) || !an.matches(r.data(), p.data()))
+                {
+                    LOG(warn2) << "Analytic conversion from <" << a << "> to <" << b
+                        << "> does not match proj, using proj instead";
+                    return {};
+                }
+            }
+        }
+        catch (const std::exception &)
+        {
+            return {};
+        }
+        LOG(info2) << "Using analytic conversion from <" << a << "> to <" << b << ">";
+        return an;
+    }
+
+    Convertor &convertor(const std::string &a, const std::string &b)
     {
         const std::string key = a + " >>> " + b;
         auto it = convertors.find(key);
         if (it == convertors.end())
         {
-            convertors[key] = std::make_unique<vtslibs::vts::CsConvertor>(a, b, mapconfig, ctx);
-            it = convertors.find(key);
+            auto c = std::make_unique<Convertor>(a, b, mapconfig, ctx);
+            c->analytic = detectAnalytic(a, b, *c);
+            it = convertors.emplace(key, std::move(c)).first;
         }
         return *it->second;
     }
 
-    vec3 convert(const vec3 &value, const std::string &f, const std::string &t)
+    Convertor &convertor(Srs from, Srs to)
     {
-        const auto &cs = convertor(f, t);
-        vec3 res = vecFromUblas<vec3>(cs(vecFromUblas<math::Point3>(value)));
-        //LOG(debug) << "Converted <" << value.transpose() << "><" << f << "> to <" << res.transpose() << "><" << t << ">";
-        return res;
+        Convertor *&c = fixedConvertors[srsIndex(from)][srsIndex(to)];
+        if (!c)
+            c = &convertor(srsToProj(from), srsToProj(to));
+        return *c;
+    }
+
+    Convertor &convertor(const std::string &from, Srs to)
+    {
+        auto it = namedConvertors.find(from);
+        if (it == namedConvertors.end())
+        {
+            ConvertorsRow r;
+            r.fill(nullptr);
+            it = namedConvertors.emplace(from, r).first;
+        }
+        Convertor *&c = it->second[srsIndex(to)];
+        if (!c)
+            c = &convertor(from, srsToProj(to));
+        return *c;
+    }
+
+    Convertor &convertor(Srs from, const std::string &to)
+    {
+        auto it = toNamedConvertors.find(to);
+        if (it == toNamedConvertors.end())
+        {
+            ConvertorsRow r;
+            r.fill(nullptr);
+            it = toNamedConvertors.emplace(to, r).first;
+        }
+        Convertor *&c = it->second[srsIndex(from)];
+        if (!c)
+            c = &convertor(srsToProj(from), to);
+        return *c;
+    }
+
+    static vec3 convert(const vec3 &value, const Convertor &c)
+    {
+        return c(value);
+    }
+
+    static void convert(const double *values, double *results, std::size_t count, const Convertor &c)
+    {
+        if (c.analytic)
+        {
+            for (std::size_t i = 0; i < count; i++)
+            {
+                if (!c.analytic(values + i * 3, results + i * 3))
+                    vecToRaw(convert(rawToVec3(values + i * 3), c), results + i * 3);
+            }
+            return;
+        }
+        for (std::size_t i = 0; i < count; i++)
+            vecToRaw(convert(rawToVec3(values + i * 3), c), results + i * 3);
     }
 };
 
+// the batch conversions reinterpret arrays of vec3 as arrays of doubles
+static_assert(sizeof(vec3) == 3 * sizeof(double), "vec3 must be tightly packed");
+
 } // namespace
 
 std::shared_ptr<CoordManip> CoordManip::create(
     vtslibs::vts::MapConfig &mapconfig,
     const std::string &searchSrs,
     const std::string &customSrs1,
-    const std::string &customSrs2)
+    const std::string &customSrs2,
+    bool synchronized)
 {
-    return std::make_shared<CoordManipImpl>(mapconfig, searchSrs, customSrs1, customSrs2);
+    return std::make_shared<CoordManipImpl>(mapconfig, searchSrs, customSrs1, customSrs2, synchronized);
 }
 
 vec3 CoordManip::navToPhys(const vec3 &value)
@@ -219,19 +365,54 @@ vec3 CoordManip::searchToNav(const vec3 &value)
 vec3 CoordManip::convert(const vec3 &value, Srs from, Srs to)
 {
     CoordManipImpl *impl = (CoordManipImpl *)this;
-    return impl->convert(value, impl->srsToProj(from), impl->srsToProj(to));
+    auto l = impl->lock();
+    return impl->convert(value, impl->convertor(from, to));
 }
 
 vec3 CoordManip::convert(const vec3 &value, const std::string &from, Srs to)
 {
     CoordManipImpl *impl = (CoordManipImpl *)this;
-    return impl->convert(value, from, impl->srsToProj(to));
+    auto l = impl->lock();
+    return impl->convert(value, impl->convertor(from, to));
 }
 
 vec3 CoordManip::convert(const vec3 &value, Srs from, const std::string &to)
 {
     CoordManipImpl *impl = (CoordManipImpl *)this;
-    return impl->convert(value, impl->srsToProj(from), to);
+    auto l = impl->lock();
+    return impl->convert(value, impl->convertor(from, to));
+}
+
+void CoordManip::convert(const vec3 *values, vec3 *results, std::size_t count, Srs from, Srs to)
+{
+    if (count == 0)
+        return;
+    convert(values->data(), results->data(), count, from, to);
+}
+
+void CoordManip::convert(const vec3 *values, vec3 *results, std::size_t count, const std::string &from, Srs to)
+{
+    if (count == 0)
+        return;
+    CoordManipImpl *impl = (CoordManipImpl *)this;
+    auto l = impl->lock();
+    impl->convert(values->data(), results->data(), count, impl->convertor(from, to));
+}
+
+void CoordManip::convert(const vec3 *values, vec3 *results, std::size_t count, Srs from, const std::string &to)
+{
+    if (count == 0)
+        return;
+    CoordManipImpl *impl = (CoordManipImpl *)this;
+    auto l = impl->lock();
+    impl->convert(values->data(), results->data(), count, impl->convertor(from, to));
+}
+
+void CoordManip::convert(const double *values, double *results, std::size_t count, Srs from, Srs to)
+{
+    CoordManipImpl *impl = (CoordManipImpl *)this;
+    auto l = impl->lock();
+    impl->convert(values, results, count, impl->convertor(from, to));
 }
 
 vec3 CoordManip::geoDirect(const vec3 &position, double distance, double azimuthIn, double &azimuthOut)
@@ -38,6 +38,7 @@
 #include "../credits.hpp"
 #include "../coordsManip.hpp"
 #include "../resources.hpp"
+#include "../terrainHeights.hpp"
 #include "../map.hpp"
 
 #include <optick.h>
@@ -75,6 +76,9 @@ void MapImpl::renderUpdate(double elapsedTime)
 
     updateSearch();
 
+    if (terrainHeights)
+        terrainHeights->touch();
+
     cameras.erase(std::remove_if(cameras.begin(), cameras.end(),
         [&](std::weak_ptr<CameraImpl> &camera) {
         return !camera.lock();
@@ -111,7 +115,12 @@ void MapImpl::purgeMapconfig()
         auth->forceRedownload();
     auth.reset();
     if (mapconfig)
-        mapconfig->forceRedownload();
+    {
+        // snapshots may still use the mapconfig in other threads,
+        //   the reload must decode into a new instance
+        //   instead of redownloading this one in place
+        resources->resources.erase(mapconfig->name);
+    }
     mapconfig.reset();
     mapconfigAvailable = false;
 
@@ -148,6 +157,7 @@ void MapImpl::purgeViewCache()
     mapconfigReady = false;
     mapconfigView = "";
     layers.clear();
+    terrainHeights.reset();
 
     for (auto &camera : cameras)
     {
@@ -226,6 +226,7 @@ SurfaceInfo::SurfaceInfo(const vtslibs::vts::SurfaceCommonConfig &surface,
     urlMeta.parse(convertPath(surface.urls3d->meta, parentPath));
     urlMesh.parse(convertPath(surface.urls3d->mesh, parentPath));
     urlIntTex.parse(convertPath(surface.urls3d->texture, parentPath));
+    urlNav.parse(convertPath(surface.urls3d->nav, parentPath));
 }
 
 SurfaceInfo::SurfaceInfo(
@@ -0,0 +1,297 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "../terrainHeights.hpp"
+#include "../metaTile.hpp"
+#include "../mapLayer.hpp"
+#include "../mapConfig.hpp"
+#include "../coordsManip.hpp"
+#include "../map.hpp"
+
+#include <optick.h>
+
+namespace vts
+{
+
+using vtslibs::vts::NodeInfo;
+
+namespace
+{
+
+// decoded navtile takes 64 KB
+const uint32 MaxTiles = 256;
+
+TileId tileAt(const NodeInfo &division, const vec2 &sds, uint32 lod)
+{
+    const TileId root = division.nodeId();
+    assert(lod >= root.lod);
+    const uint32 d = lod - root.lod;
+    const math::Extents2 &ext = division.extents();
+    const double n = double(1u << d);
+    // tile rows go downwards
+    double u = (sds[0] - ext.ll[0]) / (ext.ur[0] - ext.ll[0]);
+    double v = (ext.ur[1] - sds[1]) / (ext.ur[1] - ext.ll[1]);
+    uint32 x = std::min((uint32)(clamp(u, 0, 1) * n), (1u << d) - 1);
+    uint32 y = std::min((uint32)(clamp(v, 0, 1) * n), (1u << d) - 1);
+    return TileId(lod, (root.x << d) + x, (root.y << d) + y);
+}
+
+} // namespace
+
+TerrainHeights::TerrainHeights(MapImpl *map) : map(map)
+{}
+
+void TerrainHeights::touch()
+{
+    for (auto &it : tiles)
+        map->touchResource(it.second.navtile);
+}
+
+bool TerrainHeights::query(const vec3 *navPos, double *results,
+    uint32 count, double resolution)
+{
+    OPTICK_EVENT();
+    assert(map->mapconfigReady);
+    bool complete = true;
+    for (uint32 i = 0; i < count; i++)
+    {
+        results[i] = nan1();
+        if (queryOne(navPos[i], resolution, results[i])
+            == Validity::Indeterminate)
+            complete = false;
+    }
+    return complete;
+}
+
+Validity TerrainHeights::queryOne(const vec3 &navPos,
+    double resolution, double &result)
+{
+    // find surface division coordinates (and appropriate node info)
+    vec2 sds;
+    const NodeInfo *info = nullptr;
+    uint32 index = 0;
+    for (const auto &it : map->mapconfig->referenceFrame.division.nodes)
+    {
+        struct I {
+            uint32 &i; I(uint32 &i) : i(i) {} ~I() { ++i; }
+        } inc(index);
+        if (it.second.partitioning.mode
+                != vtslibs::registry::PartitioningMode::bisection)
+            continue;
+        const NodeInfo &ni
+            = map->mapconfig->referenceDivisionNodeInfos[index];
+        try
+        {
+            sds = vec3to2(map->convertor->convert(navPos,
+                Srs::Navigation, it.second.srs));
+            if (!ni.inside(vecToUblas<math::Point2>(sds)))
+                continue;
+            info = &ni;
+            break;
+        }
+        catch(const std::exception &)
+        {
+            // do nothing
+        }
+    }
+    if (!info)
+        return Validity::Invalid;
+
+    // desired lod
+    //   navtile has 256 samples across the tile
+    const math::Extents2 &ext = info->extents();
+    const double samples = (ext.ur[0] - ext.ll[0])
+        / std::max(resolution, 1e-3) / 255;
+    const uint32 desiredLod = info->nodeId().lod
+        + (uint32)clamp(std::ceil(std::log2(samples)), 0, 24);
+
+    Tile *tile = nullptr;
+    Validity v = findTile(*info, sds, desiredLod, tile);
+    if (v != Validity::Valid)
+        return v;
+    v = map->getResourceValidity(tile->navtile);
+    if (v != Validity::Valid)
+        return v;
+
+    // bilinear sampling
+    double tu = (sds[0] - tile->ll[0]) / (tile->ur[0] - tile->ll[0]);
+    double tv = (sds[1] - tile->ll[1]) / (tile->ur[1] - tile->ll[1]);
+    result = interpolate(tile->heightMin, tile->heightMax,
+        tile->navtile->sample(tu, tv));
+    return Validity::Valid;
+}
+
+TerrainHeights::Tile *TerrainHeights::findCached(const NodeInfo &division,
+    const vec2 &sds, uint32 desiredLod)
+{
+    const uint32 rootLod = division.nodeId().lod;
+    for (uint32 l = desiredLod + 1; l-- > rootLod; )
+    {
+        auto it = tiles.find(tileAt(division, sds, l));
+        if (it == tiles.end())
+            continue;
+        Tile &t = it->second;
+        if (desiredLod > t.explored && !t.leaf)
+            return nullptr; // deeper data may exist
+        lru.splice(lru.begin(), lru, t.lruIt);
+        return &t;
+    }
+    return nullptr;
+}
+
+TerrainHeights::Tile *TerrainHeights::insert(const TileId &id,
+    const Tile &tile)
+{
+    auto it = tiles.find(id);
+    if (it != tiles.end())
+    {
+        Tile &t = it->second;
+        t.explored = std::max(t.explored, tile.explored);
+        t.leaf = t.leaf || tile.leaf;
+        lru.splice(lru.begin(), lru, t.lruIt);
+        return &t;
+    }
+    while (tiles.size() >= MaxTiles)
+    {
+        tiles.erase(lru.back());
+        lru.pop_back();
+    }
+    lru.push_front(id);
+    Tile &t = tiles[id] = tile;
+    t.lruIt = lru.begin();
+    return &t;
+}
+
+Validity TerrainHeights::findTile(const NodeInfo &division,
+    const vec2 &sds, uint32 desiredLod, Tile *&result)
+{
+    result = findCached(division, sds, desiredLod);
+    if (result)
+        return Validity::Valid;
+
+    // descend through the metatiles from the division node
+    //   and keep the deepest node that has a navtile
+    const MapLayer *layer = map->layers[0].get();
+    const std::vector<SurfaceInfo> &surfaces = layer->surfaceStack.surfaces;
+    std::vector<bool> available(surfaces.size(), true);
+    std::vector<std::shared_ptr<MetaTile>> metaTiles(surfaces.size());
+    TileId id = division.nodeId();
+    vec2 ll = vecFromUblas<vec2>(division.extents().ll);
+    vec2 ur = vecFromUblas<vec2>(division.extents().ur);
+    boost::optional<Tile> best;
+    TileId bestId;
+    bool leaf = false;
+    while (true)
+    {
+        // find topmost nonempty surface
+        const UrlTemplate::Vars tileIdVars(map->roundId(id));
+        const SurfaceInfo *topmost = nullptr;
+        const vtslibs::vts::MetaNode *topmostNode = nullptr;
+        for (uint32 i = 0, e = surfaces.size(); i != e; i++)
+        {
+            metaTiles[i].reset();
+            if (!available[i])
+                continue;
+            auto m = map->getMetaTile(surfaces[i].urlMeta(tileIdVars));
+            switch (map->getResourceValidity(m))
+            {
+            case Validity::Indeterminate:
+                return Validity::Indeterminate;
+            case Validity::Invalid:
+                continue;
+            case Validity::Valid:
+                break;
+            }
+            metaTiles[i] = m;
+            const vtslibs::vts::MetaNode &n = m->get(id);
+            if (topmost || n.alien() != surfaces[i].alien || !n.geometry())
+                continue;
+            topmostNode = &n;
+            if (layer->tilesetStack)
+            {
+                assert(n.sourceReference > 0 && n.sourceReference <= layer->tilesetStack->surfaces.size());
+                topmost = &layer->tilesetStack->surfaces[n.sourceReference];
+            }
+            else
+                topmost = &surfaces[i];
+        }
+
+        if (topmostNode && topmostNode->navtile())
+        {
+            std::string url = topmost->urlNav(UrlTemplate::Vars(id));
+            if (!url.empty())
+            {
+                Tile t;
+                t.navtile = map->getNavTile(url);
+                t.ll = ll;
+                t.ur = ur;
+                t.heightMin = topmostNode->heightRange.min;
+                t.heightMax = topmostNode->heightRange.max;
+                best = t;
+                bestId = id;
+            }
+        }
+
+        if (id.lod >= desiredLod)
+            break;
+
+        // child containing the point
+        const vec2 center = (ll + ur) * 0.5;
+        const uint32 cx = sds[0] < center[0] ? 0 : 1;
+        const uint32 cy = sds[1] < center[1] ? 1 : 0; // tile rows go downwards
+        const uint32 idx = cx + cy * 2;
+        bool any = false;
+        for (uint32 i = 0, e = surfaces.size(); i != e; i++)
+        {
+            available[i] = metaTiles[i] && (metaTiles[i]->get(id).childFlags()
+                & (vtslibs::vts::MetaNode::Flag::ulChild << idx));
+            any = any || available[i];
+        }
+        if (!any)
+        {
+            leaf = true;
+            break;
+        }
+        id = TileId(id.lod + 1, id.x * 2 + cx, id.y * 2 + cy);
+        if (cx)
+            ll[0] = center[0];
+        else
+            ur[0] = center[0];
+        if (cy)
+            ur[1] = center[1];
+        else
+            ll[1] = center[1];
+    }
+
+    if (!best)
+        return Validity::Invalid;
+    best->explored = id.lod;
+    best->leaf = leaf;
+    result = insert(bestId, *best);
+    return Validity::Valid;
+}
+
+} // namespace vts
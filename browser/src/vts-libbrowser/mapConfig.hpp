@@ -94,6 +94,7 @@ public:
     BrowserOptions browserOptions;
     std::vector<vtslibs::vts::NodeInfo> referenceDivisionNodeInfos;
     std::shared_ptr<CoordManip> convertorData; // used in data/decoder thread
+    std::shared_ptr<CoordManip> convertorQuery; // used by snapshots in any thread
     std::string atmosphereDensityTextureName;
 
 private:
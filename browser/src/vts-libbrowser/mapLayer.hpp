@@ -50,6 +50,7 @@ public:
     UrlTemplate urlMesh;
     UrlTemplate urlIntTex;
     UrlTemplate urlGeodata;
+    UrlTemplate urlNav;
     vtslibs::vts::TilesetIdList name;
     vec3f color {0,0,0};
     bool alien = false;
@@ -50,6 +50,25 @@ public:
     uint8 flags[vtslibs::registry::BoundLayer::rasterMetatileWidth * vtslibs::registry::BoundLayer::rasterMetatileHeight];
 };
 
+// navigation heights of single tile
+//   the samples are normalized into the height range of the metanode
+//   the corner samples lie on the corners of the tile extents
+class NavTile : public Resource
+{
+public:
+    NavTile(MapImpl *map, const std::string &name);
+    void decode() override;
+    FetchTask::ResourceType resourceType() const override;
+
+    // bilinear interpolation, returns value in 0 .. 1
+    //   u and v are in 0 .. 1, v goes upwards (as the extents)
+    double sample(double u, double v) const;
+
+    std::vector<uint8> data;
+    uint32 width = 0;
+    uint32 height = 0;
+};
+
 class MetaNode
 {
 public:
@@ -422,13 +422,19 @@ void NavigationImpl::updateNavigation(double elapsedTime)
             double alpha = 0;
             // start at 0.3 between target and eye (closer to the target)
             // and go towards eye
-            for (double fraction = 0.3; fraction < 1.01; fraction += 0.05)
+            const uint32 samples = 15;
+            vec3 centers[samples];
+            double altitudes[samples];
+            for (uint32 i = 0; i < samples; i++)
+                centers[i] = centerBase - forward * (objDist * (0.3 + i * 0.05));
+            convertor->convert(centers, centers, samples, Srs::Physical, Srs::Navigation);
+            camera->getSurfaceOverEllipsoid(centers, altitudes, samples, sampleSize, debug);
+            for (uint32 i = 0; i < samples; i++)
             {
+                double fraction = 0.3 + i * 0.05;
                 double l = objDist * fraction;
-                vec3 center = centerBase - forward * l;
-                vec3 centerNav = convertor->physToNav(center);
-                double altitude = nan1();
-                if (!camera->getSurfaceOverEllipsoid(altitude, centerNav, sampleSize, debug))
+                double altitude = altitudes[i];
+                if (std::isnan(altitude))
                     continue;
                 altitude += thresholdBase * fraction * fraction;
                 altitude -= altCenter;
@@ -39,6 +39,7 @@
 
 #include "../utilities/threadName.hpp"
 #include "../validity.hpp"
+#include "../fetchHosts.hpp"
 
 #include <optick.h>
 
@@ -74,8 +75,11 @@ public:
 
     Buffer buffer;
     std::string name;
+    std::string etag;
     sint64 expires = 0;
+    sint64 lastModified = -1;
     bool availFailed = false;
+    bool stale = false; // expired, must be revalidated before use
 };
 
 class UploadData
@@ -184,6 +188,7 @@ public:
     void cacheReadProcess(const std::shared_ptr<Resource> &r);
 
     void fetcherProcessorEntry();
+    bool fetchNext();
 
     void removeOld();
     void checkInitialized();
@@ -214,9 +219,12 @@ public:
     ResourceProcessor<UploadData, &Resources::oneUpload, &Resources::priority, 0> queUpload;
 
     std::unordered_map<std::string, std::shared_ptr<Resource>> resources;
+    FetchHosts fetchHosts;
+    std::vector<std::string> saturatedHosts; // fetcher thread only
     MapImpl *const map;
     std::atomic<uint32> downloads{ 0 }; // number of active downloads
     std::atomic<uint32> existing{ 0 }; // number of existing resources
+    std::atomic<uint64> revalidationSavedBytes{ 0 };
     std::atomic<bool> renderFinalizeCalled{ false };
 };
 
@@ -28,6 +28,7 @@
 #include "../resources.hpp"
 #include "../map.hpp"
 
+#include <limits>
 #include <boost/filesystem.hpp>
 #include <utility/path.hpp> // homeDir
 #include <utility/md5.hpp>
@@ -41,7 +42,7 @@ namespace
 {
 
 static const char Magic[] = "vtscache";
-static const uint16 Version = 4;
+static const uint16 Version = 5;
 
 enum class CacheFlags : uint16
 {
@@ -55,7 +56,9 @@ struct CacheHeader
     uint16 version;
     uint16 flags;
     uint16 nameLen;
+    uint16 etagLen;
     sint64 expires;
+    sint64 lastModified;
 };
 
 char digit(unsigned char a)
@@ -109,7 +112,11 @@ public:
         try
         {
             std::string name = stripScheme(cd.name);
-            Buffer b(sizeof(CacheHeader) + name.size() + cd.buffer.size());
+            if (cd.etag.size() > std::numeric_limits<uint16>::max())
+                return;
+            const uint32 prefix = sizeof(CacheHeader)
+                + name.size() + cd.etag.size();
+            Buffer b(prefix + cd.buffer.size());
             memset(b.data(), 0, sizeof(CacheHeader)); // initialize structure padding
             CacheHeader *h = (CacheHeader*)b.data();
             memcpy(h->magic, Magic, sizeof(Magic));
@@ -117,10 +124,13 @@ public:
             if (cd.availFailed)
                 h->flags |= (uint16)CacheFlags::AvailFailed;
             h->expires = cd.expires;
+            h->lastModified = cd.lastModified;
             h->nameLen = name.size();
+            h->etagLen = cd.etag.size();
             memcpy(b.data() + sizeof(CacheHeader), name.data(), name.size());
             memcpy(b.data() + sizeof(CacheHeader) + name.size(),
-                cd.buffer.data(), cd.buffer.size());
+                cd.etag.data(), cd.etag.size());
+            memcpy(b.data() + prefix, cd.buffer.data(), cd.buffer.size());
             writeLocalFileBuffer(convertNameToCache(name), b);
         }
         catch (...)
@@ -155,23 +165,28 @@ public:
                 return {};
             sint64 &expires = cd.expires;
             expires = h->expires;
-            if (expires == -2)
-                return {}; // must revalidate
-            if (expires > 0 && expires < std::time(nullptr))
-                return {}; // expired
+            cd.lastModified = h->lastModified;
             if (name.size() != h->nameLen)
                 return {};
-            if (b.size() < sizeof(CacheHeader) + h->nameLen)
+            const uint32 prefix = sizeof(CacheHeader)
+                + h->nameLen + h->etagLen;
+            if (b.size() < prefix)
                 return {};
             if (memcmp(b.data() + sizeof(CacheHeader),
                 name.data(), h->nameLen) != 0)
                 return {};
-            uint32 size = b.size() - sizeof(CacheHeader) - h->nameLen;
+            cd.etag.assign(b.data() + sizeof(CacheHeader) + h->nameLen,
+                h->etagLen);
+            // expired entries are usable only with conditional request
+            cd.stale = expires == -2
+                || (expires > 0 && expires < std::time(nullptr));
+            if (cd.stale && cd.etag.empty() && cd.lastModified <= 0)
+                return {};
+            uint32 size = b.size() - prefix;
             if (size > 0)
             {
                 cd.buffer.allocate(size);
-                memcpy(cd.buffer.data(), b.data()
-                    + sizeof(CacheHeader) + h->nameLen, size);
+                memcpy(cd.buffer.data(), b.data() + prefix, size);
             }
             cd.availFailed = (h->flags & (uint16)CacheFlags::AvailFailed)
                 == (uint16)CacheFlags::AvailFailed;
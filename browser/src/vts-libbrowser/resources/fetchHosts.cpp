@@ -0,0 +1,189 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "../include/vts-browser/math.hpp"
+#include "../fetchHosts.hpp"
+
+#include <algorithm>
+
+namespace vts
+{
+
+namespace
+{
+
+constexpr uint32 LatencySamples = 100;
+constexpr double InitialLimit = 4;
+
+double percentile(const std::vector<double> &sorted, double p)
+{
+    if (sorted.empty())
+        return 0;
+    std::size_t i = (std::size_t)std::ceil(p * sorted.size());
+    return sorted[std::min(std::max(i, (std::size_t)1), sorted.size()) - 1];
+}
+
+} // namespace
+
+FetchHosts::Host::Host() : latencyMin(inf1()), limit(InitialLimit),
+    windowStart(Clock::now())
+{
+    latencies.reserve(LatencySamples);
+}
+
+std::string FetchHosts::hostOf(const std::string &url)
+{
+    auto s = url.find("://");
+    if (s == std::string::npos)
+        return "";
+    s += 3;
+    auto e = url.find_first_of("/?#", s);
+    std::string h = url.substr(s, e == std::string::npos ? e : e - s);
+    auto a = h.rfind('@'); // strip credentials
+    if (a != std::string::npos)
+        h = h.substr(a + 1);
+    return h;
+}
+
+uint32 FetchHosts::limit(const Host &h, uint32 maxLimit, bool adaptive)
+{
+    maxLimit = std::max(maxLimit, 1u);
+    if (!adaptive)
+        return maxLimit;
+    return std::min(std::max((uint32)(h.limit + 0.5), 1u), maxLimit);
+}
+
+void FetchHosts::saturated(std::vector<std::string> &result,
+    uint32 maxLimit, bool adaptive)
+{
+    result.clear();
+    std::lock_guard<std::mutex> lock(mut);
+    for (const auto &it : hosts)
+    {
+        if (it.second.inFlight >= limit(it.second, maxLimit, adaptive))
+            result.push_back(it.first);
+    }
+}
+
+void FetchHosts::started(const std::string &host)
+{
+    std::lock_guard<std::mutex> lock(mut);
+    hosts[host].inFlight++;
+}
+
+void FetchHosts::finished(const std::string &host, double latency,
+    uint32 bytes, uint32 code, uint32 maxLimit, bool adaptive)
+{
+    std::lock_guard<std::mutex> lock(mut);
+    Host &h = hosts[host];
+    if (h.inFlight > 0)
+        h.inFlight--;
+
+    // server errors, timeouts and connection failures
+    //   are signs of an overloaded host
+    if (code >= 500 || code < 100)
+    {
+        h.failed++;
+        h.limit = std::max(h.limit * 0.75, 1.0);
+        return;
+    }
+    if (code >= 400)
+        h.failed++;
+    else
+        h.downloaded++;
+    h.bytes += bytes;
+
+    // latency
+    if (h.latencies.size() < LatencySamples)
+        h.latencies.push_back(latency);
+    else
+        h.latencies[h.latenciesNext] = latency;
+    h.latenciesNext = (h.latenciesNext + 1) % LatencySamples;
+    // the minimum slowly forgets to follow changes in the network
+    h.latencyMin = std::min(latency, h.latencyMin * 1.001);
+    h.latencyAvg = h.latencyAvg > 0
+        ? interpolate(h.latencyAvg, latency, 0.1) : latency;
+
+    // throughput
+    h.windowBytes += bytes;
+    Clock::time_point now = Clock::now();
+    double window = std::chrono::duration<double>(now - h.windowStart).count();
+    if (window >= 1)
+    {
+        double t = h.windowBytes / window;
+        h.throughput = h.throughput > 0 ? interpolate(h.throughput, t, 0.5) : t;
+        h.windowBytes = 0;
+        h.windowStart = now;
+    }
+
+    // concurrency limit
+    //   the limit grows while the latency stays close to its minimum
+    //   and shrinks when the requests start to queue up at the host
+    if (adaptive && h.latencyAvg > 0)
+    {
+        double gradient = clamp(h.latencyMin / h.latencyAvg, 0.5, 1);
+        double target = h.limit * gradient + std::sqrt(h.limit);
+        // do not grow the limit when it is not used
+        if (target > h.limit && h.inFlight + 1 < h.limit * 0.5)
+            target = h.limit;
+        h.limit = clamp(interpolate(h.limit, target, 0.2),
+            1, std::max(maxLimit, 1u));
+    }
+}
+
+void FetchHosts::statistics(std::vector<HostStatistics> &result,
+    uint32 maxLimit, bool adaptive)
+{
+    result.clear();
+    std::vector<double> sorted;
+    std::lock_guard<std::mutex> lock(mut);
+    result.reserve(hosts.size());
+    for (const auto &it : hosts)
+    {
+        const Host &h = it.second;
+        HostStatistics s;
+        s.host = it.first;
+        s.bytesDownloaded = h.bytes;
+        s.downloaded = h.downloaded;
+        s.failed = h.failed;
+        s.inFlight = h.inFlight;
+        s.concurrencyLimit = limit(h, maxLimit, adaptive);
+        sorted = h.latencies;
+        std::sort(sorted.begin(), sorted.end());
+        s.latencyP50 = percentile(sorted, 0.5);
+        s.latencyP90 = percentile(sorted, 0.9);
+        s.latencyP99 = percentile(sorted, 0.99);
+        s.latencyMin = std::isinf(h.latencyMin) ? 0 : h.latencyMin;
+        s.throughput = h.throughput;
+        result.push_back(std::move(s));
+    }
+    std::sort(result.begin(), result.end(),
+        [](const HostStatistics &a, const HostStatistics &b) {
+            return a.host < b.host;
+        });
+}
+
+} // namespace vts
@@ -2280,6 +2280,18 @@ void GeodataTile::decode()
         geoContext<false> ctx(this);
         ctx.process();
     }
+
+    // let the application prepare the data in this thread
+    if (map->callbacks.decodeGeodata)
+    {
+        uint32 index = 0;
+        for (auto &spec : specsToUpload)
+        {
+            std::stringstream ss;
+            ss << name << "#" << index++;
+            map->callbacks.decodeGeodata(spec, ss.str());
+        }
+    }
 }
 
 void GeodataTile::upload()
@@ -146,6 +146,12 @@ std::shared_ptr<BoundMetaTile> MapImpl::getBoundMetaTile(
     return getMapResource<BoundMetaTile>(this, name);
 }
 
+std::shared_ptr<NavTile> MapImpl::getNavTile(
+        const std::string &name)
+{
+    return getMapResource<NavTile>(this, name);
+}
+
 std::shared_ptr<SearchTaskImpl> MapImpl::getSearchTask(const std::string &name)
 {
     return getMapResource<SearchTaskImpl>(this, name);
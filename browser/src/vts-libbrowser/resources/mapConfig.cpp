@@ -55,6 +55,7 @@ void Mapconfig::decode()
     browserOptions = BrowserOptions();
     atmosphereDensityTextureName = "";
     convertorData.reset();
+    convertorQuery.reset();
     boundInfos.clear();
     freeInfos.clear();
 
@@ -119,6 +120,9 @@ void Mapconfig::decode()
     // convertor for use in decode thread
     convertorData = CoordManip::create(*this, browserOptions.searchSrs, map->createOptions.customSrs1, map->createOptions.customSrs2);
 
+    // convertor for use in snapshots
+    convertorQuery = CoordManip::create(*this, browserOptions.searchSrs, map->createOptions.customSrs1, map->createOptions.customSrs2, true);
+
     // memory use
     info.ramMemoryCost += sizeof(*this);
 }
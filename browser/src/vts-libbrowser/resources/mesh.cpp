@@ -25,6 +25,7 @@
  */
 
 #include "../utilities/obj.hpp"
+#include "../utilities/meshOptimize.hpp"
 #include "../gpuResource.hpp"
 #include "../fetchTask.hpp"
 #include "../map.hpp"
@@ -63,10 +64,104 @@ GpuMeshSpec::GpuMeshSpec(const Buffer &buffer) :
     }
 }
 
+namespace
+{
+
+template<class Index>
+void optimizeSpec(GpuMeshSpec &spec)
+{
+    Index *indices = (Index*)spec.indices.data();
+    optimizeVertexCache(indices, spec.indicesCount, spec.verticesCount);
+    std::vector<uint32> newToOld;
+    optimizeVertexFetch(indices, spec.indicesCount,
+                        spec.verticesCount, newToOld);
+
+    // permute the data of each attribute separately
+    //   so that non-interleaved layouts work too
+    Buffer vertices = spec.vertices.copy();
+    for (const auto &a : spec.attributes)
+    {
+        if (!a.enable)
+            continue;
+        uint32 size = a.components * gpuTypeSize(a.type);
+        uint32 stride = a.stride ? a.stride : size;
+        const char *src = spec.vertices.data() + a.offset;
+        char *dst = vertices.data() + a.offset;
+        for (uint32 n = 0; n < spec.verticesCount; n++)
+            memcpy(dst + n * stride, src + newToOld[n] * stride, size);
+    }
+    spec.vertices = std::move(vertices);
+}
+
+template<class Index>
+uint32 specCacheMisses(const GpuMeshSpec &spec)
+{
+    return vertexCacheMisses((const Index*)spec.indices.data(),
+                             spec.indicesCount, spec.verticesCount);
+}
+
+bool optimizable(const GpuMeshSpec &spec)
+{
+    return spec.faceMode == GpuMeshSpec::FaceMode::Triangles
+        && spec.indicesCount > 0
+        && (spec.indexMode == GpuTypeEnum::UnsignedShort
+            || spec.indexMode == GpuTypeEnum::UnsignedInt);
+}
+
+} // namespace
+
+void GpuMeshSpec::optimize()
+{
+    OPTICK_EVENT();
+    if (!optimizable(*this))
+        return;
+    if (indexMode == GpuTypeEnum::UnsignedShort)
+        optimizeSpec<uint16>(*this);
+    else
+        optimizeSpec<uint32>(*this);
+}
+
+double GpuMeshSpec::vertexCacheMissRatio() const
+{
+    if (!optimizable(*this))
+        return 0;
+    uint32 misses = indexMode == GpuTypeEnum::UnsignedShort
+        ? specCacheMisses<uint16>(*this) : specCacheMisses<uint32>(*this);
+    return misses * 3.0 / indicesCount;
+}
+
 GpuMesh::GpuMesh(MapImpl *map, const std::string &name) :
     Resource(map, name)
 {}
 
+namespace
+{
+
+// normalized value (0 .. 1) to unsigned short
+uint16 unorm16(double v)
+{
+    return (uint16)(std::min(std::max(v, 0.0), 1.0) * 65535.0 + 0.5);
+}
+
+void writePosition(char *o, const math::Point3 &p)
+{
+    // from -1 .. 1 (normalized submesh) to 0 .. 1
+    uint16 *q = (uint16*)o;
+    q[0] = unorm16(p[0] * 0.5 + 0.5);
+    q[1] = unorm16(p[1] * 0.5 + 0.5);
+    q[2] = unorm16(p[2] * 0.5 + 0.5);
+    q[3] = 0;
+}
+
+void writeUv(char *o, const math::Point2 &p)
+{
+    uint16 *q = (uint16*)o;
+    q[0] = unorm16(p[0]);
+    q[1] = unorm16(p[1]);
+}
+
+} // namespace
+
 GpuMesh::GpuMesh(MapImpl *map, const std::string &name,
                  const vtslibs::vts::SubMesh &m) :
     Resource(map, name)
@@ -80,7 +175,12 @@ GpuMesh::GpuMesh(MapImpl *map, const std::string &name,
     assert(m.facesTc.size() == m.faces.size() || m.facesTc.empty());
     assert(m.etc.size() == m.vertices.size() || m.etc.empty());
 
-    uint32 vertexSize = sizeof(vec3f);
+    // compact vertex layout:
+    //   position: 3x unsigned short (normalized, padded to 4 bytes)
+    //   internal uv: 2x unsigned short (normalized, optional)
+    //   external uv: 2x unsigned short (normalized, optional)
+    // the positions are in 0 .. 1 range, see quantizedToNorm
+    uint32 vertexSize = 4 * sizeof(uint16);
     if (m.tc.size())
         vertexSize += sizeof(vec2ui16);
     if (m.etc.size())
@@ -88,17 +188,17 @@ GpuMesh::GpuMesh(MapImpl *map, const std::string &name,
 
     GpuMeshSpec spec;
 
-#if 1 // indexed mesh
-
     { // vertex attributes
         uint32 offset = 0;
 
         { // positions
             spec.attributes[0].enable = true;
+            spec.attributes[0].type = GpuTypeEnum::UnsignedShort;
             spec.attributes[0].components = 3;
+            spec.attributes[0].normalized = true;
             spec.attributes[0].offset = offset;
             spec.attributes[0].stride = vertexSize;
-            offset += sizeof(vec3f);
+            offset += 4 * sizeof(uint16);
         }
 
         if (!m.tc.empty())
@@ -126,163 +226,69 @@ GpuMesh::GpuMesh(MapImpl *map, const std::string &name,
         assert(offset == vertexSize);
     }
 
-    if (m.tc.empty())
-    {
-        // external control
-        spec.verticesCount = m.vertices.size();
-        spec.vertices.allocate(spec.verticesCount * vertexSize);
-        spec.indicesCount = m.faces.size() * 3;
-        spec.indices.allocate(spec.indicesCount * sizeof(uint16));
-
-        { // indices
-            uint16 *io = (uint16*)spec.indices.data();
-            for (const auto &it : m.faces)
-            {
-                for (uint32 j = 0; j < 3; j++)
-                    *io++ = it[j];
-            }
-            assert((char*)io == spec.indices.dataEnd());
-        }
-
-        { // positions
-            vec3f *o = (vec3f*)(spec.vertices.data()
-                                + spec.attributes[0].offset);
-            for (const auto &it : m.vertices)
-            {
-                vec3 v = vecFromUblas<vec3>(it);
-                *o = v.cast<float>();
-                o = (vec3f*)((char*)o + vertexSize);
-            }
-        }
+    const auto &indexFaces = m.tc.empty() ? m.faces : m.facesTc;
+    spec.indicesCount = indexFaces.size() * 3;
+    spec.indices.allocate(spec.indicesCount * sizeof(uint16));
 
-        if (spec.attributes[2].enable)
-        { // external uvs
-            vec2ui16 *o = (vec2ui16*)(spec.vertices.data()
-                                      + spec.attributes[2].offset);
-            for (const auto &it : m.etc)
-            {
-                *o = vec2to2ui16(vecFromUblas<vec2f>(it));
-                o = (vec2ui16*)((char*)o + vertexSize);
-            }
+    { // indices
+        uint16 *io = (uint16*)spec.indices.data();
+        for (const auto &it : indexFaces)
+        {
+            for (uint32 j = 0; j < 3; j++)
+                *io++ = it[j];
         }
+        assert((char*)io == spec.indices.dataEnd());
     }
+
+    // source vertex for each output vertex
+    // internal control duplicates the vertices along uv seams
+    std::vector<uint32> sources;
+    if (m.tc.empty())
+        spec.verticesCount = m.vertices.size(); // external control
     else
     {
-        // internal control
         spec.verticesCount = m.tc.size();
-        spec.vertices.allocate(spec.verticesCount * vertexSize);
-        spec.indicesCount = m.facesTc.size() * 3;
-        spec.indices.allocate(spec.indicesCount * sizeof(uint16));
-
-        { // indices
-            uint16 *io = (uint16*)spec.indices.data();
-            for (const auto &it : m.facesTc)
-            {
-                for (uint32 j = 0; j < 3; j++)
-                    *io++ = it[j];
-            }
-            assert((char*)io == spec.indices.dataEnd());
-        }
-
-        // vertex data
-        char *ps = spec.vertices.data() + spec.attributes[0].offset;
-        char *is = spec.vertices.data() + spec.attributes[1].offset;
-        char *es = spec.vertices.data() + spec.attributes[2].offset;
+        sources.resize(spec.verticesCount, 0);
         for (uint32 fi = 0, fc = m.facesTc.size(); fi != fc; fi++)
         {
             for (uint32 vi = 0; vi < 3; vi++)
             {
-                uint32 oi = m.facesTc[fi][vi];
-                assert(oi < spec.verticesCount);
-                uint32 ii = m.faces[fi][vi];
-                assert(ii < m.vertices.size());
-                { // position
-                    vec3 v = vecFromUblas<vec3>(m.vertices[ii]);
-                    *(vec3f*)(ps + oi * vertexSize) = v.cast<float>();
-                }
-                { // internal uv
-                    vec2ui16 uv = vec2to2ui16(vecFromUblas<vec2f>(m.tc[oi]));
-                    *(vec2ui16*)(is + oi * vertexSize) = uv;
-                }
-                if (spec.attributes[2].enable)
-                { // external uv
-                    vec2ui16 uv = vec2to2ui16(vecFromUblas<vec2f>(m.etc[ii]));
-                    *(vec2ui16*)(es + oi * vertexSize) = uv;
-                }
+                assert(m.facesTc[fi][vi] < spec.verticesCount);
+                assert(m.faces[fi][vi] < m.vertices.size());
+                sources[m.facesTc[fi][vi]] = m.faces[fi][vi];
             }
         }
     }
 
-    faces = spec.indicesCount / 3;
-
-#else // indexed
-
-    spec.verticesCount = m.faces.size() * 3;
+    // vertex data, each vertex written exactly once
     spec.vertices.allocate(spec.verticesCount * vertexSize);
-    uint32 offset = 0;
-
-    { // vertices
-        spec.attributes[0].enable = true;
-        spec.attributes[0].components = 3;
-        spec.attributes[0].offset = offset;
-        spec.attributes[0].stride = vertexSize;
-        vec3f *b = (vec3f*)spec.vertices.data();
-        for (vtslibs::vts::Point3u32 f : m.faces)
-        {
-            for (uint32 j = 0; j < 3; j++)
-            {
-                vec3 p3 = vecFromUblas<vec3>(m.vertices[f[j]]);
-                *b = p3.cast<float>();
-                b = (vec3f*)((char*)b + vertexSize);
-            }
-        }
-        offset += sizeof(vec3f);
-    }
-
-    if (!m.tc.empty())
-    { // internal, separated
-        spec.attributes[1].enable = true;
-        spec.attributes[1].type = GpuTypeEnum::UnsignedShort;
-        spec.attributes[1].components = 2;
-        spec.attributes[1].normalized = true;
-        spec.attributes[1].offset = offset;
-        spec.attributes[1].stride = vertexSize;
-        vec2ui16 *b = (vec2ui16*)(spec.vertices.data() + offset);
-        for (vtslibs::vts::Point3u32 f : m.facesTc)
-        {
-            for (uint32 j = 0; j < 3; j++)
-            {
-                *b = vec2to2ui16(vecFromUblas<vec2f>(m.tc[f[j]]));
-                b = (vec2ui16*)((char*)b + vertexSize);
-            }
-        }
-        offset += sizeof(vec2ui16);
+    char *o = spec.vertices.data();
+    const uint32 internalOffset = spec.attributes[1].offset;
+    const uint32 externalOffset = spec.attributes[2].offset;
+    const bool internal = spec.attributes[1].enable;
+    const bool external = spec.attributes[2].enable;
+    for (uint32 oi = 0; oi < spec.verticesCount; oi++)
+    {
+        uint32 ii = sources.empty() ? oi : sources[oi];
+        writePosition(o, m.vertices[ii]);
+        if (internal)
+            writeUv(o + internalOffset, m.tc[oi]);
+        if (external)
+            writeUv(o + externalOffset, m.etc[ii]);
+        o += vertexSize;
     }
+    assert(o == spec.vertices.dataEnd());
 
-    if (!m.etc.empty())
-    { // external, interleaved
-        spec.attributes[2].enable = true;
-        spec.attributes[2].type = GpuTypeEnum::UnsignedShort;
-        spec.attributes[2].components = 2;
-        spec.attributes[2].normalized = true;
-        spec.attributes[2].offset = offset;
-        spec.attributes[2].stride = vertexSize;
-        vec2ui16 *b = (vec2ui16*)(spec.vertices.data() + offset);
-        for (vtslibs::vts::Point3u32 f : m.faces)
-        {
-            for (uint32 j = 0; j < 3; j++)
-            {
-                *b = vec2to2ui16(vecFromUblas<vec2f>(m.etc[f[j]]));
-                b = (vec2ui16*)((char*)b + vertexSize);
-            }
-        }
-        offset += sizeof(vec2ui16);
+    if (map->options.optimizeMeshes && spec.indicesCount > 0)
+    {
+        MapStatistics &st = map->statistics;
+        st.meshTrianglesOptimized += spec.indicesCount / 3;
+        st.meshCacheMissesOriginal += specCacheMisses<uint16>(spec);
+        spec.optimize();
+        st.meshCacheMissesOptimized += specCacheMisses<uint16>(spec);
     }
 
-    faces = spec.verticesCount / 3;
-
-#endif // indexed
-
+    faces = spec.indicesCount / 3;
     decodeData = std::make_shared<GpuMeshSpec>(std::move(spec));
 }
 
@@ -330,6 +336,9 @@ const mat4 findNormToPhys(const math::Extents3 &extents)
     return tr * sc;
 }
 
+// the gpu positions are quantized from -1 .. 1 to 0 .. 1
+const mat4 quantizedToNorm = translationMatrix(-1, -1, -1) * scaleMatrix(2);
+
 } // namespace
 
 MeshAggregate::MeshAggregate(MapImpl *map, const std::string &name) :
@@ -361,8 +370,9 @@ void MeshAggregate::decode()
                 <GpuMeshSpec>(gm->decodeData);
         MeshPart part;
         part.renderable = gm;
-        part.normToPhys = findNormToPhys(meshes[mi].extents)
+        mat4 normToPhys = findNormToPhys(meshes[mi].extents)
                 * scaleMatrix(map->options.renderTilesScale);
+        part.normToPhys = normToPhys * quantizedToNorm;
         part.internalUv = spec.attributes[1].enable;
         part.externalUv = spec.attributes[2].enable;
         part.textureLayer = m.textureLayer ? *m.textureLayer : 0;
@@ -387,7 +397,7 @@ void MeshAggregate::decode()
                 for (auto &v : msh.vertices)
                 {
                     v = vecToUblas<math::Point3>(
-                        vec4to3(vec4(part.normToPhys
+                        vec4to3(vec4(normToPhys
                             * vec3to4(vecFromUblas<vec3>(v), 1))));
                 }
 
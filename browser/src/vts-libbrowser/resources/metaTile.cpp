@@ -182,11 +182,8 @@ MetaNode generateMetaNode(const std::shared_ptr<Mapconfig> &m, const std::shared
         vec3 eu = vec2to3(fu, double(meta.geomExtents.z.min));
         vec3 ed = eu - el;
         for (uint32 i = 0; i < 4; i++)
-        {
-            vec3 f = lowerUpperCombine(i).cwiseProduct(ed) + el;
-            f = cnv->convert(f, srs, Srs::Physical);
-            cornersPhys[i] = f;
-        }
+            cornersPhys[i] = lowerUpperCombine(i).cwiseProduct(ed) + el;
+        cnv->convert(cornersPhys.data(), cornersPhys.data(), 4, srs, Srs::Physical);
         for (uint32 i = 4; i < 8; i++)
         {
             vec3 bottom = cornersPhys[i - 4];
@@ -197,15 +194,16 @@ MetaNode generateMetaNode(const std::shared_ptr<Mapconfig> &m, const std::shared
         // disks
         if (id.lod > 4 && !projected)
         {
-            vec2 sds2 = vec2((fu + fl) * 0.5);
-            vec3 sds = vec2to3(sds2, double(meta.geomExtents.z.min));
-            vec3 vn1 = cnv->convert(sds, srs, Srs::Physical);
-            node.diskNormalPhys = vn1.normalized();
-            node.diskHeightsPhys[0] = vn1.norm();
+            // center and corner
+            vec3 ds[2] = {
+                vec2to3(vec2((fu + fl) * 0.5), double(meta.geomExtents.z.min)),
+                vec2to3(fu, double(meta.geomExtents.z.min))
+            };
+            cnv->convert(ds, ds, 2, srs, Srs::Physical);
+            node.diskNormalPhys = ds[0].normalized();
+            node.diskHeightsPhys[0] = ds[0].norm();
             node.diskHeightsPhys[1] = node.diskHeightsPhys[0] + double(meta.geomExtents.z.max) - double(meta.geomExtents.z.min);
-            sds = vec2to3(fu, double(meta.geomExtents.z.min));
-            vec3 vc = cnv->convert(sds, srs, Srs::Physical);
-            node.diskHalfAngle = std::acos(dot(node.diskNormalPhys, vc.normalized()));
+            node.diskHalfAngle = std::acos(dot(node.diskNormalPhys, ds[1].normalized()));
         }
     }
     else
@@ -58,6 +58,49 @@ FetchTask::ResourceType BoundMetaTile::resourceType() const
     return FetchTask::ResourceType::BoundMetaTile;
 }
 
+NavTile::NavTile(MapImpl *map, const std::string &name) :
+    Resource(map, name)
+{}
+
+void NavTile::decode()
+{
+    Buffer buffer = std::move(fetch->reply.content);
+    Buffer out;
+    uint32 components = 0;
+    decodeImage(buffer, out, width, height, components);
+    if (width < 2 || height < 2 || components == 0)
+        LOGTHROW(err1, std::runtime_error)
+                << "nav tile has invalid resolution";
+    // only the first channel carries the heights
+    data.resize(width * height);
+    for (uint32 i = 0, e = width * height; i < e; i++)
+        data[i] = ((const uint8*)out.data())[i * components];
+    info.ramMemoryCost += sizeof(*this);
+    info.ramMemoryCost += data.size();
+}
+
+FetchTask::ResourceType NavTile::resourceType() const
+{
+    return FetchTask::ResourceType::NavTile;
+}
+
+double NavTile::sample(double u, double v) const
+{
+    assert(!data.empty());
+    // the first row is at the top
+    double x = clamp(u, 0, 1) * (width - 1);
+    double y = (1 - clamp(v, 0, 1)) * (height - 1);
+    uint32 x0 = std::min((uint32)x, width - 2);
+    uint32 y0 = std::min((uint32)y, height - 2);
+    double fx = x - x0;
+    double fy = y - y0;
+    const uint8 *r0 = data.data() + y0 * width + x0;
+    const uint8 *r1 = r0 + width;
+    double a = interpolate(double(r0[0]), double(r0[1]), fx);
+    double b = interpolate(double(r1[0]), double(r1[1]), fx);
+    return interpolate(a, b, fy) / 255;
+}
+
 ExternalBoundLayer::ExternalBoundLayer(MapImpl *map, const std::string &name)
     : Resource(map, name)
 {
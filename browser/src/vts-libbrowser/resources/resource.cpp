@@ -35,6 +35,7 @@ namespace vts
 FetchTaskImpl::FetchTaskImpl(const std::shared_ptr<Resource> &resource) : FetchTask(resource->name, resource->resourceType()), name(resource->name), map(resource->map), resource(resource)
 {
     reply.expires = -1;
+    host = FetchHosts::hostOf(query.url);
 }
 
 bool FetchTaskImpl::performAvailTest() const
@@ -34,8 +34,10 @@
 
 #include <optick.h>
 
+#include <cstdio>
 #include <thread>
 #include <chrono>
+#include <algorithm>
 
 namespace vts
 {
@@ -48,6 +50,32 @@ bool startsWith(const std::string &text, const std::string &start)
     return text.substr(0, start.length()) == start;
 }
 
+// formats the time as http date (rfc 7231), eg. Sun, 06 Nov 1994 08:49:37 GMT
+//   independent of locale and without the thread-unsafe std::gmtime
+std::string httpDate(sint64 time)
+{
+    static const char *const days[] = { "Thu", "Fri", "Sat", "Sun", "Mon", "Tue", "Wed" };
+    static const char *const months[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+    sint64 z = time / 86400;
+    sint64 s = time % 86400;
+    const char *day = days[z % 7];
+    // civil date from days since epoch
+    z += 719468;
+    sint64 era = z / 146097;
+    sint64 doe = z - era * 146097;
+    sint64 yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    sint64 doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    sint64 mp = (5 * doy + 2) / 153;
+    sint64 d = doy - (153 * mp + 2) / 5 + 1;
+    sint64 m = mp < 10 ? mp + 3 : mp - 9;
+    sint64 y = yoe + era * 400 + (m <= 2);
+    char buf[40];
+    snprintf(buf, sizeof(buf), "%s, %02d %s %04d %02d:%02d:%02d GMT", day,
+        (int)d, months[m - 1], (int)y,
+        (int)(s / 3600), (int)(s / 60 % 60), (int)(s % 60));
+    return buf;
+}
+
 } // namespace
 
 void Resources::saveCorruptedFile(const std::shared_ptr<Resource> &r)
@@ -87,7 +115,7 @@ void UploadData::process()
 // A FETCH THREAD
 ////////////////////////////
 
-CacheData::CacheData(FetchTaskImpl *task, bool availFailed) : buffer(task->reply.content.copy()), name(task->name), expires(task->reply.expires), availFailed(availFailed)
+CacheData::CacheData(FetchTaskImpl *task, bool availFailed) : buffer(task->reply.content.copy()), name(task->name), etag(task->reply.etag), expires(task->reply.expires), lastModified(task->reply.lastModified), availFailed(availFailed)
 {}
 
 void FetchTaskImpl::fetchDone()
@@ -96,9 +124,33 @@ void FetchTaskImpl::fetchDone()
     LOG(debug) << "Resource <" << name << "> finished downloading, " << "http code: " << reply.code << ", content type: <" << reply.contentType << ">, size: " << reply.content.size() << ", expires: " << reply.expires;
     assert(map);
     map->resources->downloads--;
+    map->resources->fetchHosts.finished(host,
+        std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - fetchStart).count(),
+        reply.content.size(), reply.code,
+        map->options.maxHostConcurrentDownloads,
+        map->options.adaptiveHostConcurrency);
     map->resources->queFetching.con.notify_one();
     Resource::State state = Resource::State::fetching;
 
+    // reuse the expired cache entry confirmed by the server
+    if (reply.code == 304 && revalidating)
+    {
+        LOG(debug) << "Resource <" << name << "> was not modified";
+        map->statistics.resourcesNotModified++;
+        map->resources->revalidationSavedBytes += staleContent.size();
+        reply.content = std::move(staleContent);
+        reply.code = 200;
+        if (reply.etag.empty())
+            reply.etag = staleEtag;
+        if (reply.lastModified < 0)
+            reply.lastModified = staleLastModified;
+        if (reply.expires == -1)
+            reply.expires = -2; // keep revalidating
+        if (staleAvailFailed)
+            state = Resource::State::availFail;
+    }
+
     // handle error or invalid codes
     if (reply.code >= 400 || reply.code < 200)
     {
@@ -134,12 +186,20 @@ void FetchTaskImpl::fetchDone()
         else
         {
             query.url.swap(reply.redirectUrl);
+            host = FetchHosts::hostOf(query.url);
             LOG(info1) << "Download of <" << name << "> redirected to <" << query.url << ">, http code " << reply.code;
             reply = Reply();
             state = Resource::State::initializing;
         }
     }
 
+    // the conditional request is repeated after redirection
+    if (state != Resource::State::initializing)
+    {
+        staleContent.free();
+        revalidating = false;
+    }
+
     // write to cache
     if ((state == Resource::State::availFail || state == Resource::State::fetching) && map->resources->queCacheWrite.estimateSize() < map->options.maxCacheWriteQueueLength)
     {
@@ -331,8 +391,13 @@ void Resources::cacheReadProcess(const std::shared_ptr<Resource> &r)
     if (!r->fetch)
         r->fetch = std::make_shared<FetchTaskImpl>(r);
     r->info.gpuMemoryCost = r->info.ramMemoryCost = 0;
+    r->fetch->staleContent.free();
+    r->fetch->revalidating = false;
+    r->fetch->query.headers.erase("If-None-Match");
+    r->fetch->query.headers.erase("If-Modified-Since");
     CacheData cd;
-    if (r->allowDiskCache() && (cd = cacheRead(r->name)).name == r->name)
+    if (r->allowDiskCache() && (cd = cacheRead(r->name)).name == r->name
+        && !cd.stale)
     {
         r->fetch->reply.expires = cd.expires;
         r->fetch->reply.content = std::move(cd.buffer);
@@ -374,6 +439,28 @@ void Resources::cacheReadProcess(const std::shared_ptr<Resource> &r)
     }
     else
     {
+        // configurations are never used from the disk cache directly,
+        //   but the stored validators may still spare the download
+        if (!r->allowDiskCache() && r->resourceType()
+            != FetchTask::ResourceType::AuthConfig)
+        {
+            cd = cacheRead(r->name);
+            cd.stale = true;
+        }
+        if (cd.stale && cd.name == r->name)
+        {
+            r->fetch->staleContent = std::move(cd.buffer);
+            r->fetch->staleEtag = cd.etag;
+            r->fetch->staleLastModified = cd.lastModified;
+            r->fetch->staleAvailFailed = cd.availFailed;
+            r->fetch->revalidating = true;
+            if (!cd.etag.empty())
+                r->fetch->query.headers["If-None-Match"] = cd.etag;
+            if (cd.lastModified > 0)
+                r->fetch->query.headers["If-Modified-Since"]
+                    = httpDate(cd.lastModified);
+            map->statistics.resourcesRevalidated++;
+        }
         r->state = Resource::State::fetchQueue;
         queFetching.push(r);
     }
@@ -390,14 +477,60 @@ void Resources::oneFetch(std::weak_ptr<Resource> w)
         return;
     r->state = Resource::State::fetching;
     r->map->resources->downloads++;
+    r->map->resources->fetchHosts.started(r->fetch->host);
     LOG(debug) << "Initializing fetch of <" << r->name << ">";
     r->fetch->query.headers["X-Vts-Client-Id"] = r->map->createOptions.clientId;
     if (r->map->auth)
         r->map->auth->authorize(r);
+    r->fetch->fetchStart = std::chrono::steady_clock::now();
     r->map->fetcher->fetch(r->fetch);
     r->map->statistics.resourcesDownloaded++;
 }
 
+// picks the resource with highest priority
+//   among the hosts that have not reached their concurrency limit
+bool Resources::fetchNext()
+{
+    OPTICK_EVENT();
+    fetchHosts.saturated(saturatedHosts,
+        map->options.maxHostConcurrentDownloads,
+        map->options.adaptiveHostConcurrency);
+    std::weak_ptr<Resource> best;
+    {
+        std::unique_lock<std::mutex> lock(queFetching.mut);
+        auto &q = queFetching.q;
+        if (q.empty() || queFetching.stop)
+            return false;
+        auto b = q.end();
+        float p = 0;
+        for (auto it = q.begin(); it != q.end(); it++)
+        {
+            std::shared_ptr<Resource> r = it->lock();
+            if (!r)
+            {
+                // released resources are discarded right away
+                b = it;
+                break;
+            }
+            if (r->fetch && std::find(saturatedHosts.begin(),
+                saturatedHosts.end(), r->fetch->host)
+                != saturatedHosts.end())
+                continue;
+            if (b == q.end() || r->priority > p)
+            {
+                b = it;
+                p = r->priority;
+            }
+        }
+        if (b == q.end())
+            return false; // all the hosts are busy
+        best = std::move(*b);
+        q.erase(b);
+    }
+    oneFetch(best);
+    return true;
+}
+
 void Resources::fetcherProcessorEntry()
 {
     OPTICK_THREAD("fetcher");
@@ -411,7 +544,7 @@ void Resources::fetcherProcessorEntry()
             map->fetcher->update();
         }
 
-        if (!(downloads < map->options.maxConcurrentDownloads && queFetching.runOne()))
+        if (!(downloads < map->options.maxConcurrentDownloads && fetchNext()))
         {
             using namespace std::chrono_literals;
             std::unique_lock<std::mutex> lock(queFetching.mut);
@@ -645,6 +778,11 @@ void Resources::renderUpdate()
         map->statistics.resourcesQueueDecode = queDecode.estimateSize();
         map->statistics.resourcesQueueAtmosphere = queAtmosphere.estimateSize();
         map->statistics.resourcesQueueUpload = queUpload.estimateSize();
+        map->statistics.revalidationSavedKB
+            = revalidationSavedBytes / 1024;
+        fetchHosts.statistics(map->statistics.hosts,
+            map->options.maxHostConcurrentDownloads,
+            map->options.adaptiveHostConcurrency);
     }
 
     // split workload into multiple render frames
@@ -34,9 +34,13 @@
 namespace vts
 {
 
-GpuTextureSpec::GpuTextureSpec(const Buffer &buffer)
+GpuTextureSpec::GpuTextureSpec(const Buffer &buffer, bool verticalFlip,
+                               uint32 maxResolution)
 {
-    decodeImage(buffer, this->buffer, width, height, components);
+    ImageDecodeOptions options;
+    options.verticalFlip = verticalFlip;
+    options.maxResolution = maxResolution;
+    decodeImage(buffer, this->buffer, width, height, components, options);
 }
 
 void GpuTextureSpec::verticalFlip()
@@ -78,8 +82,14 @@ GpuTexture::GpuTexture(MapImpl *map, const std::string &name) :
 void GpuTexture::decode()
 {
     LOG(info1) << "Decoding texture <" << name << ">";
-    std::shared_ptr<GpuTextureSpec> spec
-        = std::make_shared<GpuTextureSpec>(fetch->reply.content);
+    std::shared_ptr<GpuTextureSpec> spec = std::make_shared<GpuTextureSpec>();
+    ImageDecodeOptions decodeOptions;
+    if (allowDownscale)
+        decodeOptions.maxResolution = map->options.maxTextureResolution;
+    // the raw resources are extracted in the original orientation
+    decodeOptions.verticalFlip = !map->options.debugExtractRawResources;
+    decodeImage(fetch->reply.content, spec->buffer,
+        spec->width, spec->height, spec->components, decodeOptions);
     this->width = spec->width;
     this->height = spec->height;
     spec->filterMode = filterMode;
@@ -104,7 +114,13 @@ void GpuTexture::decode()
     }
 #endif
 
-    spec->verticalFlip();
+    if (!decodeOptions.verticalFlip)
+        spec->verticalFlip();
+
+    // let the application prepare the data in this thread
+    if (map->callbacks.decodeTexture)
+        map->callbacks.decodeTexture(*spec, name);
+
     decodeData = std::static_pointer_cast<void>(spec);
 }
 
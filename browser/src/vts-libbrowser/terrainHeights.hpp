@@ -0,0 +1,95 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TERRAINHEIGHTS_HPP_g5h4j8k2
+#define TERRAINHEIGHTS_HPP_g5h4j8k2
+
+#include <list>
+#include <memory>
+#include <unordered_map>
+
+#include <vts-libs/vts/nodeinfo.hpp>
+
+#include "include/vts-browser/math.hpp"
+#include "validity.hpp"
+
+namespace vts
+{
+
+class MapImpl;
+class NavTile;
+
+using TileId = vtslibs::registry::ReferenceFrame::Division::Node::Id;
+
+} // namespace vts
+
+#include "hashTileId.hpp"
+
+namespace vts
+{
+
+// terrain heights at arbitrary positions, independent of the cameras
+//   the navtiles are downloaded on demand
+//   recently used tiles are kept alive in lru
+class TerrainHeights : private Immovable
+{
+public:
+    explicit TerrainHeights(MapImpl *map);
+
+    // returns false while some of the data are still loading
+    //   results are nan where the terrain is not available
+    bool query(const vec3 *navPos, double *results, uint32 count, double resolution);
+
+    // called every render tick
+    void touch();
+
+private:
+    struct Tile
+    {
+        std::shared_ptr<NavTile> navtile;
+        vec2 ll, ur; // extents
+        double heightMin = 0;
+        double heightMax = 0;
+        // the tile answers queries for lods up to explored
+        //   or any deeper lod if there are no more data (leaf)
+        uint32 explored = 0;
+        bool leaf = false;
+        std::list<TileId>::iterator lruIt;
+    };
+
+    Validity queryOne(const vec3 &navPos, double resolution, double &result);
+    Validity findTile(const vtslibs::vts::NodeInfo &division, const vec2 &sds, uint32 desiredLod, Tile *&result);
+    Tile *findCached(const vtslibs::vts::NodeInfo &division, const vec2 &sds, uint32 desiredLod);
+    Tile *insert(const TileId &id, const Tile &tile);
+
+    MapImpl *const map = nullptr;
+    std::unordered_map<TileId, Tile> tiles;
+    std::list<TileId> lru; // most recently used first
+};
+
+} // namespace vts
+
+#endif
@@ -0,0 +1,196 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "meshOptimize.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace vts
+{
+
+template<class Index>
+uint32 vertexCacheMisses(const Index *indices, uint32 indicesCount,
+    uint32 verticesCount, uint32 cacheSize)
+{
+    // a vertex is in the cache if it was loaded
+    //   less than cacheSize misses ago
+    std::vector<uint32> loadedAt(verticesCount, 0);
+    uint32 misses = 0;
+    for (uint32 i = 0; i < indicesCount; i++)
+    {
+        Index v = indices[i];
+        assert(v < verticesCount);
+        if (loadedAt[v] == 0 || misses - loadedAt[v] >= cacheSize)
+            loadedAt[v] = ++misses;
+    }
+    return misses;
+}
+
+template<class Index>
+void optimizeVertexCache(Index *indices, uint32 indicesCount,
+    uint32 verticesCount, uint32 cacheSize)
+{
+    assert((indicesCount % 3) == 0);
+    const uint32 trianglesCount = indicesCount / 3;
+    if (trianglesCount < 2)
+        return;
+
+    // triangles adjacent to each vertex
+    std::vector<uint32> adjacencyOffsets(verticesCount + 1, 0);
+    for (uint32 i = 0; i < indicesCount; i++)
+        adjacencyOffsets[indices[i] + 1]++;
+    for (uint32 v = 0; v < verticesCount; v++)
+        adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+    std::vector<uint32> adjacency(indicesCount);
+    {
+        std::vector<uint32> fill(adjacencyOffsets.begin(),
+                                 adjacencyOffsets.end() - 1);
+        for (uint32 i = 0; i < indicesCount; i++)
+            adjacency[fill[indices[i]]++] = i / 3;
+    }
+
+    // number of not yet emitted triangles for each vertex
+    std::vector<uint32> live(verticesCount);
+    for (uint32 v = 0; v < verticesCount; v++)
+        live[v] = adjacencyOffsets[v + 1] - adjacencyOffsets[v];
+
+    std::vector<uint32> cacheTime(verticesCount, 0);
+    std::vector<bool> emitted(trianglesCount, false);
+    std::vector<uint32> deadEnd;
+    std::vector<uint32> candidates;
+    std::vector<Index> result;
+    result.reserve(indicesCount);
+    deadEnd.reserve(indicesCount);
+    uint32 time = cacheSize + 1;
+    uint32 cursor = 0;
+
+    const auto &skipDeadEnd = [&]() -> uint32
+    {
+        // recently used vertices first
+        while (!deadEnd.empty())
+        {
+            uint32 d = deadEnd.back();
+            deadEnd.pop_back();
+            if (live[d] > 0)
+                return d;
+        }
+        // any vertex with remaining triangles
+        while (cursor < verticesCount)
+        {
+            if (live[cursor] > 0)
+                return cursor;
+            cursor++;
+        }
+        return (uint32)-1;
+    };
+
+    uint32 fan = skipDeadEnd();
+    while (fan != (uint32)-1)
+    {
+        // emit all remaining triangles around the fanning vertex
+        candidates.clear();
+        for (uint32 a = adjacencyOffsets[fan],
+             ae = adjacencyOffsets[fan + 1]; a != ae; a++)
+        {
+            uint32 t = adjacency[a];
+            if (emitted[t])
+                continue;
+            emitted[t] = true;
+            for (uint32 j = 0; j < 3; j++)
+            {
+                Index v = indices[t * 3 + j];
+                result.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                if (time - cacheTime[v] > cacheSize)
+                    cacheTime[v] = time++;
+            }
+        }
+
+        // next fanning vertex is the one that will
+        //   most likely still be in the cache
+        uint32 best = (uint32)-1;
+        uint32 bestPriority = 0;
+        for (uint32 v : candidates)
+        {
+            if (live[v] == 0)
+                continue;
+            uint32 priority = 0;
+            if (time - cacheTime[v] + 2 * live[v] <= cacheSize)
+                priority = time - cacheTime[v];
+            if (best == (uint32)-1 || priority > bestPriority)
+            {
+                best = v;
+                bestPriority = priority;
+            }
+        }
+        fan = best == (uint32)-1 ? skipDeadEnd() : best;
+    }
+
+    assert(result.size() == indicesCount);
+    std::copy(result.begin(), result.end(), indices);
+}
+
+template<class Index>
+void optimizeVertexFetch(Index *indices, uint32 indicesCount,
+    uint32 verticesCount, std::vector<uint32> &newToOld)
+{
+    static const uint32 unused = (uint32)-1;
+    std::vector<uint32> oldToNew(verticesCount, unused);
+    newToOld.clear();
+    newToOld.reserve(verticesCount);
+    for (uint32 i = 0; i < indicesCount; i++)
+    {
+        uint32 &n = oldToNew[indices[i]];
+        if (n == unused)
+        {
+            n = newToOld.size();
+            newToOld.push_back(indices[i]);
+        }
+        indices[i] = (Index)n;
+    }
+    for (uint32 v = 0; v < verticesCount; v++)
+    {
+        if (oldToNew[v] == unused)
+            newToOld.push_back(v);
+    }
+    assert(newToOld.size() == verticesCount);
+}
+
+template uint32 vertexCacheMisses<uint16>(const uint16 *, uint32,
+    uint32, uint32);
+template uint32 vertexCacheMisses<uint32>(const uint32 *, uint32,
+    uint32, uint32);
+template void optimizeVertexCache<uint16>(uint16 *, uint32, uint32, uint32);
+template void optimizeVertexCache<uint32>(uint32 *, uint32, uint32, uint32);
+template void optimizeVertexFetch<uint16>(uint16 *, uint32, uint32,
+    std::vector<uint32> &);
+template void optimizeVertexFetch<uint32>(uint32 *, uint32, uint32,
+    std::vector<uint32> &);
+
+} // namespace vts
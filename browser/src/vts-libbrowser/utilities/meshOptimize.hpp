@@ -0,0 +1,61 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MESH_OPTIMIZE_H_ps8dnw4kf
+#define MESH_OPTIMIZE_H_ps8dnw4kf
+
+#include "../include/vts-browser/foundation.hpp"
+
+#include <vector>
+
+namespace vts
+{
+
+// size of the simulated post-transform vertex cache
+static const uint32 VertexCacheSize = 16;
+
+// number of vertex shader invocations with fifo cache of the given size
+// the average cache miss ratio (acmr) is misses / triangles
+template<class Index>
+uint32 vertexCacheMisses(const Index *indices, uint32 indicesCount,
+    uint32 verticesCount, uint32 cacheSize = VertexCacheSize);
+
+// reorders the triangles to improve the vertex cache locality
+//   (tipsify, Sander et al. 2007)
+template<class Index>
+void optimizeVertexCache(Index *indices, uint32 indicesCount,
+    uint32 verticesCount, uint32 cacheSize = VertexCacheSize);
+
+// renumbers the vertices in the order of their first use
+// newToOld receives the original index of each new vertex
+//   (unreferenced vertices are moved to the end)
+template<class Index>
+void optimizeVertexFetch(Index *indices, uint32 indicesCount,
+    uint32 verticesCount, std::vector<uint32> &newToOld);
+
+} // namespace vts
+
+#endif
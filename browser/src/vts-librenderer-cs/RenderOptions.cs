@@ -41,11 +41,15 @@ namespace vts
         [MarshalAs(UnmanagedType.U4)] public uint targetViewportW;
         [MarshalAs(UnmanagedType.U4)] public uint targetViewportH;
         [MarshalAs(UnmanagedType.U4)] public uint antialiasingSamples;
-        [MarshalAs(UnmanagedType.U4)] public uint renderGeodataDebug;
+        [MarshalAs(UnmanagedType.U4)] public uint debugGeodataMode;
+        [MarshalAs(UnmanagedType.U4)] public uint depthFeedbackDivisor;
         [MarshalAs(UnmanagedType.I1)] public bool renderAtmosphere;
-        [MarshalAs(UnmanagedType.I1)] public bool renderPolygonEdges;
-        [MarshalAs(UnmanagedType.I1)] public bool flatShading;
         [MarshalAs(UnmanagedType.I1)] public bool geodataHysteresis;
+        [MarshalAs(UnmanagedType.I1)] public bool geodataBatching;
+        [MarshalAs(UnmanagedType.I1)] public bool surfacesIndirect;
+        [MarshalAs(UnmanagedType.I1)] public bool colorRenderWithAlpha;
+        [MarshalAs(UnmanagedType.I1)] public bool debugFlatShading;
+        [MarshalAs(UnmanagedType.I1)] public bool debugWireframe;
         [MarshalAs(UnmanagedType.I1)] public bool debugDepthFeedback;
         [MarshalAs(UnmanagedType.I1)] public bool colorToTargetFrameBuffer;
         [MarshalAs(UnmanagedType.I1)] public bool colorToTexture;
@@ -27,6 +27,10 @@
 #include "renderer.hpp"
 
 #include <thread>
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <iomanip>
 
 #include <optick.h>
 
@@ -50,6 +54,8 @@ std::string Shader::preamble =
         "precision highp int;\n"
     ;
 
+std::string Shader::binaryCachePath;
+
 namespace privat
 {
 
@@ -83,6 +89,26 @@ void setDebugLabel(GLenum type, GLuint id, std::string name)
     glObjectLabel(type, id, name.length(), name.data());
 }
 
+// fnv-1a
+uint64 hashString(uint64 h, const std::string &s)
+{
+    for (char c : s)
+    {
+        h ^= (unsigned char)c;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+const char ProgramBinaryMagic[4] = { 'V', 'T', 'S', 'P' };
+
+struct ProgramBinaryHeader
+{
+    char magic[4];
+    uint32 format;
+    uint64 hash; // driver and sources
+};
+
 } // namespace
 
 Shader::Shader()
@@ -155,20 +181,52 @@ int Shader::loadShader(const std::string &source, int stage) const
 void Shader::load(const std::string &vertexShader,
                   const std::string &fragmentShader)
 {
+    OPTICK_EVENT();
     clear();
+    loadedFromCache = false;
+    const std::string vertexSource = preamble
+        + "#define VTS_STAGE_VERTEX\n"
+        + vertexShader;
+    const std::string fragmentSource = preamble
+        + "#define VTS_STAGE_FRAGMENT\n"
+        + fragmentShader;
+
+    // the binaries are valid for the same driver and sources only
+    uint64 hash = 14695981039346656037ull;
+    std::string cachePath;
+    if (programBinaries && !binaryCachePath.empty())
+    {
+        for (GLenum e : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+        {
+            const char *str = (const char *)glGetString(e);
+            hash = hashString(hash, str ? str : "");
+        }
+        hash = hashString(hash, vertexSource);
+        hash = hashString(hash, fragmentSource);
+        std::stringstream ss;
+        ss << binaryCachePath << "/" << std::hex << std::setw(16)
+            << std::setfill('0') << hash << ".bin";
+        cachePath = ss.str();
+        if (loadBinary(cachePath, hash))
+        {
+            setDebugId(debugId);
+            CHECK_GL("load shader program binary");
+            return;
+        }
+    }
+
     id = glCreateProgram();
     try
     {
-        GLuint v = loadShader(preamble
-            + "#define VTS_STAGE_VERTEX\n"
-            + vertexShader,
-            GL_VERTEX_SHADER);
-        GLuint f = loadShader(preamble
-            + "#define VTS_STAGE_FRAGMENT\n"
-            + fragmentShader,
-            GL_FRAGMENT_SHADER);
+        GLuint v = loadShader(vertexSource, GL_VERTEX_SHADER);
+        GLuint f = loadShader(fragmentSource, GL_FRAGMENT_SHADER);
         glAttachShader(id, v);
         glAttachShader(id, f);
+        if (!cachePath.empty())
+        {
+            glProgramParameteri(id,
+                GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
         glLinkProgram(id);
         glDeleteShader(v);
         glDeleteShader(f);
@@ -194,10 +252,70 @@ void Shader::load(const std::string &vertexShader,
         id = 0;
         throw;
     }
+    if (!cachePath.empty())
+        saveBinary(cachePath, hash);
     setDebugId(debugId);
     CHECK_GL("load shader program");
 }
 
+bool Shader::loadBinary(const std::string &path, uint64 hash)
+{
+    std::ifstream f(path, std::ios::binary);
+    if (!f)
+        return false;
+    std::vector<char> data((std::istreambuf_iterator<char>(f)),
+        std::istreambuf_iterator<char>());
+    ProgramBinaryHeader h;
+    if (data.size() <= sizeof(h))
+        return false;
+    memcpy(&h, data.data(), sizeof(h));
+    if (memcmp(h.magic, ProgramBinaryMagic, sizeof(h.magic)) != 0
+        || h.hash != hash)
+        return false;
+
+    id = glCreateProgram();
+    glProgramBinary(id, h.format, data.data() + sizeof(h),
+        data.size() - sizeof(h));
+    GLint status = 0;
+    glGetProgramiv(id, GL_LINK_STATUS, &status);
+    if (status != GL_TRUE)
+    {
+        // the driver refused the binary, the program is compiled again
+        while (glGetError() != GL_NO_ERROR);
+        glDeleteProgram(id);
+        id = 0;
+        return false;
+    }
+    loadedFromCache = true;
+    return true;
+}
+
+void Shader::saveBinary(const std::string &path, uint64 hash) const
+{
+    GLint len = 0;
+    glGetProgramiv(id, GL_PROGRAM_BINARY_LENGTH, &len);
+    if (len <= 0)
+        return;
+    ProgramBinaryHeader h;
+    memset(&h, 0, sizeof(h)); // initialize structure padding
+    memcpy(h.magic, ProgramBinaryMagic, sizeof(h.magic));
+    h.hash = hash;
+    Buffer b(sizeof(h) + len);
+    GLenum format = 0;
+    glGetProgramBinary(id, len, &len, &format, b.data() + sizeof(h));
+    h.format = format;
+    memcpy(b.data(), &h, sizeof(h));
+    b.resize(sizeof(h) + len);
+    try
+    {
+        writeLocalFileBuffer(path, b);
+    }
+    catch (...)
+    {
+        // the cache is optional
+    }
+}
+
 void Shader::loadInternal(const std::string &vertexName,
                   const std::string &fragmentName)
 {
@@ -273,6 +391,11 @@ uint32 Shader::getId() const
     return id;
 }
 
+bool Shader::getLoadedFromCache() const
+{
+    return loadedFromCache;
+}
+
 uint32 Shader::loadUniformLocations(const std::vector<const char *> &names)
 {
     bind();
@@ -303,7 +426,9 @@ Texture::Texture()
 
 void Texture::clear()
 {
-    if (id)
+    if (pooled)
+        pooled.reset(); // returns the texture to the pool
+    else if (id)
         glDeleteTextures(1, &id);
     id = 0;
 }
@@ -461,23 +586,139 @@ bool gpuTypeInteger(GpuTypeEnum type)
     }
 }
 
+class TextureAllocation : public privat::PoolAllocation
+{
+public:
+    TextureAllocation(const std::shared_ptr<TexturePool> &pool,
+        const TexturePool::Key &key, uint32 id, uint32 memory) :
+        pool(pool), key(key), id(id), memory(memory)
+    {}
+
+    ~TextureAllocation()
+    {
+        pool->release(key, id, memory);
+    }
+
+private:
+    const std::shared_ptr<TexturePool> pool;
+    const TexturePool::Key key;
+    const uint32 id;
+    const uint32 memory;
+};
+
+class MeshAllocation : public privat::PoolAllocation
+{
+public:
+    explicit MeshAllocation(const std::shared_ptr<MeshPool> &pool) :
+        pool(pool)
+    {}
+
+    ~MeshAllocation()
+    {
+        if (vboSize)
+            pool->vertices.release(vbo, vboOffset, vboSize);
+        if (vioSize)
+            pool->indices.release(vio, vioOffset, vioSize);
+    }
+
+    const std::shared_ptr<MeshPool> pool;
+    uint32 vbo = 0, vboOffset = 0, vboSize = 0;
+    uint32 vio = 0, vioOffset = 0, vioSize = 0;
+};
+
 } // namespace
 
 void Texture::load(ResourceInfo &info, vts::GpuTextureSpec &spec,
     const std::string &debugId)
 {
-    assert(spec.buffer.size() == spec.width * spec.height
+    load(info, spec, debugId, nullptr);
+}
+
+void Texture::load(ResourceInfo &info, vts::GpuTextureSpec &spec,
+    const std::string &debugId, const std::shared_ptr<TexturePool> &pool)
+{
+    bool compressed = compressedFormat(spec.internalFormat);
+    assert(compressed
+           || spec.buffer.size() == spec.width * spec.height
            * spec.components * gpuTypeSize(spec.type)
            || spec.buffer.size() == 0);
 
     clear();
-    glGenTextures(1, &id);
+
+    uint32 levels = spec.mipmaps.size() + 1;
+    TexturePool::Key key;
+    key.internalFormat = compressed ? spec.internalFormat
+                                    : findInternalFormat(spec);
+    key.width = spec.width;
+    key.height = spec.height;
+    key.levels = levels;
+
+    // reused textures keep their storage, only the data are replaced
+    bool reuse = false;
+    if (pool && spec.buffer.size() > 0)
+    {
+        id = pool->acquire(key);
+        reuse = id != 0;
+    }
+    if (!reuse)
+    {
+        glGenTextures(1, &id);
+        if (pool)
+            pool->created();
+    }
     glBindTexture(GL_TEXTURE_2D, id);
-    glTexImage2D(GL_TEXTURE_2D, 0, findInternalFormat(spec),
-                 spec.width, spec.height, 0,
-                 findFormat(spec), (GLenum)spec.type, spec.buffer.data());
+
+    uint32 memory = 0;
+    for (uint32 level = 0; level < levels; level++)
+    {
+        const Buffer &b = level ? spec.mipmaps[level - 1] : spec.buffer;
+        uint32 w = std::max(spec.width >> level, 1u);
+        uint32 h = std::max(spec.height >> level, 1u);
+        if (compressed && reuse)
+        {
+            glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, w, h,
+                spec.internalFormat, b.size(), b.data());
+        }
+        else if (compressed)
+        {
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, spec.internalFormat,
+                w, h, 0, b.size(), b.data());
+        }
+        else if (reuse)
+        {
+            glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, w, h,
+                findFormat(spec), (GLenum)spec.type, b.data());
+        }
+        else
+        {
+            glTexImage2D(GL_TEXTURE_2D, level, key.internalFormat,
+                w, h, 0, findFormat(spec), (GLenum)spec.type, b.data());
+        }
+        memory += b.size();
+    }
+    info.gpuMemoryCost += memory;
+    if (levels > 1)
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+
+    GpuTextureSpec::FilterMode minFilter = spec.filterMode;
+    bool generate = false;
+    switch (spec.filterMode)
+    {
+    case GpuTextureSpec::FilterMode::Nearest:
+    case GpuTextureSpec::FilterMode::Linear:
+        break;
+    default:
+        if (levels > 1)
+            break;
+        if (compressed)
+            minFilter = magFilter(spec.filterMode); // cannot generate mipmaps
+        else
+            generate = true;
+        break;
+    }
+
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
-        (GLenum)spec.filterMode);
+        (GLenum)minFilter);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER,
         (GLenum)magFilter(spec.filterMode));
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S,
@@ -492,21 +733,19 @@ void Texture::load(ResourceInfo &info, vts::GpuTextureSpec &spec,
                         maxAnisotropySamples);
     }
 
-    switch (spec.filterMode)
-    {
-    case GpuTextureSpec::FilterMode::Nearest:
-    case GpuTextureSpec::FilterMode::Linear:
-        break;
-    default:
+    if (generate)
         glGenerateMipmap(GL_TEXTURE_2D);
-        break;
+
+    if (pool)
+    {
+        pooled = std::make_unique<TextureAllocation>(
+            pool, key, id, memory);
     }
 
     grayscale = spec.components == 1;
     setDebugId(debugId);
     CHECK_GL("load texture");
     info.ramMemoryCost += sizeof(*this);
-    info.gpuMemoryCost += spec.buffer.size();
 }
 
 void Texture::setId(uint32 id)
@@ -535,7 +774,7 @@ void RenderContext::loadTexture(ResourceInfo &info, GpuTextureSpec &spec,
         enforceUsingMipMaps(spec.filterMode);
 
     auto r = std::make_shared<Texture>();
-    r->load(info, spec, debugId);
+    r->load(info, spec, debugId, impl->texturePool);
     info.userData = r;
 
     if (impl->options.callGlFinishAfterUploadingData)
@@ -545,16 +784,55 @@ void RenderContext::loadTexture(ResourceInfo &info, GpuTextureSpec &spec,
     }
 }
 
+void RenderContext::decodeTexture(GpuTextureSpec &spec,
+    const std::string &debugId)
+{
+    (void)debugId;
+    OPTICK_EVENT();
+
+    if (impl->options.enforceUsingMipMaps)
+        enforceUsingMipMaps(spec.filterMode);
+
+    // only plain 8-bit images are processed
+    if (spec.type != GpuTypeEnum::UnsignedByte || spec.internalFormat != 0
+        || !spec.mipmaps.empty() || spec.buffer.size() == 0)
+        return;
+
+    uint32 format = impl->options.decodeTextureCompression
+        ? chooseCompressedFormat(spec) : 0;
+
+    switch (spec.filterMode)
+    {
+    case GpuTextureSpec::FilterMode::Nearest:
+    case GpuTextureSpec::FilterMode::Linear:
+        break;
+    default:
+        // compressed textures need the mipmaps prepared here
+        if (impl->options.decodeTextureMipMaps || format)
+            generateMipmaps(spec);
+        break;
+    }
+
+    if (format)
+        compressTexture(spec, format);
+}
+
 Mesh::Mesh()
 {}
 
 void Mesh::clear()
 {
-    if (vbo)
-        glDeleteBuffers(1, &vbo);
-    if (vio)
-        glDeleteBuffers(1, &vio);
+    if (pooled)
+        pooled.reset(); // returns the ranges to the pool
+    else
+    {
+        if (vbo)
+            glDeleteBuffers(1, &vbo);
+        if (vio)
+            glDeleteBuffers(1, &vio);
+    }
     vbo = vio = 0;
+    vboOffset = vioOffset = 0;
 }
 
 Mesh::~Mesh()
@@ -565,11 +843,24 @@ Mesh::~Mesh()
 void Mesh::setDebugId(const std::string &id)
 {
     this->debugId = id;
+    if (pooled)
+        return; // the buffers are shared
     setDebugLabel(GL_BUFFER, vbo, debugId);
     setDebugLabel(GL_BUFFER, vio, debugId);
 }
 
 void Mesh::bind()
+{
+    bindAttributes(vboOffset);
+}
+
+void Mesh::bindChunk()
+{
+    assert(pooled);
+    bindAttributes(0);
+}
+
+void Mesh::bindAttributes(uint32 offset)
 {
     if (vbo)
     {
@@ -584,14 +875,14 @@ void Mesh::bind()
                 {
                     glVertexAttribIPointer(i,
                         a.components, (GLenum)a.type,
-                        a.stride, (void*)(intptr_t)a.offset);
+                        a.stride, (void*)(intptr_t)(offset + a.offset));
                 }
                 else
                 {
                     glVertexAttribPointer(i,
                         a.components, (GLenum)a.type,
                         a.normalized ? GL_TRUE : GL_FALSE,
-                        a.stride, (void*)(intptr_t)a.offset);
+                        a.stride, (void*)(intptr_t)(offset + a.offset));
                 }
             }
             else
@@ -610,7 +901,7 @@ void Mesh::dispatch()
 {
     if (spec.indicesCount > 0)
         glDrawElements((GLenum)spec.faceMode, spec.indicesCount,
-                       (GLenum)spec.indexMode, nullptr);
+                       (GLenum)spec.indexMode, (void*)(std::size_t)vioOffset);
     else
         glDrawArrays((GLenum)spec.faceMode, 0, spec.verticesCount);
     CHECK_GL("dispatch mesh");
@@ -620,7 +911,8 @@ void Mesh::dispatch(uint32 offset, uint32 count)
 {
     if (spec.indicesCount > 0)
         glDrawElements((GLenum)spec.faceMode, count, (GLenum)spec.indexMode,
-            (void*)(std::size_t)(gpuTypeSize(spec.indexMode) * offset));
+            (void*)(std::size_t)(vioOffset
+                + gpuTypeSize(spec.indexMode) * offset));
     else
         glDrawArrays((GLenum)spec.faceMode, offset, count);
     CHECK_GL("dispatch mesh");
@@ -634,7 +926,8 @@ void Mesh::dispatchWireframeSlow()
         for (uint32 i = 0; i < spec.indicesCount; i += 3)
         {
             glDrawElements(GL_LINE_LOOP, 3, (GLenum)spec.indexMode,
-                (void*)(std::size_t)(gpuTypeSize(spec.indexMode) * i));
+                (void*)(std::size_t)(vioOffset
+                    + gpuTypeSize(spec.indexMode) * i));
         }
     }
     else
@@ -648,17 +941,76 @@ void Mesh::dispatchWireframeSlow()
 
 void Mesh::load(ResourceInfo &info, GpuMeshSpec &specp,
     const std::string &debugId)
+{
+    load(info, specp, debugId, nullptr);
+}
+
+namespace
+{
+
+// vertex ranges are aligned to the stride
+//   so that they may be addressed by base vertex too
+uint32 vertexAlignment(const GpuMeshSpec &spec)
+{
+    uint32 stride = spec.attributes[0].stride;
+    if (!stride)
+        return 4;
+    uint32 a = stride;
+    while (a % 4)
+        a += stride;
+    return a;
+}
+
+} // namespace
+
+void Mesh::load(ResourceInfo &info, GpuMeshSpec &specp,
+    const std::string &debugId, const std::shared_ptr<MeshPool> &pool)
 {
     clear();
     spec = std::move(specp);
-    if (spec.verticesCount)
+
+    if (pool && spec.verticesCount)
+    {
+        auto a = std::make_unique<MeshAllocation>(pool);
+        bool ok = pool->vertices.allocate(spec.vertices.size(),
+            vertexAlignment(spec), a->vbo, a->vboOffset);
+        if (ok)
+            a->vboSize = spec.vertices.size();
+        if (ok && spec.indicesCount)
+        {
+            ok = pool->indices.allocate(spec.indices.size(),
+                4, a->vio, a->vioOffset);
+            if (ok)
+                a->vioSize = spec.indices.size();
+        }
+        if (ok)
+        {
+            vbo = a->vbo;
+            vboOffset = a->vboOffset;
+            glBindBuffer(GL_ARRAY_BUFFER, vbo);
+            glBufferSubData(GL_ARRAY_BUFFER, vboOffset,
+                spec.vertices.size(), spec.vertices.data());
+            if (spec.indicesCount)
+            {
+                vio = a->vio;
+                vioOffset = a->vioOffset;
+                glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vio);
+                glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, vioOffset,
+                    spec.indices.size(), spec.indices.data());
+            }
+            pooled = std::move(a);
+        }
+        // else the partial allocation is returned to the pool
+    }
+
+    if (spec.verticesCount && !pooled)
     {
         glGenBuffers(1, &vbo);
         glBindBuffer(GL_ARRAY_BUFFER, vbo);
         glBufferData(GL_ARRAY_BUFFER,
                  spec.vertices.size(), spec.vertices.data(), GL_STATIC_DRAW);
     }
-    if (spec.indicesCount)
+    if (spec.indicesCount && !pooled)
     {
         glGenBuffers(1, &vio);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vio);
@@ -683,13 +1035,33 @@ uint32 Mesh::getVio() const
     return vio;
 }
 
+uint32 Mesh::getVboOffset() const
+{
+    return vboOffset;
+}
+
+uint32 Mesh::getVioOffset() const
+{
+    return vioOffset;
+}
+
+bool Mesh::getPooled() const
+{
+    return !!pooled;
+}
+
+const GpuMeshSpec &Mesh::getSpec() const
+{
+    return spec;
+}
+
 void RenderContext::loadMesh(ResourceInfo &info, GpuMeshSpec &spec,
     const std::string &debugId)
 {
     OPTICK_EVENT();
 
     auto r = std::make_shared<Mesh>();
-    r->load(info, spec, debugId);
+    r->load(info, spec, debugId, impl->meshPool);
     info.userData = r;
 
     if (impl->options.callGlFinishAfterUploadingData)
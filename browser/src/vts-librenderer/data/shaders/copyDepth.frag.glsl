@@ -1,5 +1,6 @@
 
 uniform sampler2D texDepth;
+uniform int uniDivisor;
 
 out vec4 outDepth;
 
@@ -16,6 +17,6 @@ vec4 packFloatToVec4(float value)
 void main()
 {
     outDepth = packFloatToVec4(texelFetch(texDepth,
-        ivec2(gl_FragCoord) * 3, 0).r);
+        ivec2(gl_FragCoord) * uniDivisor, 0).r);
 }
 
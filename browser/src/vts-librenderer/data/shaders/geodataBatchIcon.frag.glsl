@@ -0,0 +1,14 @@
+
+uniform sampler2D texIcons;
+
+in vec2 varUv;
+in vec4 varColor;
+
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+    vec4 t = texture(texIcons, varUv);
+    outColor = varUv.x < 0.0 ? varColor : varColor * t;
+}
+
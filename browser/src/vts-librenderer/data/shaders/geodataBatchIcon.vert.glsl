@@ -0,0 +1,17 @@
+
+layout(location = 0) in vec4 inClip; // anchor position in clip space
+layout(location = 1) in vec4 inOffsetUv; // xy: ndc offset, zw: uv (negative = no texture)
+layout(location = 2) in vec4 inColor;
+
+out vec2 varUv;
+out vec4 varColor;
+
+void main()
+{
+    varUv = inOffsetUv.zw;
+    varColor = inColor;
+    gl_Position = inClip;
+    gl_Position.xy += inOffsetUv.xy * gl_Position.w;
+    cullingCorrection();
+}
+
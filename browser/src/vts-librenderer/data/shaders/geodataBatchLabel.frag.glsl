@@ -0,0 +1,21 @@
+
+uniform sampler2D texGlyphs;
+
+in vec2 varUv;
+flat in int varPlane;
+flat in vec4 varColor;
+flat in vec2 varOutline;
+
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+    vec4 t4 = texture(texGlyphs, varUv);
+    float t = t4[varPlane];
+    float c = varOutline[0];
+    float d = varOutline[1];
+    float a = smoothstep(c - d, c + d, t);
+    outColor = varColor;
+    outColor.a *= a;
+}
+
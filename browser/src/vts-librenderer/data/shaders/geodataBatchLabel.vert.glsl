@@ -0,0 +1,26 @@
+
+layout(location = 0) in vec4 inClip; // anchor position in clip space
+layout(location = 1) in vec4 inOffsetUv; // xy: ndc offset, zw: uv (+ plane index * 2)
+layout(location = 2) in vec4 inColor0;
+layout(location = 3) in vec4 inColor1;
+layout(location = 4) in vec4 inOutline;
+
+uniform int uniPass;
+
+out vec2 varUv;
+flat out int varPlane;
+flat out vec4 varColor;
+flat out vec2 varOutline;
+
+void main()
+{
+    varPlane = int(inOffsetUv.z) / 2;
+    varUv = inOffsetUv.zw;
+    varUv.x -= float(varPlane * 2);
+    varColor = uniPass == 0 ? inColor0 : inColor1;
+    varOutline = vec2(inOutline[uniPass], inOutline[uniPass + 2]);
+    gl_Position = inClip;
+    gl_Position.xy += inOffsetUv.xy * gl_Position.w;
+    cullingCorrection();
+}
+
@@ -3,6 +3,17 @@ uniform sampler2D texColor;
 uniform sampler2D texMask;
 uniform lowp sampler2DArray texBlueNoise;
 
+#ifdef VTS_INDIRECT
+
+flat in vec4 varUvClip;
+flat in vec4 varColor;
+flat in ivec4 varFlags;
+#define uniUvClip varUvClip
+#define uniColor varColor
+#define uniFlags varFlags
+
+#else
+
 layout(std140) uniform uboSurface
 {
     mat4 uniP;
@@ -13,6 +24,8 @@ layout(std140) uniform uboSurface
     ivec4 uniFlags; // mask, monochromatic, flat shading, uv source, lodBlendingWithDithering, ..., blendingCoverage, frameIndex
 };
 
+#endif
+
 in vec2 varUvTex;
 #ifdef VTS_NO_CLIP
 in vec2 varUvExternal;
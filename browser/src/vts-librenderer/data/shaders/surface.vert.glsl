@@ -1,4 +1,27 @@
 
+#ifdef VTS_INDIRECT
+
+layout(std140) uniform uboSurface
+{
+    mat4 uniP;
+};
+
+// per-draw data, 8 texels per draw (see SurfacesIndirect)
+uniform highp samplerBuffer texDraws;
+layout(location = 3) in uint inDrawIndex;
+
+mat4 uniMv;
+vec4 uniUvTrans;
+vec4 uniUvClip;
+vec4 uniColor;
+ivec4 uniFlags;
+
+flat out vec4 varUvClip;
+flat out vec4 varColor;
+flat out ivec4 varFlags;
+
+#else
+
 layout(std140) uniform uboSurface
 {
     mat4 uniP;
@@ -9,6 +32,8 @@ layout(std140) uniform uboSurface
     ivec4 uniFlags; // mask, monochromatic, flat shading, uv source, lodBlendingWithDithering, ..., blendingCoverage, frameIndex
 };
 
+#endif
+
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec2 inUvInternal;
 layout(location = 2) in vec2 inUvExternal;
@@ -33,6 +58,19 @@ bool getFlag(int i)
 
 void main()
 {
+#ifdef VTS_INDIRECT
+    int d = int(inDrawIndex) * 8;
+    uniMv = mat4(texelFetch(texDraws, d + 0), texelFetch(texDraws, d + 1),
+                 texelFetch(texDraws, d + 2), texelFetch(texDraws, d + 3));
+    uniUvTrans = texelFetch(texDraws, d + 4);
+    uniUvClip = texelFetch(texDraws, d + 5);
+    uniColor = texelFetch(texDraws, d + 6);
+    uniFlags = floatBitsToInt(texelFetch(texDraws, d + 7));
+    varUvClip = uniUvClip;
+    varColor = uniColor;
+    varFlags = uniFlags;
+#endif
+
 #ifdef VTS_NO_CLIP
     varUvExternal = inUvExternal;
 #else
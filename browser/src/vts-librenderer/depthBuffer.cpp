@@ -36,37 +36,183 @@ namespace vts { namespace renderer
 {
 
 DepthBuffer::DepthBuffer()
-    : conv{ identityMatrix4(), identityMatrix4() },
-    w{ 0,0 }, h{ 0,0 }, pbo{ 0,0 },
-    tw(0), th(0), fbo(0), tex(0), index(0)
+    : conv(identityMatrix4()), convInv(identityMatrix4()),
+    tw(0), th(0), fbo(0), tex(0), writeIndex(0), pendingCount(0)
 {
-    glGenBuffers(PboCount, pbo);
+    for (Slot &s : slots)
+        glGenBuffers(1, &s.pbo);
     glGenTextures(1, &tex);
     glGenFramebuffers(1, &fbo);
 }
 
 DepthBuffer::~DepthBuffer()
 {
+    for (Slot &s : slots)
+    {
+        if (s.fence)
+            glDeleteSync(s.fence);
+        glDeleteBuffers(1, &s.pbo);
+    }
     glDeleteFramebuffers(1, &fbo);
     glDeleteTextures(1, &tex);
-    glDeleteBuffers(PboCount, pbo);
 }
 
 const mat4 &DepthBuffer::getConv() const
 {
-    return conv[index];
+    return conv;
+}
+
+const mat4 &DepthBuffer::getConvInv() const
+{
+    return convInv;
+}
+
+void DepthBuffer::discard()
+{
+    for (Slot &s : slots)
+    {
+        if (s.fence)
+            glDeleteSync(s.fence);
+        s.fence = 0;
+    }
+    pendingCount = 0;
+    levels.clear();
+}
+
+void DepthBuffer::poll(uint32 frameIndex, RenderStatistics &stats)
+{
+    OPTICK_EVENT();
+
+    // fences signal in order, find the newest finished slot
+    uint32 finished = 0;
+    for (uint32 i = 0; i < pendingCount; i++)
+    {
+        Slot &s = slots[(writeIndex + PboCount - pendingCount + i) % PboCount];
+        assert(s.fence);
+        GLenum r = glClientWaitSync(s.fence, 0, 0);
+        if (r != GL_ALREADY_SIGNALED && r != GL_CONDITION_SATISFIED)
+            break;
+        finished = i + 1;
+    }
+    if (!finished)
+        return;
+
+    // older finished slots are superseded
+    for (uint32 i = 0; i < finished; i++)
+    {
+        Slot &s = slots[(writeIndex + PboCount - pendingCount) % PboCount];
+        glDeleteSync(s.fence);
+        s.fence = 0;
+        pendingCount--;
+        if (i + 1 == finished)
+        {
+            readback(s);
+            stats.depthReadbacks++;
+            stats.depthFeedbackLatency = frameIndex - s.frame;
+        }
+    }
+}
+
+void DepthBuffer::readback(Slot &s)
+{
+    OPTICK_EVENT("copy_pbo_to_cpu");
+
+    conv = s.conv;
+    convInv = conv.inverse();
+    levels.resize(1);
+    Level &l = levels[0];
+    l.w = s.w;
+    l.h = s.h;
+    uint32 cnt = s.w * s.h;
+    l.min.resize(cnt);
+    if (!cnt)
+        return;
+
+    // the pixels are float bits packed in rgba8
+    uint32 reqsiz = cnt * sizeof(float);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, s.pbo);
+#ifdef __EMSCRIPTEN__
+    // see https://github.com/emscripten-core/emscripten/issues/5861
+    // glGetBufferSubData(GL_PIXEL_PACK_BUFFER, 0, reqsiz, l.min.data());
+    EM_ASM_(
+    {
+        Module.ctx.getBufferSubData(Module.ctx.PIXEL_PACK_BUFFER, 0, HEAPU8.subarray($0, $0 + $1));
+    }, l.min.data(), reqsiz);
+#else
+    void *ptr = glMapBufferRange(GL_PIXEL_PACK_BUFFER,
+        0, reqsiz, GL_MAP_READ_BIT);
+    assert(ptr);
+    memcpy(l.min.data(), ptr, reqsiz);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+#endif
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    CHECK_GL("read the depth (pbo to cpu)");
+
+    l.max = l.min;
+    buildPyramid();
+}
+
+void DepthBuffer::buildPyramid()
+{
+    OPTICK_EVENT();
+
+    while (levels.back().w > 1 || levels.back().h > 1)
+    {
+        levels.emplace_back();
+        const Level &p = levels[levels.size() - 2];
+        Level &l = levels.back();
+        l.w = (p.w + 1) / 2;
+        l.h = (p.h + 1) / 2;
+        l.min.resize(l.w * l.h);
+        l.max.resize(l.w * l.h);
+        for (uint32 y = 0; y < l.h; y++)
+        {
+            uint32 y0 = y * 2 * p.w;
+            uint32 y1 = std::min(y * 2 + 1, p.h - 1) * p.w;
+            for (uint32 x = 0; x < l.w; x++)
+            {
+                uint32 x0 = x * 2;
+                uint32 x1 = std::min(x * 2 + 1, p.w - 1);
+                uint32 i = x + y * l.w;
+                l.min[i] = std::min(
+                    std::min(p.min[x0 + y0], p.min[x1 + y0]),
+                    std::min(p.min[x0 + y1], p.min[x1 + y1]));
+                l.max[i] = std::max(
+                    std::max(p.max[x0 + y0], p.max[x1 + y0]),
+                    std::max(p.max[x0 + y1], p.max[x1 + y1]));
+            }
+        }
+    }
 }
 
 void DepthBuffer::performCopy(uint32 sourceTexture,
     uint32 paramW, uint32 paramH,
-    const mat4 &storeConv)
+    uint32 divisor, const mat4 &storeConv,
+    uint32 frameIndex, RenderStatistics &stats)
 {
-    paramW /= 3;
-    paramH /= 3;
+    divisor = std::max(divisor, 1u);
+    paramW /= divisor;
+    paramH /= divisor;
+    if (paramW * paramH == 0)
+    {
+        discard();
+        return;
+    }
+
+    poll(frameIndex, stats);
+    stats.depthFeedbackWidth = paramW;
+    stats.depthFeedbackHeight = paramH;
+
+    // all slots are still in flight, do not wait for them
+    if (pendingCount == PboCount)
+    {
+        stats.depthReadbacksSkipped++;
+        return;
+    }
+
     glViewport(0, 0, paramW, paramH);
 
     // copy depth to texture (perform conversion)
-    if (paramW * paramH != 0)
     {
         OPTICK_EVENT("copy_depth_to_texture_with_conversion");
 
@@ -92,6 +238,7 @@ void DepthBuffer::performCopy(uint32 sourceTexture,
 
         glBindTexture(GL_TEXTURE_2D, sourceTexture);
         shaderCopyDepth->bind();
+        shaderCopyDepth->uniform(1, (int)divisor);
         meshQuad->bind();
         meshQuad->dispatch();
 
@@ -102,87 +249,107 @@ void DepthBuffer::performCopy(uint32 sourceTexture,
     {
         OPTICK_EVENT("copy_texture_to_pbo");
 
-        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo[index]);
-        if (w[index] != paramW || h[index] != paramH)
+        Slot &s = slots[writeIndex];
+        assert(!s.fence);
+        uint32 reqsiz = paramW * paramH * sizeof(float);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, s.pbo);
+        if (s.capacity < reqsiz)
         {
-            glBufferData(GL_PIXEL_PACK_BUFFER,
-                paramW * paramH * sizeof(float),
+            glBufferData(GL_PIXEL_PACK_BUFFER, reqsiz,
                 nullptr, GL_DYNAMIC_READ);
-            w[index] = paramW;
-            h[index] = paramH;
-        }
-
-        if (paramW * paramH != 0)
-        {
-            glReadPixels(0, 0, w[index], h[index],
-                GL_RGBA, GL_UNSIGNED_BYTE, 0);
+            s.capacity = reqsiz;
         }
+        glReadPixels(0, 0, paramW, paramH,
+            GL_RGBA, GL_UNSIGNED_BYTE, 0);
         glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        s.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        s.conv = storeConv;
+        s.w = paramW;
+        s.h = paramH;
+        s.frame = frameIndex;
+        writeIndex = (writeIndex + 1) % PboCount;
+        pendingCount++;
 
         CHECK_GL("read the depth (texture to pbo)");
     }
-
-    // copy gpu pbo to cpu buffer
-    {
-        OPTICK_EVENT("copy_pbo_to_cpu");
-
-        conv[index] = storeConv;
-        index = (index + 1) % PboCount;
-
-        uint32 reqsiz = w[index] * h[index] * sizeof(uint32);
-        if (!reqsiz)
-            return;
-        if (buffer.size() < reqsiz)
-            buffer.allocate(reqsiz);
-
-        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo[index]);
-#ifdef __EMSCRIPTEN__
-        // see https://github.com/emscripten-core/emscripten/issues/5861
-        // glGetBufferSubData(GL_PIXEL_PACK_BUFFER, 0, reqsiz, buffer.data());
-        EM_ASM_(
-        {
-            Module.ctx.getBufferSubData(Module.ctx.PIXEL_PACK_BUFFER, 0, HEAPU8.subarray($0, $0 + $1));
-        }, buffer.data(), reqsiz);
-#else
-        void *ptr = glMapBufferRange(GL_PIXEL_PACK_BUFFER,
-            0, reqsiz, GL_MAP_READ_BIT);
-        assert(ptr);
-        memcpy(buffer.data(), ptr, reqsiz);
-        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
-#endif
-        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
-
-        CHECK_GL("read the depth (pbo to cpu)");
-    }
 }
 
-double DepthBuffer::valuePix(uint32 x, uint32 y)
+double DepthBuffer::valuePix(uint32 x, uint32 y) const
 {
-    if (w[index] * h[index] == 0)
-        return nan1();
-    assert(x < w[index] && y < h[index]);
-
-    // convert uint32 to float depth
-    union U
-    {
-        uint32 u;
-        float f;
-    } u;
-
-    u.u = ((uint32*)buffer.data())[x + y * w[index]];
-    return u.f;
+    const Level &l = levels[0];
+    assert(x < l.w && y < l.h);
+    return l.min[x + y * l.w];
 }
 
-double DepthBuffer::value(double x, double y)
+double DepthBuffer::value(double x, double y) const
 {
+    if (levels.empty() || levels[0].w * levels[0].h == 0)
+        return nan1();
     if (x < -1 || x > 1 || y < -1 || y > 1)
         return nan1();
-    double v = valuePix((x * 0.5 + 0.5) * (w[index] - 1),
-        (y * 0.5 + 0.5) * (h[index] - 1));
+    const Level &l = levels[0];
+    double v = valuePix((x * 0.5 + 0.5) * (l.w - 1),
+        (y * 0.5 + 0.5) * (l.h - 1));
     if (v >= 1 - 1e-15)
         return nan1(); // far plane - no depth
     return v;
 }
 
+void DepthBuffer::values(const double *xy, uint32 count, double *out) const
+{
+    for (uint32 i = 0; i < count; i++)
+        out[i] = value(xy[i * 2 + 0], xy[i * 2 + 1]);
+}
+
+bool DepthBuffer::range(double x0, double y0, double x1, double y1,
+    double &dmin, double &dmax) const
+{
+    dmin = dmax = nan1();
+    if (levels.empty() || levels[0].w * levels[0].h == 0)
+        return false;
+    if (x0 > x1)
+        std::swap(x0, x1);
+    if (y0 > y1)
+        std::swap(y0, y1);
+    if (x1 < -1 || x0 > 1 || y1 < -1 || y0 > 1)
+        return false;
+
+    // pixels at level 0
+    const Level &l0 = levels[0];
+    const auto &pix = [](double v, uint32 size) -> uint32
+    {
+        v = std::max(-1.0, std::min(1.0, v));
+        return (uint32)((v * 0.5 + 0.5) * (size - 1));
+    };
+    uint32 px0 = pix(x0, l0.w), px1 = pix(x1, l0.w);
+    uint32 py0 = pix(y0, l0.h), py1 = pix(y1, l0.h);
+
+    // coarsest level touching at most 3x3 texels
+    uint32 li = 0;
+    while (li + 1 < levels.size()
+        && (px1 - px0 >= 2 || py1 - py0 >= 2))
+    {
+        px0 /= 2;
+        px1 /= 2;
+        py0 /= 2;
+        py1 /= 2;
+        li++;
+    }
+
+    const Level &l = levels[li];
+    float mi = 1, ma = 0;
+    for (uint32 y = py0; y <= py1; y++)
+    {
+        for (uint32 x = px0; x <= px1; x++)
+        {
+            mi = std::min(mi, l.min[x + y * l.w]);
+            ma = std::max(ma, l.max[x + y * l.w]);
+        }
+    }
+    dmin = mi;
+    dmax = ma;
+    return true;
+}
+
 } } // namespace vts renderer
 
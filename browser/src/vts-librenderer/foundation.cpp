@@ -46,6 +46,10 @@ namespace vts { namespace renderer
 
 uint32 maxAntialiasingSamples = 1;
 float maxAnisotropySamples = 0.f;
+uint32 uniformBufferOffsetAlignment = 256;
+bool textureCompressionS3tc = false;
+bool textureCompressionEtc2 = false;
+bool programBinaries = false;
 
 void checkGlImpl(const char *name)
 {
@@ -210,6 +214,75 @@ void loadGlFunctions(GLADloadproc functionLoader)
     maxAntialiasingSamples = 0;
     glGetIntegerv(GL_MAX_SAMPLES, (GLint*)&maxAntialiasingSamples);
 
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT,
+                  (GLint*)&uniformBufferOffsetAlignment);
+    if (uniformBufferOffsetAlignment == 0)
+        uniformBufferOffsetAlignment = 256;
+
+    bool arbProgramBinary = false;
+    {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; i++)
+        {
+            const char *e = (const char*)glGetStringi(GL_EXTENSIONS, i);
+            if (!e)
+                continue;
+            std::string n = e;
+            if (n.find("texture_compression_s3tc") != std::string::npos
+                || n.find("compressed_texture_s3tc") != std::string::npos)
+                textureCompressionS3tc = true;
+            // exact names, WEBGL_compressed_texture_etc1 has no etc2
+            if (n == "GL_ARB_ES3_compatibility"
+                || n == "WEBGL_compressed_texture_etc"
+                || n == "GL_WEBGL_compressed_texture_etc")
+                textureCompressionEtc2 = true;
+            if (n == "GL_ARB_get_program_binary")
+                arbProgramBinary = true;
+        }
+#ifdef VTSR_OPENGLES
+        textureCompressionEtc2 = true; // core in opengl es 3
+#endif
+    }
+
+#if !defined(VTSR_OPENGLES) && !defined(__EMSCRIPTEN__)
+    {
+        GLint major = 0, minor = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &major);
+        glGetIntegerv(GL_MINOR_VERSION, &minor);
+        if (major > 4 || (major == 4 && minor >= 3))
+            multiDrawElementsIndirect = (MultiDrawElementsIndirectProc)
+                functionLoader("glMultiDrawElementsIndirect");
+    }
+#endif
+
+    {
+#ifndef VTSR_OPENGLES
+        // opengl 4.1 is not covered by the loader (core in opengl es 3)
+        GLint major = 0, minor = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &major);
+        glGetIntegerv(GL_MINOR_VERSION, &minor);
+        if (arbProgramBinary || major > 4 || (major == 4 && minor >= 1))
+        {
+            glad_glGetProgramBinary = (PFNGLGETPROGRAMBINARYPROC)
+                functionLoader("glGetProgramBinary");
+            glad_glProgramBinary = (PFNGLPROGRAMBINARYPROC)
+                functionLoader("glProgramBinary");
+            glad_glProgramParameteri = (PFNGLPROGRAMPARAMETERIPROC)
+                functionLoader("glProgramParameteri");
+        }
+#else
+        (void)arbProgramBinary;
+#endif
+        GLint formats = 0;
+#ifndef __EMSCRIPTEN__
+        // not available in webgl
+        if (glGetProgramBinary && glProgramBinary && glProgramParameteri)
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+#endif
+        programBinaries = formats > 0;
+    }
+
     checkGlImpl("load gl extensions and attributes");
 
     vts::log(vts::LogLevel::info2, std::string("OpenGL vendor: ")
@@ -224,7 +297,13 @@ void loadGlFunctions(GLADloadproc functionLoader)
         std::stringstream ss;
         ss << "GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT: " << maxAnisotropySamples
             << ", GL_MAX_SAMPLES: " << maxAntialiasingSamples
-            << ", GL_KHR_debug: " << GLAD_GL_KHR_debug;
+            << ", GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT: "
+            << uniformBufferOffsetAlignment
+            << ", GL_KHR_debug: " << GLAD_GL_KHR_debug
+            << ", s3tc: " << textureCompressionS3tc
+            << ", etc2: " << textureCompressionEtc2
+            << ", multi draw indirect: " << !!multiDrawElementsIndirect
+            << ", program binaries: " << programBinaries;
         vts::log(vts::LogLevel::info1, ss.str());
     }
 }
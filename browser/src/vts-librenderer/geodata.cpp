@@ -24,6 +24,9 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <iterator>
+#include <algorithm>
+
 #include <vts-browser/celestial.hpp>
 
 #include <optick.h>
@@ -33,15 +36,14 @@
 namespace vts { namespace renderer
 {
 
-GeodataTile::GeodataTile() : renderer(nullptr), info(nullptr)
+GeodataTile::GeodataTile() : renderer(nullptr)
 {}
 
-void GeodataTile::load(RenderContextImpl *renderer, ResourceInfo &info,
+void GeodataTile::prepare(RenderContextImpl *renderer,
     GpuGeodataSpec &specp, const std::string &debugId)
 {
     this->debugId = debugId;
     this->spec = std::move(specp);
-    this->info = &info;
     this->renderer = renderer;
 
     model = rawToMat4(spec.model);
@@ -58,40 +60,76 @@ void GeodataTile::load(RenderContextImpl *renderer, ResourceInfo &info,
     {
     case GpuGeodataSpec::Type::PointFlat:
     case GpuGeodataSpec::Type::PointScreen:
-        loadPoints();
+        preparePoints();
         break;
     case GpuGeodataSpec::Type::LineFlat:
     case GpuGeodataSpec::Type::LineScreen:
-        loadLines();
+        prepareLines();
         break;
     case GpuGeodataSpec::Type::IconFlat:
     case GpuGeodataSpec::Type::IconScreen:
-        loadIcons();
+        prepareIcons();
         break;
     case GpuGeodataSpec::Type::LabelFlat:
-        loadLabelFlats();
+        prepareLabelFlats();
         break;
     case GpuGeodataSpec::Type::LabelScreen:
-        loadLabelScreens();
+        prepareLabelScreens();
         break;
     case GpuGeodataSpec::Type::Triangles:
-        loadTriangles();
+        prepareTriangles();
         break;
     default:
         throw std::invalid_argument("invalid geodata type");
     }
 
+    // intern hysteresis ids
+    hysteresisIds.reserve(spec.hysteresisIds.size());
+    for (const std::string &id : spec.hysteresisIds)
+        hysteresisIds.push_back(internHysteresisId(id));
+
     // free some memory
     std::vector<std::string>().swap(spec.texts);
+    std::vector<std::string>().swap(spec.hysteresisIds);
     std::vector<std::shared_ptr<void>>().swap(spec.fontCascade);
 
     // compute memory requirements
-    this->info->ramMemoryCost += getTotalPoints()
+    info.ramMemoryCost += getTotalPoints()
         * sizeof(decltype(spec.positions[0][0]));
-    this->info->ramMemoryCost += spec.iconCoords.size()
+    info.ramMemoryCost += spec.iconCoords.size()
         * sizeof(decltype(spec.iconCoords[0]));
-    this->info->ramMemoryCost += sizeof(spec) + sizeof(*this);
-    this->info = nullptr;
+    info.ramMemoryCost += hysteresisIds.size() * sizeof(uint64);
+    info.ramMemoryCost += sizeof(spec) + sizeof(*this);
+}
+
+void GeodataTile::upload(ResourceInfo &info)
+{
+    if (textureSpec)
+    {
+        texture = std::make_shared<Texture>();
+        texture->load(info, *textureSpec, debugId);
+        textureSpec.reset();
+    }
+
+    if (meshSpec)
+    {
+        mesh = std::make_shared<Mesh>();
+        mesh->load(info, *meshSpec, debugId);
+        meshSpec.reset();
+    }
+
+    if (uniformData.size())
+    {
+        uniform = std::make_unique<UniformBuffer>();
+        uniform->setDebugId(debugId);
+        uniform->bind();
+        uniform->load(uniformData, GL_STATIC_DRAW);
+        info.gpuMemoryCost += uniformData.size();
+        uniformData.free();
+    }
+
+    info.ramMemoryCost += this->info.ramMemoryCost;
+    info.gpuMemoryCost += this->info.gpuMemoryCost;
     renderer = nullptr;
 
     CHECK_GL("load geodata");
@@ -99,8 +137,8 @@ void GeodataTile::load(RenderContextImpl *renderer, ResourceInfo &info,
 
 void GeodataTile::addMemory(ResourceInfo &other)
 {
-    info->ramMemoryCost += other.ramMemoryCost;
-    info->gpuMemoryCost += other.gpuMemoryCost;
+    info.ramMemoryCost += other.ramMemoryCost;
+    info.gpuMemoryCost += other.gpuMemoryCost;
 }
 
 uint32 GeodataTile::getTotalPoints() const
@@ -141,6 +179,108 @@ void GeodataTile::copyPoints()
     }
 }
 
+uint64 internHysteresisId(const std::string &id)
+{
+    // 64 bit fnv-1a
+    //   no global table, collisions are practically impossible
+    uint64 h = 14695981039346656037ull;
+    for (char c : id)
+    {
+        h ^= (unsigned char)c;
+        h *= 1099511628211ull;
+    }
+    return h ? h : 1;
+}
+
+uint32 HysteresisTable::slot(uint64 id) const
+{
+    assert(!data.empty());
+    return (uint32)((id * 11400714819323198485ull) >> 32)
+        & (uint32)(data.size() - 1);
+}
+
+void HysteresisTable::rehash(uint32 capacity)
+{
+    assert((capacity & (capacity - 1)) == 0);
+    std::vector<Record> old;
+    old.swap(data);
+    data.resize(capacity);
+    for (Record &r : old)
+    {
+        if (!r.id)
+            continue;
+        uint32 i = slot(r.id);
+        while (data[i].id)
+            i = (i + 1) & (capacity - 1);
+        data[i] = std::move(r);
+    }
+}
+
+HysteresisTable::Record *HysteresisTable::find(uint64 id)
+{
+    assert(id);
+    if (data.empty())
+        return nullptr;
+    const uint32 mask = data.size() - 1;
+    for (uint32 i = slot(id); data[i].id; i = (i + 1) & mask)
+        if (data[i].id == id)
+            return &data[i];
+    return nullptr;
+}
+
+HysteresisTable::Record *HysteresisTable::insert(uint64 id)
+{
+    assert(id);
+    if ((count + 1) * 2 > data.size())
+        rehash(std::max<uint32>(data.size() * 2, 64));
+    const uint32 mask = data.size() - 1;
+    uint32 i = slot(id);
+    for (; data[i].id; i = (i + 1) & mask)
+        if (data[i].id == id)
+            return &data[i];
+    // the caller sets the id
+    count++;
+    return &data[i];
+}
+
+void HysteresisTable::erase(uint64 id)
+{
+    assert(id);
+    if (data.empty())
+        return;
+    const uint32 mask = data.size() - 1;
+    uint32 i = slot(id);
+    while (data[i].id != id)
+    {
+        if (!data[i].id)
+            return;
+        i = (i + 1) & mask;
+    }
+    // backward shift deletion (no tombstones)
+    uint32 j = i;
+    while (true)
+    {
+        j = (j + 1) & mask;
+        if (!data[j].id)
+            break;
+        uint32 k = slot(data[j].id);
+        // move j into the hole at i unless its home slot lies in (i, j]
+        if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+            continue;
+        data[i] = std::move(data[j]);
+        i = j;
+    }
+    data[i] = Record();
+    count--;
+}
+
+void HysteresisTable::clear()
+{
+    for (Record &r : data)
+        r = Record();
+    count = 0;
+}
+
 GeodataJob::GeodataJob(const std::shared_ptr<GeodataTile> &g,
     uint32 itemIndex)
     : g(g), labelOffset(0, 0), refPoint(nan2().cast<float>()),
@@ -233,6 +373,14 @@ bool RenderViewImpl::collides(const GeodataJob &a, const GeodataJob &b)
 bool RenderViewImpl::geodataTestVisibility(
     const float visibility[4],
     const vec3 &pos, const vec3f &up)
+{
+    return geodataTestVisibility(visibility, pos, up,
+        viewProj * vec3to4(pos, 1));
+}
+
+bool RenderViewImpl::geodataTestVisibility(
+    const float visibility[4],
+    const vec3 &pos, const vec3f &up, const vec4 &clip)
 {
     vec3 eye = rawToVec3(draws->camera.eye);
     double distance = length(vec3(eye - pos));
@@ -247,9 +395,8 @@ bool RenderViewImpl::geodataTestVisibility(
         && dot(normalize(vec3(eye - pos)).cast<float>(), up)
             < visibility[3])
         return false;
-    vec4 sp = viewProj * vec3to4(pos, 1);
     for (uint32 i = 0; i < 3; i++)
-        if (sp[i] < -sp[3] || sp[i] > sp[3])
+        if (clip[i] < -clip[3] || clip[i] > clip[3])
             return false; // near & far planes culling
     return true;
 }
@@ -402,6 +549,7 @@ void RenderViewImpl::renderGeodataQuad(const GeodataJob &job,
     context->shaderGeodataColor->bind();
     context->meshQuad->bind();
     context->meshQuad->dispatch();
+    statistics.geodataDrawCalls++;
 }
 
 void RenderViewImpl::bindUboView(const std::shared_ptr<GeodataTile> &g)
@@ -430,7 +578,7 @@ void RenderViewImpl::bindUboView(const std::shared_ptr<GeodataTile> &g)
     data.mv = mv.cast<float>();
     data.mvInv = mvInv.cast<float>();
 
-    useDisposableUbo(1, data)->setDebugId("UboViewData");
+    useDisposableUbo(1, data);
 }
 
 void RenderViewImpl::renderGeodata()
@@ -514,10 +662,10 @@ void RenderViewImpl::bindUboCamera()
     data.cameraParams = vec4f(width, height,
         draws->camera.viewExtent, 0);
 
-    useDisposableUbo(0, data)->setDebugId("uboGeodataCamera");
+    useDisposableUbo(0, data);
 }
 
-void RenderViewImpl::regenerateJobCommon(GeodataJob &j)
+void RenderViewImpl::regenerateJobCommon(GeodataJob &j, const vec4 &clip)
 {
     const auto &g = j.g;
 
@@ -534,7 +682,6 @@ void RenderViewImpl::regenerateJobCommon(GeodataJob &j)
     }
 
     // refPoint and depth
-    const vec4 clip = viewProj * vec3to4(j.worldPosition(), 1);
     const vec3 ndc = vec4to3(clip, true);
     j.refPoint = vec3to2(ndc).cast<float>();
     j.depth = ndc[2];
@@ -652,6 +799,13 @@ void RenderViewImpl::regenerateJobLabelScreen(GeodataJob &j)
 }
 
 bool RenderViewImpl::regenerateJob(GeodataJob &j)
+{
+    if (j.itemIndex == (uint32)-1)
+        return regenerateJob(j, nan4());
+    return regenerateJob(j, viewProj * vec3to4(j.worldPosition(), 1));
+}
+
+bool RenderViewImpl::regenerateJob(GeodataJob &j, const vec4 &clip)
 {
     switch (j.g->spec.type)
     {
@@ -669,7 +823,7 @@ bool RenderViewImpl::regenerateJob(GeodataJob &j)
 
     case GpuGeodataSpec::Type::IconScreen:
     {
-        regenerateJobCommon(j);
+        regenerateJobCommon(j, clip);
         regenerateJobIcon(j);
         regenerateJobStick(j);
         regenerateJobCollision(j);
@@ -677,13 +831,13 @@ bool RenderViewImpl::regenerateJob(GeodataJob &j)
 
     case GpuGeodataSpec::Type::LabelFlat:
     {
-        regenerateJobCommon(j);
+        regenerateJobCommon(j, clip);
         return regenerateJobLabelFlat(j);
     } break;
 
     case GpuGeodataSpec::Type::LabelScreen:
     {
-        regenerateJobCommon(j);
+        regenerateJobCommon(j, clip);
         regenerateJobLabelScreen(j);
         regenerateJobIcon(j);
         regenerateJobStick(j);
@@ -696,9 +850,73 @@ bool RenderViewImpl::regenerateJob(GeodataJob &j)
     return true;
 }
 
+void RenderViewImpl::generateJobsTile(const std::shared_ptr<GeodataTile> &g,
+    std::vector<GeodataJob> &jobs)
+{
+    switch (g->spec.type)
+    {
+    case GpuGeodataSpec::Type::Invalid:
+        throw std::invalid_argument("Invalid geodata type enum");
+
+    case GpuGeodataSpec::Type::PointFlat:
+    case GpuGeodataSpec::Type::PointScreen:
+    case GpuGeodataSpec::Type::LineFlat:
+    case GpuGeodataSpec::Type::LineScreen:
+    case GpuGeodataSpec::Type::Triangles:
+    {
+        // one job for entire tile
+        jobs.emplace_back(g, uint32(-1));
+    } break;
+
+    case GpuGeodataSpec::Type::IconFlat:
+    case GpuGeodataSpec::Type::LabelFlat:
+    case GpuGeodataSpec::Type::IconScreen:
+    case GpuGeodataSpec::Type::LabelScreen:
+    {
+        const uint32 cnt = g->points.size();
+        if (cnt == 0)
+            return;
+
+        // project all anchor points of the tile at once
+        static_assert(sizeof(Point) % sizeof(double) == 0,
+            "invalid point stride");
+        typedef Eigen::Map<const Eigen::Matrix<double, 3, Eigen::Dynamic>,
+            0, Eigen::OuterStride<sizeof(Point) / sizeof(double)>> Positions;
+        Positions world(g->points[0].worldPosition.data(), 3, cnt);
+        Eigen::Matrix<double, 4, Eigen::Dynamic> clip
+            = viewProj.leftCols<3>() * world;
+        clip.colwise() += viewProj.col(3);
+
+        // individual jobs for each icon/label
+        for (uint32 index = 0; index < cnt; index++)
+        {
+            GeodataJob j(g, index);
+            const vec4 c = clip.col(index);
+
+            if (!geodataTestVisibility(
+                g->spec.commonData.visibilities,
+                j.worldPosition(), j.worldUp(), c))
+                continue;
+
+            if (!geodataDepthVisibility(j.worldPosition(),
+                g->spec.commonData.depthVisibilityThreshold))
+                continue;
+
+            if (regenerateJob(j, c))
+                jobs.push_back(std::move(j));
+        }
+    } break;
+    }
+}
+
 void RenderViewImpl::generateJobs()
 {
-    geodataJobs.clear();
+    OPTICK_EVENT();
+
+    // gather the tiles
+    //   font textures must be requested on this thread
+    geodataJobsTiles.clear();
+    uint32 candidates = 0;
     for (const auto &t : draws->geodata)
     {
         std::shared_ptr<GeodataTile> g
@@ -712,48 +930,52 @@ void RenderViewImpl::generateJobs()
 
         switch (g->spec.type)
         {
-        case GpuGeodataSpec::Type::Invalid:
-            throw std::invalid_argument("Invalid geodata type enum");
-
-        case GpuGeodataSpec::Type::PointFlat:
-        case GpuGeodataSpec::Type::PointScreen:
-        case GpuGeodataSpec::Type::LineFlat:
-        case GpuGeodataSpec::Type::LineScreen:
-        case GpuGeodataSpec::Type::Triangles:
-        {
-            // one job for entire tile
-            geodataJobs.emplace_back(g, uint32(-1));
-        } break;
-
         case GpuGeodataSpec::Type::IconFlat:
         case GpuGeodataSpec::Type::LabelFlat:
         case GpuGeodataSpec::Type::IconScreen:
         case GpuGeodataSpec::Type::LabelScreen:
-        {
             if (!g->checkTextures())
                 continue;
+            candidates += g->points.size();
+            break;
+        default:
+            candidates++;
+            break;
+        }
 
-            // individual jobs for each icon/label
-            for (uint32 index = 0, indexEnd = g->points.size();
-                index < indexEnd; index++)
-            {
-                GeodataJob j(g, index);
-
-                if (!geodataTestVisibility(
-                    g->spec.commonData.visibilities,
-                    j.worldPosition(), j.worldUp()))
-                    continue;
+        geodataJobsTiles.push_back(std::move(g));
+    }
 
-                if (!geodataDepthVisibility(j.worldPosition(),
-                    g->spec.commonData.depthVisibilityThreshold))
-                    continue;
+    // generate the jobs, each tile is processed by single thread
+    //   into its own vector
+    const uint32 tilesCount = geodataJobsTiles.size();
+    if (geodataJobsPerTile.size() < tilesCount)
+        geodataJobsPerTile.resize(tilesCount);
+    const auto fnc = [&](uint32 i) {
+        generateJobsTile(geodataJobsTiles[i], geodataJobsPerTile[i]);
+    };
+    if (candidates < 500)
+    {
+        // not worth the synchronization
+        for (uint32 i = 0; i < tilesCount; i++)
+            fnc(i);
+    }
+    else
+        context->workers().parallelFor(tilesCount, fnc);
 
-                if (regenerateJob(j))
-                    geodataJobs.push_back(std::move(j));
-            }
-        } break;
-        }
+    // merge in the order of the tiles (deterministic)
+    std::size_t total = 0;
+    for (uint32 i = 0; i < tilesCount; i++)
+        total += geodataJobsPerTile[i].size();
+    geodataJobs.clear();
+    geodataJobs.reserve(total);
+    for (uint32 i = 0; i < tilesCount; i++)
+    {
+        auto &v = geodataJobsPerTile[i];
+        std::move(v.begin(), v.end(), std::back_inserter(geodataJobs));
+        v.clear();
     }
+    geodataJobsTiles.clear();
 }
 
 void RenderViewImpl::sortJobsByZIndexAndImportance()
@@ -882,51 +1104,61 @@ void RenderViewImpl::processJobsHysteresis()
         return;
     }
 
-    for (auto it = hysteresisJobs.begin(); it != hysteresisJobs.end(); )
+    const uint32 frame = ++hysteresisFrame;
+    auto &slots = hysteresisJobs.slots();
+
+    // fade out all
+    for (auto &r : slots)
     {
-        it->second.opacity -= elapsedTime
-            / it->second.g->spec.commonData.hysteresisDuration[1];
-        if (it->second.opacity < -0.5f)
-            it = hysteresisJobs.erase(it);
-        else
-            it++;
+        if (r.id)
+            r.opacity -= elapsedTime
+                / r.g->spec.commonData.hysteresisDuration[1];
     }
 
+    // update current jobs
     for (auto &it : geodataJobs)
     {
-        if (it.itemIndex == (uint32)-1 || it.g->spec.hysteresisIds.empty())
+        if (it.itemIndex == (uint32)-1 || it.g->hysteresisIds.empty())
             continue;
-        const std::string &id = it.g->spec.hysteresisIds[it.itemIndex];
-        auto hit = hysteresisJobs.find(id);
-        if (hit == hysteresisJobs.end())
-            it.opacity = -0.5f;
-        else
-        {
-            it.opacity = hit->second.opacity;
-            hysteresisJobs.erase(hit);
-        }
+        const uint64 id = it.g->hysteresisIds[it.itemIndex];
+        HysteresisTable::Record *r = hysteresisJobs.insert(id);
+        const bool duplicate = r->frame == frame;
+        it.opacity = r->id && !duplicate ? r->opacity : -0.5f;
         it.opacity +=
             + elapsedTime / it.g->spec.commonData.hysteresisDuration[0]
             + elapsedTime / it.g->spec.commonData.hysteresisDuration[1];
         it.opacity = std::min(it.opacity, 1.f);
+        if (duplicate)
+            continue; // first job with the id wins
+        r->id = id;
+        r->itemIndex = it.itemIndex;
+        r->frame = frame;
+        r->opacity = it.opacity;
+        if (r->g != it.g)
+            r->g = it.g;
     }
 
-    for (auto &it : hysteresisJobs)
+    // keep fading out jobs that were not generated this frame
+    hysteresisErase.clear();
+    for (auto &r : slots)
     {
-        if (it.second.opacity > 0.f)
+        if (!r.id || r.frame == frame)
+            continue;
+        if (r.opacity > 0.f)
         {
-            regenerateJob(it.second);
-            geodataJobs.push_back(std::move(it.second));
+            GeodataJob j(r.g, r.itemIndex);
+            j.opacity = r.opacity;
+            regenerateJob(j);
+            geodataJobs.push_back(std::move(j));
         }
+        else
+            hysteresisErase.push_back(r.id);
     }
-    hysteresisJobs.clear();
+    for (uint64 id : hysteresisErase)
+        hysteresisJobs.erase(id);
 
     geodataJobs.erase(std::remove_if(geodataJobs.begin(),
-        geodataJobs.end(), [&](GeodataJob &it) {
-        if (it.itemIndex == (uint32)-1 || it.g->spec.hysteresisIds.empty())
-            return false;
-        const std::string &id = it.g->spec.hysteresisIds[it.itemIndex];
-        hysteresisJobs.insert(std::make_pair(id, it));
+        geodataJobs.end(), [&](const GeodataJob &it) {
         return it.opacity <= 0;
     }), geodataJobs.end());
 }
@@ -968,6 +1200,7 @@ void RenderViewImpl::renderPointOrLine(const GeodataJob &job)
     glEnable(GL_STENCIL_TEST);
     msh->dispatch();
     glDisable(GL_STENCIL_TEST);
+    statistics.geodataDrawCalls++;
 }
 
 void RenderViewImpl::renderIcon(const GeodataJob &job)
@@ -988,13 +1221,14 @@ void RenderViewImpl::renderIcon(const GeodataJob &job)
     data.color[3] *= job.opacity;
     data.uvs = rawToVec4(job.g->spec.iconCoords[job.itemIndex].data());
 
-    useDisposableUbo(2, data)->setDebugId("UboIcon");
+    useDisposableUbo(2, data);
 
     ((Texture*)job.g->spec.bitmap.get())->bind();
 
     context->shaderGeodataIconScreen->bind();
     context->meshQuad->bind();
     context->meshQuad->dispatch();
+    statistics.geodataDrawCalls++;
 }
 
 void RenderViewImpl::renderLabelFlat(const GeodataJob &job)
@@ -1066,7 +1300,7 @@ void RenderViewImpl::renderLabelFlat(const GeodataJob &job)
 #else
         16 * sizeof(float) + 4 * sizeof(float) * t.coordinates.size() * 2
 #endif
-    )->setDebugId("UboLabelFlat");
+    );
 
     context->meshEmpty->bind();
     for (int pass = 0; pass < 2; pass++)
@@ -1077,6 +1311,7 @@ void RenderViewImpl::renderLabelFlat(const GeodataJob &job)
             w.texture->bind();
             context->meshEmpty->dispatch(
                 w.indicesStart, w.indicesCount);
+            statistics.geodataDrawCalls++;
         }
     }
 }
@@ -1113,7 +1348,7 @@ void RenderViewImpl::renderLabelScreen(const GeodataJob &job)
 #else
         20 * sizeof(float) + 4 * sizeof(float) * t.coordinates.size()
 #endif
-    )->setDebugId("UboLabelScreen");
+    );
 
     context->meshEmpty->bind();
     for (int pass = 0; pass < 2; pass++)
@@ -1124,16 +1359,315 @@ void RenderViewImpl::renderLabelScreen(const GeodataJob &job)
             w.texture->bind();
             context->meshEmpty->dispatch(
                 w.indicesStart, w.indicesCount);
+            statistics.geodataDrawCalls++;
         }
     }
 }
 
+GeodataBatch::~GeodataBatch()
+{
+    if (vboIcons)
+        glDeleteBuffers(1, &vboIcons);
+    if (vboGlyphs)
+        glDeleteBuffers(1, &vboGlyphs);
+    if (vio)
+        glDeleteBuffers(1, &vio);
+}
+
+bool GeodataBatch::empty() const
+{
+    return draws.empty();
+}
+
+uint32 GeodataBatch::quadsCount() const
+{
+    return (icons.size() + glyphs.size()) / 4;
+}
+
+GeodataBatch::IconVertex *GeodataBatch::addIcon(Texture *texture)
+{
+    Draw *d = draws.empty() ? nullptr : &draws.back();
+    if (!d || d->label || (texture && d->texture && d->texture != texture))
+    {
+        draws.push_back(Draw{ texture, (uint32)icons.size() / 4, 0,
+            false, false });
+        d = &draws.back();
+    }
+    if (!d->texture)
+        d->texture = texture;
+    d->count++;
+    icons.resize(icons.size() + 4);
+    return icons.data() + icons.size() - 4;
+}
+
+GeodataBatch::GlyphVertex *GeodataBatch::addGlyph(Texture *texture)
+{
+    Draw *d = draws.empty() ? nullptr : &draws.back();
+    if (!d || labelStart || !d->label || d->texture != texture)
+    {
+        draws.push_back(Draw{ texture, (uint32)glyphs.size() / 4, 0,
+            true, labelStart });
+        d = &draws.back();
+        labelStart = false;
+    }
+    d->count++;
+    glyphs.resize(glyphs.size() + 4);
+    return glyphs.data() + glyphs.size() - 4;
+}
+
+void GeodataBatch::beginLabel()
+{
+    labelStart = true;
+}
+
+void GeodataBatch::prepareIndices(uint32 quads)
+{
+    if (!vio)
+        glGenBuffers(1, &vio);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vio);
+    if (quads <= indicesQuads)
+        return;
+    uint32 capacity = std::max(indicesQuads, 256u);
+    while (capacity < quads)
+        capacity *= 2;
+    Buffer b(capacity * 6 * sizeof(uint32));
+    uint32 *ind = (uint32*)b.data();
+    for (uint32 q = 0; q < capacity; q++)
+    {
+        // 2--3
+        // |  |
+        // 0--1
+        uint32 base = q * 4;
+        *ind++ = base + 0;
+        *ind++ = base + 1;
+        *ind++ = base + 2;
+        *ind++ = base + 1;
+        *ind++ = base + 3;
+        *ind++ = base + 2;
+    }
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, b.size(), b.data(), GL_STATIC_DRAW);
+    indicesQuads = capacity;
+}
+
+template<class Vertex>
+void GeodataBatch::upload(const std::vector<Vertex> &vertices, uint32 &vbo)
+{
+    if (vertices.empty())
+        return;
+    if (!vbo)
+        glGenBuffers(1, &vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex),
+        vertices.data(), GL_STREAM_DRAW);
+}
+
+template<class Vertex>
+void GeodataBatch::bindAttributes(uint32 vbo)
+{
+    static_assert(sizeof(Vertex) % sizeof(vec4f) == 0, "invalid vertex");
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+
+    // all attributes are vec4
+    const uint32 attributes = sizeof(Vertex) / sizeof(vec4f);
+    for (uint32 i = 0; i < attributes; i++)
+    {
+        glEnableVertexAttribArray(i);
+        glVertexAttribPointer(i, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+            (void*)(std::size_t)(i * sizeof(vec4f)));
+    }
+    for (uint32 i = attributes; i < 5; i++)
+        glDisableVertexAttribArray(i);
+}
+
+void GeodataBatch::dispatch(const Draw &d)
+{
+    if (d.texture)
+        d.texture->bind();
+    glDrawElements(GL_TRIANGLES, d.count * 6, GL_UNSIGNED_INT,
+        (void*)(std::size_t)(d.first * 6 * sizeof(uint32)));
+}
+
+uint32 GeodataBatch::flush(RenderContextImpl *context)
+{
+    upload(icons, vboIcons);
+    upload(glyphs, vboGlyphs);
+    prepareIndices((uint32)(std::max(icons.size(), glyphs.size()) / 4));
+
+    uint32 calls = 0;
+    int bound = -1; // 0 = icons, 1 = labels
+    for (uint32 i = 0, e = draws.size(); i < e;)
+    {
+        // icons and sticks
+        if (!draws[i].label)
+        {
+            if (bound != 0)
+            {
+                bindAttributes<IconVertex>(vboIcons);
+                context->shaderGeodataBatchIcon->bind();
+                bound = 0;
+            }
+            dispatch(draws[i++]);
+            calls++;
+            continue;
+        }
+
+        // one label
+        if (bound != 1)
+        {
+            bindAttributes<GlyphVertex>(vboGlyphs);
+            context->shaderGeodataBatchLabel->bind();
+            bound = 1;
+        }
+        uint32 j = i + 1;
+        while (j < e && draws[j].label && !draws[j].labelStart)
+            j++;
+        for (int pass = 0; pass < 2; pass++)
+        {
+            context->shaderGeodataBatchLabel->uniform(0, pass);
+            for (uint32 k = i; k < j; k++)
+            {
+                dispatch(draws[k]);
+                calls++;
+            }
+        }
+        i = j;
+    }
+    glDisableVertexAttribArray(4);
+
+    icons.clear();
+    glyphs.clear();
+    draws.clear();
+    vpTile = nullptr;
+    CHECK_GL("flush geodata batch");
+    return calls;
+}
+
+namespace
+{
+
+void batchRect(GeodataBatch::IconVertex *v, const vec4f &clip,
+    const Rect &rect, const vec2f &refPoint,
+    const vec4f &uvs, const vec4f &color)
+{
+    // 2--3
+    // |  |
+    // 0--1
+    const vec2f a = rect.a - refPoint;
+    const vec2f b = rect.b - refPoint;
+    v[0].offsetUv = vec4f(a[0], a[1], uvs[0], uvs[1]);
+    v[1].offsetUv = vec4f(b[0], a[1], uvs[2], uvs[1]);
+    v[2].offsetUv = vec4f(a[0], b[1], uvs[0], uvs[3]);
+    v[3].offsetUv = vec4f(b[0], b[1], uvs[2], uvs[3]);
+    for (int i = 0; i < 4; i++)
+    {
+        v[i].clip = clip;
+        v[i].color = color;
+    }
+}
+
+} // namespace
+
+void RenderViewImpl::batchJob(const GeodataJob &job)
+{
+    GeodataBatch &b = *geodataBatch;
+    const auto &g = job.g;
+
+    if (b.vpTile != g.get())
+    {
+        b.vpTile = g.get();
+        b.vp = proj * depthOffsetCorrection(g) * view;
+    }
+    const vec4f clip = vec4(b.vp
+        * vec3to4(job.worldPosition(), 1)).cast<float>();
+    const uint32 quadsBefore = b.quadsCount();
+
+    // stick
+    if (job.stickRect.valid())
+    {
+        vec4f color = rawToVec4(g->spec.commonData.stick.color);
+        color[3] *= job.opacity;
+        batchRect(b.addIcon(nullptr), clip, job.stickRect,
+            job.refPoint, vec4f(-1, -1, -1, -1), color);
+    }
+
+    // icon
+    if ((g->spec.type == GpuGeodataSpec::Type::IconScreen
+        || g->spec.commonData.icon.scale > 0) && job.iconRect.valid())
+    {
+        vec4f color = rawToVec4(g->spec.commonData.icon.color);
+        color[3] *= job.opacity;
+        batchRect(b.addIcon((Texture*)g->spec.bitmap.get()), clip,
+            job.iconRect, job.refPoint,
+            rawToVec4(g->spec.iconCoords[job.itemIndex].data()), color);
+    }
+
+    // label
+    if (g->spec.type == GpuGeodataSpec::Type::LabelScreen)
+    {
+        const auto &t = g->texts[job.itemIndex];
+        const auto &ls = g->spec.unionData.labelScreen;
+        vec4f color[2] = { rawToVec4(ls.color2), rawToVec4(ls.color) };
+        color[0][3] *= job.opacity;
+        color[1][3] *= job.opacity;
+        const vec4f outline = fontOutline(t.size * options.textScale,
+            rawToVec4(ls.outline));
+        const float sc = options.textScale * 2;
+        const vec2f scale = vec2f(sc / width, sc / height);
+        b.beginLabel();
+        for (const auto &w : t.subtexts)
+        {
+            for (uint32 i = w.indicesStart / 6,
+                e = i + w.indicesCount / 6; i < e; i++)
+            {
+                GeodataBatch::GlyphVertex *v
+                    = b.addGlyph(w.texture.get());
+                for (int j = 0; j < 4; j++)
+                {
+                    const vec4f &c = t.coordinates[i * 4 + j];
+                    v[j].clip = clip;
+                    v[j].offsetUv = vec4f(
+                        job.labelOffset[0] + c[0] * scale[0],
+                        job.labelOffset[1] + c[1] * scale[1],
+                        c[2], c[3]);
+                    v[j].color[0] = color[0];
+                    v[j].color[1] = color[1];
+                    v[j].outline = outline;
+                }
+            }
+        }
+    }
+
+    statistics.geodataBatchedQuads += b.quadsCount() - quadsBefore;
+}
+
+void RenderViewImpl::flushBatch()
+{
+    if (!geodataBatch || geodataBatch->empty())
+        return;
+    statistics.geodataDrawCalls += geodataBatch->flush(context);
+}
+
 void RenderViewImpl::renderJobs()
 {
+    if (options.geodataBatching && !geodataBatch)
+        geodataBatch = std::make_shared<GeodataBatch>();
+
     for (const GeodataJob &job : geodataJobs)
     {
         const auto &g = job.g;
 
+        if (options.geodataBatching
+            && (g->spec.type == GpuGeodataSpec::Type::IconScreen
+            || g->spec.type == GpuGeodataSpec::Type::LabelScreen))
+        {
+            if (geodataTestVisibility(
+                g->spec.commonData.visibilities,
+                job.worldPosition(), job.worldUp()))
+                batchJob(job);
+            continue;
+        }
+        flushBatch();
+
         switch (g->spec.type)
         {
         case GpuGeodataSpec::Type::Invalid:
@@ -1218,12 +1752,14 @@ void RenderViewImpl::renderJobs()
                 glEnable(GL_STENCIL_TEST);
             glDepthMask(GL_TRUE);
             msh->dispatch();
+            statistics.geodataDrawCalls++;
             glDepthMask(GL_FALSE);
             if (stencil)
                 glDisable(GL_STENCIL_TEST);
         } break;
         }
     }
+    flushBatch();
     lastUboViewPointer = nullptr;
 }
 
@@ -1232,8 +1768,19 @@ void RenderContext::loadGeodata(ResourceInfo &info, GpuGeodataSpec &spec,
 {
     OPTICK_EVENT();
 
-    auto r = std::make_shared<GeodataTile>();
-    r->load(&*impl, info, spec, debugId);
+    std::shared_ptr<GeodataTile> r;
+    if (spec.userData)
+    {
+        // already prepared by decodeGeodata
+        r = std::static_pointer_cast<GeodataTile>(spec.userData);
+        spec.userData.reset();
+    }
+    else
+    {
+        r = std::make_shared<GeodataTile>();
+        r->prepare(&*impl, spec, debugId);
+    }
+    r->upload(info);
     info.userData = r;
 
     if (impl->options.callGlFinishAfterUploadingData)
@@ -1243,5 +1790,14 @@ void RenderContext::loadGeodata(ResourceInfo &info, GpuGeodataSpec &spec,
     }
 }
 
-} } // namespace vts renderer
+void RenderContext::decodeGeodata(GpuGeodataSpec &spec,
+    const std::string &debugId)
+{
+    OPTICK_EVENT();
 
+    auto r = std::make_shared<GeodataTile>();
+    r->prepare(&*impl, spec, debugId);
+    spec.userData = r;
+}
+
+} } // namespace vts renderer
@@ -27,6 +27,10 @@
 #ifndef GEODATA_HPP_erg546g4g14
 #define GEODATA_HPP_erg546g4g14
 
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
 #include <vts-browser/geodata.hpp>
 #include <vts-browser/cameraDraws.hpp>
 #include "renderer.hpp"
@@ -57,6 +61,78 @@ struct Text
     float size = -1;
 };
 
+struct TmpGlyph
+{
+    std::shared_ptr<Font> font;
+    vec2f position; // screen units
+    vec2f size; // screen units
+    vec2f offset; // font units
+    float advance; // font units
+    uint16 glyphIndex;
+    uint16 fontIndex; // index into the font cascade
+
+    TmpGlyph() : position(0, 0), offset(0, 0), advance(0),
+        glyphIndex(0), fontIndex(0)
+    {}
+};
+
+struct TmpLine
+{
+    std::vector<TmpGlyph> glyphs;
+    float width; // screen units
+
+    TmpLine() : width(0)
+    {}
+};
+
+// shaping (bidi, harfbuzz and font fallbacks) is expensive
+//   and the same texts (eg. street names) repeat in many tiles
+// the cache stores the shaped glyphs (before layout)
+//   keyed by the text and the font cascade
+class TextShapingCache
+{
+public:
+    explicit TextShapingCache(RenderContextImpl *context);
+    std::vector<TmpLine> shape(const std::string &text,
+        const std::vector<std::shared_ptr<Font>> &fontCascade);
+    void clear();
+
+private:
+    struct Key
+    {
+        std::string text;
+        std::vector<const Font *> fonts;
+        bool operator == (const Key &other) const;
+    };
+
+    struct KeyHash
+    {
+        std::size_t operator () (const Key &key) const;
+    };
+
+    struct Entry
+    {
+        // the fonts are not kept alive by the cache
+        //   expired fonts invalidate the entry
+        std::vector<std::weak_ptr<Font>> fonts;
+        std::vector<TmpLine> lines; // glyphs have no font pointers
+        std::list<const Key *>::iterator lruPosition;
+        uint32 memoryCost = 0;
+    };
+
+    void insert(Key &&key, const std::vector<std::shared_ptr<Font>> &fontCascade,
+        const std::vector<TmpLine> &lines);
+    void erase(std::unordered_map<Key, Entry, KeyHash>::iterator it);
+    void evict(uint64 limit);
+    void updateStatistics();
+
+    std::unordered_map<Key, Entry, KeyHash> entries;
+    std::list<const Key *> lru; // most recently used at front
+    std::mutex mut;
+    RenderContextImpl *const context;
+    uint64 memoryCost = 0;
+};
+
 struct Point
 {
     vec3 worldPosition;
@@ -71,7 +147,7 @@ public:
 
     GpuGeodataSpec spec;
     RenderContextImpl *renderer;
-    ResourceInfo *info;
+    ResourceInfo info; // memory accumulated while preparing
     mat4 model;
     mat4 modelInv;
 
@@ -79,27 +155,108 @@ public:
     std::shared_ptr<Texture> texture;
     std::unique_ptr<UniformBuffer> uniform;
 
+    // cpu data waiting for the upload
+    std::unique_ptr<GpuTextureSpec> textureSpec;
+    std::unique_ptr<GpuMeshSpec> meshSpec;
+    Buffer uniformData;
+
     std::vector<std::shared_ptr<Font>> fontCascade;
     std::vector<Text> texts;
 
     std::vector<Point> points;
+    std::vector<uint64> hysteresisIds; // interned spec.hysteresisIds
 
     GeodataTile();
-    void load(RenderContextImpl *renderer, ResourceInfo &info, GpuGeodataSpec &specp, const std::string &debugId);
+    // prepare does not touch opengl and may run in any thread
+    void prepare(RenderContextImpl *renderer, GpuGeodataSpec &specp, const std::string &debugId);
+    // upload creates the opengl objects from the prepared data
+    void upload(ResourceInfo &info);
     void addMemory(ResourceInfo &other);
     uint32 getTotalPoints() const;
     vec3f modelUp(const vec3f &modelPos);
     void copyPoints();
     void copyFonts();
-    void loadLines();
-    void loadPoints();
-    void loadLabelScreens();
-    void loadLabelFlats();
-    void loadIcons();
-    void loadTriangles();
+    void prepareLines();
+    void preparePoints();
+    void prepareLabelScreens();
+    void prepareLabelFlats();
+    void prepareIcons();
+    void prepareTriangles();
     bool checkTextures();
 };
 
+// screen space icons, sticks and labels of consecutive jobs
+//   collected into common vertex buffers
+//   and rendered with few draw calls grouped by texture
+class GeodataBatch : private Immovable
+{
+public:
+    struct IconVertex
+    {
+        vec4f clip; // anchor position in clip space
+        vec4f offsetUv; // ndc offset, uv (negative = no texture)
+        vec4f color;
+    };
+
+    struct GlyphVertex
+    {
+        vec4f clip; // anchor position in clip space
+        vec4f offsetUv; // ndc offset, uv (+ plane index * 2)
+        vec4f color[2]; // per pass
+        vec4f outline;
+    };
+
+    const GeodataTile *vpTile = nullptr;
+    mat4 vp; // view-projection with the depth offset of vpTile
+
+    ~GeodataBatch();
+    bool empty() const;
+    uint32 quadsCount() const;
+
+    // the quads are drawn in the order they were added
+    // only adjacent quads with the same texture share a draw call
+    // sticks have no texture and join any adjacent icons
+    IconVertex *addIcon(Texture *texture);
+    GlyphVertex *addGlyph(Texture *texture);
+
+    // glyphs of each label are drawn in two passes (outline, fill)
+    //   before the next label starts
+    void beginLabel();
+
+    // render and clear the batch
+    // returns the number of draw calls
+    uint32 flush(RenderContextImpl *context);
+
+private:
+    struct Draw
+    {
+        Texture *texture;
+        uint32 first; // quads
+        uint32 count; // quads
+        bool label;
+        bool labelStart;
+    };
+
+    template<class Vertex>
+    void upload(const std::vector<Vertex> &vertices, uint32 &vbo);
+    template<class Vertex>
+    void bindAttributes(uint32 vbo);
+    void prepareIndices(uint32 quads);
+    void dispatch(const Draw &d);
+
+    std::vector<IconVertex> icons; // four per quad, including sticks
+    std::vector<GlyphVertex> glyphs; // four per quad
+    std::vector<Draw> draws;
+    uint32 vboIcons = 0;
+    uint32 vboGlyphs = 0;
+    uint32 vio = 0;
+    uint32 indicesQuads = 0;
+    bool labelStart = false;
+};
+
+// nonzero integer identifier of a hysteresis id string
+uint64 internHysteresisId(const std::string &id);
+
 bool regenerateJobLabelFlat(const RenderViewImpl *rv, GeodataJob &j);
 void preDrawJobLabelFlat(const RenderViewImpl *rv, const GeodataJob &j, std::vector<vec3> &worldPos, float &scale);
 vec3 drawJobLabelFlatSingleDirection(const GeodataJob &j);
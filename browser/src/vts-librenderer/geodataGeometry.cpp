@@ -77,9 +77,17 @@ float oneMeterInModel(const mat4 &model, const mat4 &modelInv)
     return length(vec4to3(c)); // measure the change in model space
 }
 
+template<class T>
+Buffer structToBuffer(const T &data)
+{
+    Buffer b(sizeof(T));
+    memcpy(b.data(), &data, sizeof(T));
+    return b;
+}
+
 } // namespace
 
-void GeodataTile::loadLines()
+void GeodataTile::prepareLines()
 {
     uint32 totalPoints = getTotalPoints(); // example: 7
     uint32 linesCount = spec.positions.size(); // 2
@@ -182,8 +190,7 @@ void GeodataTile::loadLines()
         tex.filterMode = GpuTextureSpec::FilterMode::Nearest;
         tex.wrapMode = GpuTextureSpec::WrapMode::ClampToEdge;
         makeTextureMoreSquare(tex);
-        texture = std::make_shared<Texture>();
-        texture->load(*info, tex, debugId);
+        textureSpec = std::make_unique<GpuTextureSpec>(std::move(tex));
     }
 
     // prepare the mesh
@@ -193,8 +200,7 @@ void GeodataTile::loadLines()
         msh.indices = std::move(indBuffer);
         msh.indicesCount = indicesCount;
         msh.indexMode = GpuTypeEnum::UnsignedInt;
-        mesh = std::make_shared<Mesh>();
-        mesh->load(*info, msh, debugId);
+        meshSpec = std::make_unique<GpuMeshSpec>(std::move(msh));
     }
 
     // prepare UBO
@@ -217,15 +223,11 @@ void GeodataTile::loadLines()
             uboLineData.uniUnitsRadius[1]
                 *= oneMeterInModel(model, modelInv);
 
-        uniform = std::make_unique<UniformBuffer>();
-        uniform->setDebugId(debugId);
-        uniform->bind();
-        uniform->load(uboLineData, GL_STATIC_DRAW);
-        info->gpuMemoryCost += sizeof(uboLineData);
+        uniformData = structToBuffer(uboLineData);
     }
 }
 
-void GeodataTile::loadPoints()
+void GeodataTile::preparePoints()
 {
     uint32 totalPoints = getTotalPoints(); // example: 7
     uint32 trianglesCount = totalPoints * 2; // 14
@@ -280,8 +282,7 @@ void GeodataTile::loadPoints()
         tex.filterMode = GpuTextureSpec::FilterMode::Nearest;
         tex.wrapMode = GpuTextureSpec::WrapMode::ClampToEdge;
         makeTextureMoreSquare(tex);
-        texture = std::make_shared<Texture>();
-        texture->load(*info, tex, debugId);
+        textureSpec = std::make_unique<GpuTextureSpec>(std::move(tex));
     }
 
     // prepare the mesh
@@ -291,8 +292,7 @@ void GeodataTile::loadPoints()
         msh.indices = std::move(indBuffer);
         msh.indicesCount = indicesCount;
         msh.indexMode = GpuTypeEnum::UnsignedInt;
-        mesh = std::make_shared<Mesh>();
-        mesh->load(*info, msh, debugId);
+        meshSpec = std::make_unique<GpuMeshSpec>(std::move(msh));
     }
 
     // prepare UBO
@@ -315,22 +315,18 @@ void GeodataTile::loadPoints()
             uboPointData.uniUnitsRadius[1]
                 *= oneMeterInModel(model, modelInv);
 
-        uniform = std::make_unique<UniformBuffer>();
-        uniform->setDebugId(debugId);
-        uniform->bind();
-        uniform->load(uboPointData, GL_STATIC_DRAW);
-        info->gpuMemoryCost += sizeof(uboPointData);
+        uniformData = structToBuffer(uboPointData);
     }
 }
 
-void GeodataTile::loadIcons()
+void GeodataTile::prepareIcons()
 {
     assert(spec.iconCoords.size() == spec.positions.size());
     copyPoints();
-    info->ramMemoryCost += points.size() * sizeof(decltype(points[0]));
+    info.ramMemoryCost += points.size() * sizeof(decltype(points[0]));
 }
 
-void GeodataTile::loadTriangles()
+void GeodataTile::prepareTriangles()
 {
     // prepare mesh
     {
@@ -346,8 +342,7 @@ void GeodataTile::loadTriangles()
             for (const auto &it2 : it1)
                 for (float it : it2)
                     *f++ = it;
-        mesh = std::make_shared<Mesh>();
-        mesh->load(*info, msh, debugId);
+        meshSpec = std::make_unique<GpuMeshSpec>(std::move(msh));
     }
 
     // prepare UBO
@@ -366,11 +361,7 @@ void GeodataTile::loadTriangles()
         uboTriangleData.flags
                 = vec4si32((sint32)spec.unionData.triangles.style, 0, 0, 0);
 
-        uniform = std::make_unique<UniformBuffer>();
-        uniform->setDebugId(debugId);
-        uniform->bind();
-        uniform->load(uboTriangleData, GL_STATIC_DRAW);
-        info->gpuMemoryCost += sizeof(uboTriangleData);
+        uniformData = structToBuffer(uboTriangleData);
     }
 }
 
@@ -26,6 +26,7 @@
 
 #include <list>
 #include <map>
+#include <unordered_map>
 
 #include "geodata.hpp"
 #include "font.hpp"
@@ -41,28 +42,6 @@ namespace vts { namespace renderer
 namespace
 {
 
-struct TmpGlyph
-{
-    std::shared_ptr<Font> font;
-    vec2f position; // screen units
-    vec2f size; // screen units
-    vec2f offset; // font units
-    float advance; // font units
-    uint16 glyphIndex;
-
-    TmpGlyph() : position(0, 0), offset(0, 0), advance(0), glyphIndex(0)
-    {}
-};
-
-struct TmpLine
-{
-    std::vector<TmpGlyph> glyphs;
-    float width; // screen units
-
-    TmpLine() : width(0)
-    {}
-};
-
 struct BidiAlgorithm
 {
     SBAlgorithmRef algorithm;
@@ -244,6 +223,7 @@ TmpLine textRunToGlyphs(
         TmpGlyph g;
         g.font = fnt;
         g.glyphIndex = gi;
+        g.fontIndex = terminal ? 0 : fontIndex;
         g.advance = pos[i].x_advance / 64.f;
         g.offset = vec2f(pos[i].x_offset, pos[i].y_offset) / 64;
         line.glyphs.push_back(g);
@@ -567,8 +547,141 @@ float labelFlatScale(const RenderViewImpl *rv,
     return scale;
 }
 
+uint32 linesMemoryCost(const std::vector<TmpLine> &lines)
+{
+    uint32 r = lines.size() * sizeof(TmpLine);
+    for (const TmpLine &l : lines)
+        r += l.glyphs.size() * sizeof(TmpGlyph);
+    return r;
+}
+
 } // namespace
 
+TextShapingCache::TextShapingCache(RenderContextImpl *context)
+    : context(context)
+{}
+
+bool TextShapingCache::Key::operator == (const Key &other) const
+{
+    return fonts == other.fonts && text == other.text;
+}
+
+std::size_t TextShapingCache::KeyHash::operator () (const Key &key) const
+{
+    std::size_t r = std::hash<std::string>()(key.text);
+    for (const Font *f : key.fonts)
+        r ^= std::hash<const Font *>()(f) + 0x9e3779b9 + (r << 6) + (r >> 2);
+    return r;
+}
+
+std::vector<TmpLine> TextShapingCache::shape(const std::string &text,
+    const std::vector<std::shared_ptr<Font>> &fontCascade)
+{
+    uint64 limit = uint64(context->options.textShapingCacheMemoryKB) * 1024;
+    if (limit == 0)
+        return textToGlyphs(text, fontCascade);
+
+    Key key;
+    key.text = text;
+    key.fonts.reserve(fontCascade.size());
+    for (const auto &f : fontCascade)
+        key.fonts.push_back(f.get());
+
+    {
+        std::lock_guard<std::mutex> lock(mut);
+        auto it = entries.find(key);
+        if (it != entries.end())
+        {
+            Entry &e = it->second;
+            bool valid = true;
+            for (const auto &f : e.fonts)
+                valid = valid && !f.expired();
+            if (valid)
+            {
+                lru.splice(lru.begin(), lru, e.lruPosition);
+                std::vector<TmpLine> lines = e.lines;
+                for (TmpLine &l : lines)
+                    for (TmpGlyph &g : l.glyphs)
+                        g.font = fontCascade[g.fontIndex];
+                context->statistics.textShapingCacheHits++;
+                return lines;
+            }
+            erase(it);
+        }
+        context->statistics.textShapingCacheMisses++;
+    }
+
+    // the shaping itself runs without the lock
+    std::vector<TmpLine> lines = textToGlyphs(text, fontCascade);
+    insert(std::move(key), fontCascade, lines);
+    return lines;
+}
+
+void TextShapingCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mut);
+    entries.clear();
+    lru.clear();
+    memoryCost = 0;
+    updateStatistics();
+}
+
+void TextShapingCache::insert(Key &&key,
+    const std::vector<std::shared_ptr<Font>> &fontCascade,
+    const std::vector<TmpLine> &lines)
+{
+    Entry e;
+    e.fonts.reserve(fontCascade.size());
+    for (const auto &f : fontCascade)
+        e.fonts.push_back(f);
+    e.lines = lines;
+    for (TmpLine &l : e.lines)
+        for (TmpGlyph &g : l.glyphs)
+            g.font.reset();
+    e.memoryCost = sizeof(Entry) + sizeof(Key) + 2 * key.text.size()
+        + key.fonts.size() * (sizeof(const Font *) + sizeof(e.fonts[0]))
+        + linesMemoryCost(lines);
+
+    std::lock_guard<std::mutex> lock(mut);
+    uint64 limit = uint64(context->options.textShapingCacheMemoryKB) * 1024;
+    if (e.memoryCost > limit / 2)
+        return;
+    auto res = entries.emplace(std::move(key), std::move(e));
+    if (!res.second)
+        return; // another thread was faster
+    Entry &entry = res.first->second;
+    lru.push_front(&res.first->first);
+    entry.lruPosition = lru.begin();
+    memoryCost += entry.memoryCost;
+    evict(limit);
+    updateStatistics();
+}
+
+void TextShapingCache::erase(
+    std::unordered_map<Key, Entry, KeyHash>::iterator it)
+{
+    memoryCost -= it->second.memoryCost;
+    lru.erase(it->second.lruPosition);
+    entries.erase(it);
+    updateStatistics();
+}
+
+void TextShapingCache::evict(uint64 limit)
+{
+    while (memoryCost > limit && !lru.empty())
+    {
+        auto it = entries.find(*lru.back());
+        assert(it != entries.end());
+        erase(it);
+    }
+}
+
+void TextShapingCache::updateStatistics()
+{
+    context->statistics.textShapingCacheEntries = entries.size();
+    context->statistics.textShapingCacheMemoryKB = memoryCost / 1024;
+}
+
 void GeodataTile::copyFonts()
 {
     fontCascade.reserve(spec.fontCascade.size());
@@ -576,7 +689,7 @@ void GeodataTile::copyFonts()
         fontCascade.push_back(std::static_pointer_cast<Font>(i));
 }
 
-void GeodataTile::loadLabelScreens()
+void GeodataTile::prepareLabelScreens()
 {
     assert(spec.texts.size() == spec.positions.size());
     copyPoints();
@@ -585,7 +698,7 @@ void GeodataTile::loadLabelScreens()
     float align = numericAlign(spec.unionData.labelScreen.textAlign);
     for (uint32 i = 0, e = spec.texts.size(); i != e; i++)
     {
-        std::vector<TmpLine> lines = textToGlyphs(
+        std::vector<TmpLine> lines = renderer->textShapingCache->shape(
             spec.texts[i], fontCascade);
         vec2f originSize = textLayout(
             spec.unionData.labelScreen.size,
@@ -594,14 +707,14 @@ void GeodataTile::loadLabelScreens()
         t.size = spec.unionData.labelScreen.size;
         t.collision = textCollision(lines);
         t.originSize = originSize;
-        info->ramMemoryCost += t.coordinates.size() * sizeof(vec4f);
-        info->ramMemoryCost += t.subtexts.size() * sizeof(Subtext);
+        info.ramMemoryCost += t.coordinates.size() * sizeof(vec4f);
+        info.ramMemoryCost += t.subtexts.size() * sizeof(Subtext);
         texts.push_back(std::move(t));
     }
-    info->ramMemoryCost += texts.size() * sizeof(decltype(texts[0]));
+    info.ramMemoryCost += texts.size() * sizeof(decltype(texts[0]));
 }
 
-void GeodataTile::loadLabelFlats()
+void GeodataTile::prepareLabelFlats()
 {
     assert(spec.texts.size() == spec.positions.size());
     copyFonts();
@@ -609,7 +722,7 @@ void GeodataTile::loadLabelFlats()
     for (uint32 i = 0, e = spec.texts.size(); i != e; i++)
     {
         assert(spec.positions[i].size() > 1); // line must have at least two points
-        std::vector<TmpLine> lines = textToGlyphs(
+        std::vector<TmpLine> lines = renderer->textShapingCache->shape(
             spec.texts[i], fontCascade);
         float size = spec.unionData.labelFlat.units
             == GpuGeodataSpec::Units::Meters
@@ -619,11 +732,11 @@ void GeodataTile::loadLabelFlats()
         Text t = generateTexts(lines);
         t.size = size;
         textLinePositions(this, spec.positions[i], t);
-        info->ramMemoryCost += t.coordinates.size() * sizeof(vec4f);
-        info->ramMemoryCost += t.subtexts.size() * sizeof(Subtext);
+        info.ramMemoryCost += t.coordinates.size() * sizeof(vec4f);
+        info.ramMemoryCost += t.subtexts.size() * sizeof(Subtext);
         texts.push_back(std::move(t));
     }
-    info->ramMemoryCost += texts.size() * sizeof(decltype(texts[0]));
+    info.ramMemoryCost += texts.size() * sizeof(decltype(texts[0]));
     assert(points.size() == spec.positions.size());
 }
 
@@ -29,6 +29,7 @@
 
 #include <string>
 #include <vector>
+#include <memory>
 
 #include <vts-browser/resources.hpp>
 
@@ -37,6 +38,9 @@
 namespace vts { namespace renderer
 {
 
+class TexturePool;
+class MeshPool;
+
 namespace privat
 {
 
@@ -51,6 +55,14 @@ private:
 #endif
 };
 
+// gpu memory owned by a pool
+// it is returned to the pool when destroyed
+class PoolAllocation
+{
+public:
+    virtual ~PoolAllocation() = default;
+};
+
 } // namespace privat
 
 class VTSR_API Shader : private privat::ResourceBase
@@ -78,6 +90,7 @@ public:
     void uniform(uint32 location, const float *value, uint32 count);
     void uniform(uint32 location, const int *value, uint32 count);
     uint32 getId() const;
+    bool getLoadedFromCache() const; // the last load used the program binary cache
 
     std::vector<uint32> uniformLocations;
     uint32 loadUniformLocations(const std::vector<const char *> &names);
@@ -86,10 +99,18 @@ public:
 
     static std::string preamble;
 
+    // directory for caching linked program binaries
+    //   (set it before creating the render context)
+    // empty disables the cache
+    static std::string binaryCachePath;
+
 private:
     uint32 id = 0;
+    bool loadedFromCache = false;
 
     int loadShader(const std::string &source, int stage) const;
+    bool loadBinary(const std::string &path, uint64 hash);
+    void saveBinary(const std::string &path, uint64 hash) const;
 };
 
 class VTSR_API Texture : private privat::ResourceBase
@@ -103,11 +124,13 @@ public:
     void clear();
     void bind();
     void load(ResourceInfo &info, GpuTextureSpec &spec, const std::string &debugId);
+    void load(ResourceInfo &info, GpuTextureSpec &spec, const std::string &debugId, const std::shared_ptr<TexturePool> &pool); // reuses texture objects of same size and format
     void setId(uint32 id);
     uint32 getId() const;
     bool getGrayscale() const;
 
 private:
+    std::unique_ptr<privat::PoolAllocation> pooled;
     uint32 id = 0;
     bool grayscale = false;
 };
@@ -122,16 +145,26 @@ public:
     void setDebugId(const std::string &id);
     void clear();
     void bind();
+    void bindChunk(); // binds the whole pooled buffers, draws need base vertex and first index from the offsets
     void dispatch();
     void dispatch(uint32 offset, uint32 count); // offset: number of indices/vertices to skip; count: number of indices/vertices to render
     void dispatchWireframeSlow();
     void load(ResourceInfo &info, GpuMeshSpec &spec, const std::string &debugId);
+    void load(ResourceInfo &info, GpuMeshSpec &spec, const std::string &debugId, const std::shared_ptr<MeshPool> &pool); // sub-allocates the buffers from the pool
     uint32 getVbo() const;
     uint32 getVio() const;
+    uint32 getVboOffset() const; // in bytes, non-zero for pooled meshes
+    uint32 getVioOffset() const; // in bytes, non-zero for pooled meshes
+    bool getPooled() const;
+    const GpuMeshSpec &getSpec() const; // the data buffers are already freed
 
 private:
+    void bindAttributes(uint32 offset);
+
     GpuMeshSpec spec;
+    std::unique_ptr<privat::PoolAllocation> pooled;
     uint32 vbo = 0, vio = 0;
+    uint32 vboOffset = 0, vioOffset = 0;
 };
 
 class VTSR_API UniformBuffer : private privat::ResourceBase
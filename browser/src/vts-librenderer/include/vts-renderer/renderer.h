@@ -48,6 +48,8 @@ VTSR_API const vtsCRenderVariablesBase *vtsRenderViewVariables(vtsHRenderView vi
 VTSR_API void vtsRenderViewRender(vtsHRenderView view);
 VTSR_API void vtsRenderViewRenderCompas(vtsHRenderView view, const double screenPosSize[3], const double mapRotation[3]);
 VTSR_API void vtsRenderViewGetWorldPosition(vtsHRenderView view, const double screenPosIn[2], double worldPosOut[3]);
+VTSR_API void vtsRenderViewGetWorldPositions(vtsHRenderView view, const double *screenPosIn, uint32 count, double *worldPosOut);
+VTSR_API bool vtsRenderViewGetDepthRange(vtsHRenderView view, const double screenRectIn[4], double depthRangeOut[2]);
 
 #ifdef __cplusplus
 } // extern C
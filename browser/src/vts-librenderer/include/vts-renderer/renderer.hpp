@@ -61,6 +61,12 @@ struct VTSR_API ContextOptions : public vtsCContextOptionsBase
     std::string toJson() const;
 };
 
+struct VTSR_API ContextStatistics : public vtsCContextStatisticsBase
+{
+    ContextStatistics();
+    std::string toJson() const;
+};
+
 struct VTSR_API RenderOptions : public vtsCRenderOptionsBase
 {
     RenderOptions();
@@ -69,6 +75,12 @@ struct VTSR_API RenderOptions : public vtsCRenderOptionsBase
     std::string toJson() const;
 };
 
+struct VTSR_API RenderStatistics : public vtsCRenderStatisticsBase
+{
+    RenderStatistics();
+    std::string toJson() const;
+};
+
 struct VTSR_API RenderVariables : public vtsCRenderVariablesBase
 {
     RenderVariables();
@@ -82,6 +94,7 @@ public:
     Camera *camera();
     RenderOptions &options();
     const RenderVariables &variables() const;
+    const RenderStatistics &statistics() const;
 
     void render(RenderDraws *draws = nullptr);
 
@@ -95,6 +108,17 @@ public:
     // returns NaN if the position cannot be obtained
     void getWorldPosition(const double screenPosIn[2], double worldPosOut[3]);
 
+    // batched variant, count pairs in, count triplets out
+    // all positions share the same depth readback
+    void getWorldPositions(const double *screenPosIn, uint32 count,
+                           double *worldPosOut);
+
+    // minimal and maximal depth (0 .. 1) in screen rectangle (x, y, w, h)
+    // far plane (sky) counts as 1
+    // suitable for conservative occlusion tests
+    // returns false if no depth is available
+    bool getDepthRange(const double screenRectIn[4], double depthRangeOut[2]);
+
     void renderCompass(const double screenPosSize[3], const double mapRotation[3]);
 
 private:
@@ -112,12 +136,15 @@ public:
     ~RenderContext();
 
     ContextOptions &options();
+    const ContextStatistics &statistics() const;
 
     // can be directly bound to MapCallbacks
     void loadTexture(ResourceInfo &info, GpuTextureSpec &spec, const std::string &debugId);
+    void decodeTexture(GpuTextureSpec &spec, const std::string &debugId);
     void loadMesh(ResourceInfo &info, GpuMeshSpec &spec, const std::string &debugId);
     void loadFont(ResourceInfo &info, GpuFontSpec &spec, const std::string &debugId);
     void loadGeodata(ResourceInfo &info, GpuGeodataSpec &spec, const std::string &debugId);
+    void decodeGeodata(GpuGeodataSpec &spec, const std::string &debugId);
     void bindLoadFunctions(Map *map);
 
     // create new render view
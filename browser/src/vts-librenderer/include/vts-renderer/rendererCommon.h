@@ -45,11 +45,69 @@ typedef struct vtsCContextOptionsBase
     //   degradation and can therefore be changed here
     bool callGlFinishAfterUploadingData;
 
+    // memory budget for caching shaped geodata texts
+    //   (texts that repeat across tiles are shaped only once)
+    // zero disables the cache
+    uint32 textShapingCacheMemoryKB;
+
+    // additional threads that help the rendering thread
+    //   with parallel work (eg. generating geodata jobs)
+    // zero does all the work on the rendering thread
+    uint32 workerThreads;
+
+    // meshes are sub-allocated from shared gpu buffers of this size
+    //   (meshes larger than quarter of it have their own buffers)
+    // zero gives every mesh its own buffers
+    uint32 meshPoolChunkKB;
+
+    // memory budget for released textures kept for reuse
+    //   by new textures of the same size and format
+    // zero disables the reuse
+    uint32 texturePoolMemoryKB;
+
     // enforce using mipmaps on all textures
     // this is useful when using targetPixelRatioSurfaces far from its default
     bool enforceUsingMipMaps;
+
+    // generate texture mipmaps in the decode thread
+    //   instead of glGenerateMipmap on the upload thread
+    bool decodeTextureMipMaps;
+
+    // compress textures in the decode thread (bc1/bc3 or etc2)
+    //   when the gpu supports it
+    // saves gpu memory at the cost of slight quality loss
+    bool decodeTextureCompression;
 } vtsCContextOptionsBase;
 
+// statistics of the render context (the library fills these)
+typedef struct vtsCContextStatisticsBase
+{
+    // geodata text shaping cache
+    uint32 textShapingCacheHits;
+    uint32 textShapingCacheMisses;
+    uint32 textShapingCacheEntries;
+    uint32 textShapingCacheMemoryKB;
+
+    // mesh buffers pool
+    uint32 meshPoolChunks;
+    uint32 meshPoolCapacityKB;
+    uint32 meshPoolUsedKB;
+    uint32 meshPoolFreeRanges; // fragmentation
+    uint32 meshPoolLargestFreeKB;
+
+    // texture pool
+    uint32 texturePoolTextures; // waiting for reuse
+    uint32 texturePoolMemoryKB;
+    uint32 texturePoolReuses;
+    uint32 texturePoolCreations;
+
+    // shader programs (geodata shaders are loaded on first use)
+    uint32 shaderPrograms;
+    uint32 shaderCacheHits; // loaded from the program binary cache
+    uint32 shaderLoadTimeUs; // all programs loaded so far
+    uint32 initializationTimeUs; // of the render context
+} vtsCContextStatisticsBase;
+
 // options provided from the application (you set these)
 typedef struct vtsCRenderOptionsBase
 {
@@ -72,8 +130,11 @@ typedef struct vtsCRenderOptionsBase
     // other options
     uint32 antialiasingSamples; // two or more to enable multisampling
     uint32 debugGeodataMode; // 0 = disabled
+    uint32 depthFeedbackDivisor; // resolution of the depth read back to cpu (1 = full)
     bool renderAtmosphere;
     bool geodataHysteresis;
+    bool geodataBatching; // render screen labels and icons in batches
+    bool surfacesIndirect; // multi draw indirect for opaque surfaces (when supported, reorders equal depths)
     bool colorRenderWithAlpha;
     bool debugFlatShading;
     bool debugWireframe;
@@ -84,6 +145,30 @@ typedef struct vtsCRenderOptionsBase
     bool colorToTexture; // accessible as RenderVariables::colorReadTexId
 } vtsCRenderOptionsBase;
 
+// statistics of the last frame rendered by the view (the library fills these)
+typedef struct vtsCRenderStatisticsBase
+{
+    uint32 geodataDrawCalls;
+    uint32 geodataBatchedQuads;
+
+    // per-draw uniforms
+    uint32 uniformBuffers; // buffer objects in the ring (all frames)
+    uint32 uniformRanges; // sub-allocations in the frame
+    uint32 uniformUploadBytes;
+
+    // surfaces
+    uint32 surfaceDrawCalls;
+    uint32 surfaceIndirectDraws; // surfaces drawn by multi draw indirect
+    uint32 opaqueCpuTimeUs; // time spent submitting opaque surfaces
+
+    // depth feedback
+    uint32 depthFeedbackWidth;
+    uint32 depthFeedbackHeight;
+    uint32 depthReadbacks; // finished readbacks picked up in the frame
+    uint32 depthReadbacksSkipped; // all pbos were still in flight
+    uint32 depthFeedbackLatency; // age (in frames) of the last readback
+} vtsCRenderStatisticsBase;
+
 // these variables are controlled by the library
 //   and are provided to you for potential further use
 // do not change any attributes on the objects!
@@ -0,0 +1,389 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "renderer.hpp"
+
+#include <algorithm>
+
+#include <optick.h>
+
+namespace vts { namespace renderer
+{
+
+FrameFences::~FrameFences()
+{
+    for (const auto &it : fences)
+        glDeleteSync(it.second);
+}
+
+void FrameFences::frame()
+{
+    std::lock_guard<std::mutex> lock(mut);
+    poll();
+    fences.emplace_back(frameIndex++,
+        glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+    CHECK_GL("frame fence");
+}
+
+bool FrameFences::finished(uint64 frame)
+{
+    std::lock_guard<std::mutex> lock(mut);
+    if (frame >= finishedFrame)
+        poll();
+    return frame < finishedFrame;
+}
+
+void FrameFences::poll()
+{
+    // the fences signal in order
+    while (!fences.empty())
+    {
+        GLenum r = glClientWaitSync(fences.front().second, 0, 0);
+        if (r != GL_ALREADY_SIGNALED && r != GL_CONDITION_SATISFIED)
+            break;
+        finishedFrame = fences.front().first + 1;
+        glDeleteSync(fences.front().second);
+        fences.pop_front();
+    }
+}
+
+BufferPool::BufferPool(uint32 target, const std::string &debugId,
+    const std::shared_ptr<FrameFences> &fences) :
+    debugId(debugId), fences(fences), target(target)
+{}
+
+BufferPool::~BufferPool()
+{
+    for (Chunk &c : chunks)
+        glDeleteBuffers(1, &c.buffer);
+}
+
+bool BufferPool::allocate(Chunk &c, uint32 size, uint32 alignment,
+    uint32 &offset)
+{
+    // first fit
+    for (auto it = c.free.begin(); it != c.free.end(); it++)
+    {
+        uint32 start = it->first;
+        uint32 end = start + it->second;
+        uint32 aligned = (start + alignment - 1) / alignment * alignment;
+        if (aligned + size > end)
+            continue;
+        c.free.erase(it);
+        if (aligned > start)
+            c.free[start] = aligned - start;
+        if (aligned + size < end)
+            c.free[aligned + size] = end - aligned - size;
+        c.used += size;
+        offset = aligned;
+        return true;
+    }
+    return false;
+}
+
+bool BufferPool::allocate(uint32 size, uint32 alignment,
+    uint32 &buffer, uint32 &offset)
+{
+    assert(size > 0 && alignment > 0);
+    std::lock_guard<std::mutex> lock(mut);
+    if (size > chunkSize / 4)
+        return false;
+    reclaim();
+    for (Chunk &c : chunks)
+    {
+        if (c.capacity - c.used < size || !allocate(c, size, alignment, offset))
+            continue;
+        buffer = c.buffer;
+        return true;
+    }
+
+    Chunk c;
+    c.capacity = chunkSize;
+    c.free[0] = chunkSize;
+    glGenBuffers(1, &c.buffer);
+    glBindBuffer(target, c.buffer);
+    glBufferData(target, chunkSize, nullptr, GL_STATIC_DRAW);
+    if (GLAD_GL_KHR_debug)
+        glObjectLabel(GL_BUFFER, c.buffer, debugId.length(), debugId.data());
+    CHECK_GL("buffer pool chunk");
+    chunks.push_back(std::move(c));
+    buffer = chunks.back().buffer;
+    return allocate(chunks.back(), size, alignment, offset);
+}
+
+void BufferPool::release(uint32 buffer, uint32 offset, uint32 size)
+{
+    std::lock_guard<std::mutex> lock(mut);
+    Pending p;
+    p.frame = frameIndex;
+    p.buffer = buffer;
+    p.offset = offset;
+    p.size = size;
+    pending.push_back(p);
+}
+
+void BufferPool::reclaim()
+{
+    while (!pending.empty()
+        && pending.front().frame + PoolReuseDelay <= frameIndex
+        && fences->finished(pending.front().frame))
+    {
+        Pending p = pending.front();
+        pending.pop_front();
+        auto ci = std::find_if(chunks.begin(), chunks.end(),
+            [&](const Chunk &c) { return c.buffer == p.buffer; });
+        assert(ci != chunks.end());
+        Chunk &c = *ci;
+        assert(c.used >= p.size);
+        c.used -= p.size;
+
+        // merge with neighboring free ranges
+        uint32 start = p.offset;
+        uint32 end = p.offset + p.size;
+        auto next = c.free.lower_bound(start);
+        if (next != c.free.end() && next->first == end)
+        {
+            end += next->second;
+            next = c.free.erase(next);
+        }
+        if (next != c.free.begin())
+        {
+            auto prev = std::prev(next);
+            if (prev->first + prev->second == start)
+            {
+                start = prev->first;
+                c.free.erase(prev);
+            }
+        }
+        c.free[start] = end - start;
+    }
+}
+
+void BufferPool::frame(uint32 chunkSize)
+{
+    std::lock_guard<std::mutex> lock(mut);
+    this->chunkSize = chunkSize;
+    frameIndex++;
+    reclaim();
+
+    // release empty chunks, except the last one
+    for (auto it = chunks.begin(); it != chunks.end() && chunks.size() > 1;)
+    {
+        bool waiting = std::any_of(pending.begin(), pending.end(),
+            [&](const Pending &p) { return p.buffer == it->buffer; });
+        if (it->used == 0 && !waiting)
+        {
+            glDeleteBuffers(1, &it->buffer);
+            it = chunks.erase(it);
+        }
+        else
+            it++;
+    }
+}
+
+uint32 BufferPool::chunksCount()
+{
+    std::lock_guard<std::mutex> lock(mut);
+    return chunks.size();
+}
+
+uint32 BufferPool::capacity()
+{
+    std::lock_guard<std::mutex> lock(mut);
+    uint32 r = 0;
+    for (const Chunk &c : chunks)
+        r += c.capacity;
+    return r;
+}
+
+uint32 BufferPool::used()
+{
+    std::lock_guard<std::mutex> lock(mut);
+    uint32 r = 0;
+    for (const Chunk &c : chunks)
+        r += c.used;
+    return r;
+}
+
+uint32 BufferPool::freeRanges()
+{
+    std::lock_guard<std::mutex> lock(mut);
+    uint32 r = 0;
+    for (const Chunk &c : chunks)
+        r += c.free.size();
+    return r;
+}
+
+uint32 BufferPool::largestFree()
+{
+    std::lock_guard<std::mutex> lock(mut);
+    uint32 r = 0;
+    for (const Chunk &c : chunks)
+        for (const auto &it : c.free)
+            r = std::max(r, it.second);
+    return r;
+}
+
+MeshPool::MeshPool(const std::shared_ptr<FrameFences> &fences) :
+    vertices(GL_ARRAY_BUFFER, "meshPoolVertices", fences),
+    indices(GL_ELEMENT_ARRAY_BUFFER, "meshPoolIndices", fences)
+{}
+
+bool TexturePool::Key::operator == (const Key &other) const
+{
+    return internalFormat == other.internalFormat
+        && width == other.width
+        && height == other.height
+        && levels == other.levels;
+}
+
+TexturePool::TexturePool(const std::shared_ptr<FrameFences> &fences) :
+    fences(fences)
+{}
+
+TexturePool::~TexturePool()
+{
+    for (const Entry &e : entries)
+        glDeleteTextures(1, &e.id);
+}
+
+uint32 TexturePool::acquire(const Key &key)
+{
+    std::lock_guard<std::mutex> lock(mut);
+    for (auto it = entries.begin(); it != entries.end(); it++)
+    {
+        if (it->frame + PoolReuseDelay > frameIndex
+            || !fences->finished(it->frame))
+            break; // the remaining entries are even younger
+        if (!(it->key == key))
+            continue;
+        uint32 id = it->id;
+        memoryUsed -= it->memory;
+        entries.erase(it);
+        reusesCount++;
+        return id;
+    }
+    return 0;
+}
+
+void TexturePool::release(const Key &key, uint32 id, uint32 memory)
+{
+    std::lock_guard<std::mutex> lock(mut);
+    Entry e;
+    e.key = key;
+    e.frame = frameIndex;
+    e.id = id;
+    e.memory = memory;
+    entries.push_back(e);
+    memoryUsed += memory;
+    evict();
+}
+
+void TexturePool::evict()
+{
+    while (!entries.empty() && memoryUsed > memoryBudget)
+    {
+        glDeleteTextures(1, &entries.front().id);
+        memoryUsed -= entries.front().memory;
+        entries.pop_front();
+    }
+}
+
+void TexturePool::frame(uint32 memoryBudget)
+{
+    std::lock_guard<std::mutex> lock(mut);
+    this->memoryBudget = memoryBudget;
+    frameIndex++;
+    evict();
+}
+
+uint32 TexturePool::texturesCount()
+{
+    std::lock_guard<std::mutex> lock(mut);
+    return entries.size();
+}
+
+uint32 TexturePool::memory()
+{
+    std::lock_guard<std::mutex> lock(mut);
+    return memoryUsed;
+}
+
+uint32 TexturePool::reuses()
+{
+    std::lock_guard<std::mutex> lock(mut);
+    return reusesCount;
+}
+
+uint32 TexturePool::creations()
+{
+    std::lock_guard<std::mutex> lock(mut);
+    return creationsCount;
+}
+
+void TexturePool::created()
+{
+    std::lock_guard<std::mutex> lock(mut);
+    creationsCount++;
+}
+
+void RenderContextImpl::beginViewFrame(uint32 &viewPoolsFrame)
+{
+    if (viewPoolsFrame == poolsFrame)
+    {
+        updatePools();
+        poolsFrame++;
+    }
+    viewPoolsFrame = poolsFrame;
+}
+
+void RenderContextImpl::updatePools()
+{
+    OPTICK_EVENT();
+
+    frameFences->frame();
+    meshPool->vertices.frame(options.meshPoolChunkKB * 1024);
+    meshPool->indices.frame(options.meshPoolChunkKB * 1024);
+    texturePool->frame(options.texturePoolMemoryKB * 1024);
+
+    ContextStatistics &s = statistics;
+    s.meshPoolChunks = meshPool->vertices.chunksCount()
+        + meshPool->indices.chunksCount();
+    s.meshPoolCapacityKB = (meshPool->vertices.capacity()
+        + meshPool->indices.capacity()) / 1024;
+    s.meshPoolUsedKB = (meshPool->vertices.used()
+        + meshPool->indices.used()) / 1024;
+    s.meshPoolFreeRanges = meshPool->vertices.freeRanges()
+        + meshPool->indices.freeRanges();
+    s.meshPoolLargestFreeKB = std::max(meshPool->vertices.largestFree(),
+        meshPool->indices.largestFree()) / 1024;
+    s.texturePoolTextures = texturePool->texturesCount();
+    s.texturePoolMemoryKB = texturePool->memory() / 1024;
+    s.texturePoolReuses = texturePool->reuses();
+    s.texturePoolCreations = texturePool->creations();
+}
+
+} } // namespace vts renderer
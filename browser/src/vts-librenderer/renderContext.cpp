@@ -25,9 +25,13 @@
  */
 
 #include "renderer.hpp"
+#include "geodata.hpp"
 
 #include <vts-browser/resources.hpp>
 
+#include <chrono>
+#include <optick.h>
+
 namespace vts { namespace renderer
 {
 
@@ -41,13 +45,39 @@ void ShaderAtm::initializeAtmosphere()
         });
 }
 
+void LazyShader::setLoader(const std::function<void(Shader &)> &loader)
+{
+    this->loader = loader;
+    shader.reset();
+}
+
+Shader *LazyShader::operator -> ()
+{
+    if (!shader)
+    {
+        auto s = std::make_shared<Shader>();
+        loader(*s);
+        shader = s;
+    }
+    return shader.get();
+}
+
 RenderContextImpl::RenderContextImpl(RenderContext *api) : api(api)
 {
+    OPTICK_EVENT();
+    auto start = std::chrono::steady_clock::now();
+
     std::string atm = readInternalMemoryBuffer(
         "data/shaders/atmosphere.inc.glsl").str();
     std::string geo = readInternalMemoryBuffer(
         "data/shaders/geodata.inc.glsl").str();
 
+    textShapingCache = std::make_shared<TextShapingCache>(this);
+    frameFences = std::make_shared<FrameFences>();
+    meshPool = std::make_shared<MeshPool>(frameFences);
+    texturePool = std::make_shared<TexturePool>(frameFences);
+    updatePools();
+
     // global VAO
     {
         glGenVertexArrays(1, &globalVao);
@@ -58,8 +88,7 @@ RenderContextImpl::RenderContextImpl(RenderContext *api) : api(api)
     {
         texCompas = std::make_shared<Texture>();
         GpuTextureSpec spec(vts::readInternalMemoryBuffer(
-            "data/textures/compas.png"));
-        spec.verticalFlip();
+            "data/textures/compas.png"), true);
         ResourceInfo ri;
         texCompas->load(ri, spec, "data/textures/compas.png");
     }
@@ -73,13 +102,12 @@ RenderContextImpl::RenderContextImpl(RenderContext *api) : api(api)
         {
             std::stringstream ss;
             ss << "data/textures/blueNoise/" << i << ".png";
-            GpuTextureSpec spec(vts::readInternalMemoryBuffer(ss.str()));
+            GpuTextureSpec spec(vts::readInternalMemoryBuffer(ss.str()), true);
             assert(spec.width == 64);
             assert(spec.height == 64);
             assert(spec.components == 1);
             assert(spec.type == GpuTypeEnum::UnsignedByte);
             assert(spec.buffer.size() == 64 * 64);
-            spec.verticalFlip();
             memcpy(buff.data() + (64 * 64 * i), spec.buffer.data(), 64 * 64);
         }
         glActiveTexture(GL_TEXTURE0 + 9);
@@ -106,7 +134,7 @@ RenderContextImpl::RenderContextImpl(RenderContext *api) : api(api)
         shaderTexture = std::make_shared<Shader>();
         shaderTexture->setDebugId(
             "data/shaders/texture.*.glsl");
-        shaderTexture->loadInternal(
+        loadShaderInternal(*shaderTexture,
             "data/shaders/texture.vert.glsl",
             "data/shaders/texture.frag.glsl");
         shaderTexture->loadUniformLocations({
@@ -127,7 +155,7 @@ RenderContextImpl::RenderContextImpl(RenderContext *api) : api(api)
             "data/shaders/surface.vert.glsl");
         Buffer frag = readInternalMemoryBuffer(
             "data/shaders/surface.frag.glsl");
-        shaderSurface->load(atm + vert.str(), atm + frag.str());
+        loadShader(*shaderSurface, atm + vert.str(), atm + frag.str());
         shaderSurface->bindUniformBlockLocations({
                  { "uboSurface", 1 }
              });
@@ -137,6 +165,35 @@ RenderContextImpl::RenderContextImpl(RenderContext *api) : api(api)
                 { "texBlueNoise", 9 }
             });
         shaderSurface->initializeAtmosphere();
+
+        if (multiDrawElementsIndirect)
+        {
+            try
+            {
+                shaderSurfaceIndirect = std::make_shared<ShaderAtm>();
+                shaderSurfaceIndirect->setDebugId(
+                    "data/shaders/surface.*.glsl (indirect)");
+                std::string def = "#define VTS_INDIRECT\n";
+                loadShader(*shaderSurfaceIndirect, def + atm + vert.str(),
+                                            def + atm + frag.str());
+                shaderSurfaceIndirect->bindUniformBlockLocations({
+                         { "uboSurface", 1 }
+                     });
+                shaderSurfaceIndirect->bindTextureLocations({
+                        { "texColor", 0 },
+                        { "texMask", 1 },
+                        { "texDraws", 8 },
+                        { "texBlueNoise", 9 }
+                    });
+                shaderSurfaceIndirect->initializeAtmosphere();
+            }
+            catch (const std::exception &e)
+            {
+                vts::log(vts::LogLevel::warn3,
+                    std::string("indirect surfaces disabled: ") + e.what());
+                shaderSurfaceIndirect.reset();
+            }
+        }
     }
 
     // load shader infographic
@@ -144,7 +201,7 @@ RenderContextImpl::RenderContextImpl(RenderContext *api) : api(api)
         shaderInfographics = std::make_shared<Shader>();
         shaderInfographics->setDebugId(
             "data/shaders/infographic.*.glsl");
-        shaderInfographics->loadInternal(
+        loadShaderInternal(*shaderInfographics,
             "data/shaders/infographics.vert.glsl",
             "data/shaders/infographics.frag.glsl");
         shaderInfographics->bindUniformBlockLocations({
@@ -165,7 +222,7 @@ RenderContextImpl::RenderContextImpl(RenderContext *api) : api(api)
             "data/shaders/background.vert.glsl");
         Buffer frag = readInternalMemoryBuffer(
             "data/shaders/background.frag.glsl");
-        shaderBackground->load(vert.str(), atm + frag.str());
+        loadShader(*shaderBackground, vert.str(), atm + frag.str());
         shaderBackground->loadUniformLocations({
                 "uniCorners[0]",
                 "uniCorners[1]",
@@ -180,11 +237,12 @@ RenderContextImpl::RenderContextImpl(RenderContext *api) : api(api)
         shaderCopyDepth = std::make_shared<Shader>();
         shaderCopyDepth->setDebugId(
             "data/shaders/copyDepth.*.glsl");
-        shaderCopyDepth->loadInternal(
+        loadShaderInternal(*shaderCopyDepth,
             "data/shaders/copyDepth.vert.glsl",
             "data/shaders/copyDepth.frag.glsl");
         shaderCopyDepth->loadUniformLocations({
-                "uniTexPos"
+                "uniTexPos",
+                "uniDivisor"
             });
         shaderCopyDepth->bindTextureLocations({
                 { "texDepth", 0 }
@@ -251,186 +309,233 @@ RenderContextImpl::RenderContextImpl(RenderContext *api) : api(api)
         meshEmpty->load(ri, spec, "meshEmpty");
     }
 
+    // geodata shaders are loaded on their first use
+    //   (many maps have no geodata at all)
+
     // load shader geodata color
+    shaderGeodataColor.setLoader([this, geo](Shader &s)
     {
-        shaderGeodataColor = std::make_shared<Shader>();
-        shaderGeodataColor->setDebugId("data/shaders/geodataColor.*.glsl");
+        s.setDebugId("data/shaders/geodataColor.*.glsl");
         Buffer vert = readInternalMemoryBuffer(
             "data/shaders/geodataColor.vert.glsl");
         Buffer frag = readInternalMemoryBuffer(
             "data/shaders/geodataColor.frag.glsl");
-        shaderGeodataColor->load(geo + vert.str(), geo + frag.str());
-        shaderGeodataColor->bindUniformBlockLocations({
+        loadShader(s, geo + vert.str(), geo + frag.str());
+        s.bindUniformBlockLocations({
                 { "uboCameraData", 0 },
                 { "uboViewData", 1 },
                 { "uboColorData", 2 }
             });
-    }
+    });
 
     // load shader geodata point flat
+    shaderGeodataPointFlat.setLoader([this, geo](Shader &s)
     {
-        shaderGeodataPointFlat = std::make_shared<Shader>();
-        shaderGeodataPointFlat->setDebugId(
+        s.setDebugId(
             "data/shaders/geodataPointFlat.*.glsl");
         Buffer vert = readInternalMemoryBuffer(
             "data/shaders/geodataPointFlat.vert.glsl");
         Buffer frag = readInternalMemoryBuffer(
             "data/shaders/geodataPoint.frag.glsl");
-        shaderGeodataPointFlat->load(geo + vert.str(), geo + frag.str());
-        shaderGeodataPointFlat->bindTextureLocations({
+        loadShader(s, geo + vert.str(), geo + frag.str());
+        s.bindTextureLocations({
                 { "texPointData", 0 }
             });
-        shaderGeodataPointFlat->bindUniformBlockLocations({
+        s.bindUniformBlockLocations({
                 { "uboCameraData", 0 },
                 { "uboViewData", 1 },
                 { "uboPointData", 2 }
             });
-    }
+    });
 
     // load shader geodata point screen
+    shaderGeodataPointScreen.setLoader([this, geo](Shader &s)
     {
-        shaderGeodataPointScreen = std::make_shared<Shader>();
-        shaderGeodataPointScreen->setDebugId(
+        s.setDebugId(
             "data/shaders/geodataPointScreen.*.glsl");
         Buffer vert = readInternalMemoryBuffer(
             "data/shaders/geodataPointScreen.vert.glsl");
         Buffer frag = readInternalMemoryBuffer(
             "data/shaders/geodataPoint.frag.glsl");
-        shaderGeodataPointScreen->load(geo + vert.str(), geo + frag.str());
-        shaderGeodataPointScreen->bindTextureLocations({
+        loadShader(s, geo + vert.str(), geo + frag.str());
+        s.bindTextureLocations({
                 { "texPointData", 0 }
             });
-        shaderGeodataPointScreen->bindUniformBlockLocations({
+        s.bindUniformBlockLocations({
                 { "uboCameraData", 0 },
                 { "uboViewData", 1 },
                 { "uboPointData", 2 }
             });
-    }
+    });
 
     // load shader geodata line flat
+    shaderGeodataLineFlat.setLoader([this, geo](Shader &s)
     {
-        shaderGeodataLineFlat = std::make_shared<Shader>();
-        shaderGeodataLineFlat->setDebugId(
+        s.setDebugId(
             "data/shaders/geodataLineFlat.*.glsl");
         Buffer vert = readInternalMemoryBuffer(
             "data/shaders/geodataLineFlat.vert.glsl");
         Buffer frag = readInternalMemoryBuffer(
             "data/shaders/geodataLine.frag.glsl");
-        shaderGeodataLineFlat->load(geo + vert.str(), geo + frag.str());
-        shaderGeodataLineFlat->bindTextureLocations({
+        loadShader(s, geo + vert.str(), geo + frag.str());
+        s.bindTextureLocations({
                 { "texLineData", 0 }
             });
-        shaderGeodataLineFlat->bindUniformBlockLocations({
+        s.bindUniformBlockLocations({
                 { "uboCameraData", 0 },
                 { "uboViewData", 1 },
                 { "uboLineData", 2 }
             });
-    }
+    });
 
     // load shader geodata line screen
+    shaderGeodataLineScreen.setLoader([this, geo](Shader &s)
     {
-        shaderGeodataLineScreen = std::make_shared<Shader>();
-        shaderGeodataLineScreen->setDebugId(
+        s.setDebugId(
             "data/shaders/geodataLineScreen.*.glsl");
         Buffer vert = readInternalMemoryBuffer(
             "data/shaders/geodataLineScreen.vert.glsl");
         Buffer frag = readInternalMemoryBuffer(
             "data/shaders/geodataLine.frag.glsl");
-        shaderGeodataLineScreen->load(geo + vert.str(), geo + frag.str());
-        shaderGeodataLineScreen->bindTextureLocations({
+        loadShader(s, geo + vert.str(), geo + frag.str());
+        s.bindTextureLocations({
                 { "texLineData", 0 }
             });
-        shaderGeodataLineScreen->bindUniformBlockLocations({
+        s.bindUniformBlockLocations({
                 { "uboCameraData", 0 },
                 { "uboViewData", 1 },
                 { "uboLineData", 2 }
             });
-    }
+    });
 
     // load shader geodata icon screen
+    shaderGeodataIconScreen.setLoader([this, geo](Shader &s)
     {
-        shaderGeodataIconScreen = std::make_shared<Shader>();
-        shaderGeodataIconScreen->setDebugId(
+        s.setDebugId(
             "data/shaders/geodataIcon.*.glsl");
         Buffer vert = readInternalMemoryBuffer(
             "data/shaders/geodataIcon.vert.glsl");
         Buffer frag = readInternalMemoryBuffer(
             "data/shaders/geodataIcon.frag.glsl");
-        shaderGeodataIconScreen->load(geo + vert.str(), geo + frag.str());
-        shaderGeodataIconScreen->bindTextureLocations({
+        loadShader(s, geo + vert.str(), geo + frag.str());
+        s.bindTextureLocations({
                 { "texIcons", 0 }
             });
-        shaderGeodataIconScreen->bindUniformBlockLocations({
+        s.bindUniformBlockLocations({
                 { "uboCameraData", 0 },
                 { "uboViewData", 1 },
                 { "uboIconData", 2 }
             });
-    }
+    });
 
     // load shader geodata label flat
+    shaderGeodataLabelFlat.setLoader([this, geo](Shader &s)
     {
-        shaderGeodataLabelFlat = std::make_shared<Shader>();
-        shaderGeodataLabelFlat->setDebugId(
+        s.setDebugId(
             "data/shaders/geodataLabelFlat.*.glsl");
         Buffer vert = readInternalMemoryBuffer(
             "data/shaders/geodataLabelFlat.vert.glsl");
         Buffer frag = readInternalMemoryBuffer(
             "data/shaders/geodataLabelFlat.frag.glsl");
-        shaderGeodataLabelFlat->load(geo + vert.str(), geo + frag.str());
-        shaderGeodataLabelFlat->bindTextureLocations({
+        loadShader(s, geo + vert.str(), geo + frag.str());
+        s.bindTextureLocations({
                 { "texGlyphs", 0 }
             });
-        shaderGeodataLabelFlat->bindUniformBlockLocations({
+        s.bindUniformBlockLocations({
                 { "uboCameraData", 0 },
                 { "uboViewData", 1 },
                 { "uboLabelFlat", 2 }
             });
-        shaderGeodataLabelFlat->loadUniformLocations({
+        s.loadUniformLocations({
                 "uniPass"
             });
-    }
+    });
 
     // load shader geodata label screen
+    shaderGeodataLabelScreen.setLoader([this, geo](Shader &s)
     {
-        shaderGeodataLabelScreen = std::make_shared<Shader>();
-        shaderGeodataLabelScreen->setDebugId(
+        s.setDebugId(
             "data/shaders/geodataLabelScreen.*.glsl");
         Buffer vert = readInternalMemoryBuffer(
             "data/shaders/geodataLabelScreen.vert.glsl");
         Buffer frag = readInternalMemoryBuffer(
             "data/shaders/geodataLabelScreen.frag.glsl");
-        shaderGeodataLabelScreen->load(geo + vert.str(), geo + frag.str());
-        shaderGeodataLabelScreen->bindTextureLocations({
+        loadShader(s, geo + vert.str(), geo + frag.str());
+        s.bindTextureLocations({
                 { "texGlyphs", 0 }
             });
-        shaderGeodataLabelScreen->bindUniformBlockLocations({
+        s.bindUniformBlockLocations({
                 { "uboCameraData", 0 },
                 { "uboViewData", 1 },
                 { "uboLabelScreen", 2 }
             });
-        shaderGeodataLabelScreen->loadUniformLocations({
+        s.loadUniformLocations({
                 "uniPass"
             });
-    }
+    });
 
     // load shader geodata triangle
+    shaderGeodataTriangle.setLoader([this, geo](Shader &s)
     {
-        shaderGeodataTriangle = std::make_shared<Shader>();
-        shaderGeodataTriangle->setDebugId(
+        s.setDebugId(
             "data/shaders/geodataTriangle.*.glsl");
         Buffer vert = readInternalMemoryBuffer(
             "data/shaders/geodataTriangle.vert.glsl");
         Buffer frag = readInternalMemoryBuffer(
             "data/shaders/geodataTriangle.frag.glsl");
-        shaderGeodataTriangle->load(geo + vert.str(), geo + frag.str());
-        shaderGeodataTriangle->bindUniformBlockLocations({
+        loadShader(s, geo + vert.str(), geo + frag.str());
+        s.bindUniformBlockLocations({
                 { "uboCameraData", 0 },
                 { "uboViewData", 1 },
                 { "uboTriangleData", 2 }
             });
-    }
+    });
+
+    // load shader geodata batch icon
+    shaderGeodataBatchIcon.setLoader([this, geo](Shader &s)
+    {
+        s.setDebugId(
+            "data/shaders/geodataBatchIcon.*.glsl");
+        Buffer vert = readInternalMemoryBuffer(
+            "data/shaders/geodataBatchIcon.vert.glsl");
+        Buffer frag = readInternalMemoryBuffer(
+            "data/shaders/geodataBatchIcon.frag.glsl");
+        loadShader(s, geo + vert.str(), geo + frag.str());
+        s.bindTextureLocations({
+                { "texIcons", 0 }
+            });
+    });
+
+    // load shader geodata batch label
+    shaderGeodataBatchLabel.setLoader([this, geo](Shader &s)
+    {
+        s.setDebugId(
+            "data/shaders/geodataBatchLabel.*.glsl");
+        Buffer vert = readInternalMemoryBuffer(
+            "data/shaders/geodataBatchLabel.vert.glsl");
+        Buffer frag = readInternalMemoryBuffer(
+            "data/shaders/geodataBatchLabel.frag.glsl");
+        loadShader(s, geo + vert.str(), geo + frag.str());
+        s.bindTextureLocations({
+                { "texGlyphs", 0 }
+            });
+        s.loadUniformLocations({
+                "uniPass"
+            });
+    });
 
     CHECK_GL("initialize");
+
+    statistics.initializationTimeUs = std::chrono::duration_cast<
+        std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    std::stringstream ss;
+    ss << "Render context initialized in "
+        << statistics.initializationTimeUs / 1000 << " ms, shader programs: "
+        << statistics.shaderPrograms << ", from cache: "
+        << statistics.shaderCacheHits << ", loading took: "
+        << statistics.shaderLoadTimeUs / 1000 << " ms";
+    vts::log(vts::LogLevel::info2, ss.str());
 }
 
 RenderContextImpl::~RenderContextImpl()
@@ -438,5 +543,26 @@ RenderContextImpl::~RenderContextImpl()
     glDeleteVertexArrays(1, &globalVao);
 }
 
+void RenderContextImpl::loadShader(Shader &shader,
+    const std::string &vertexShader, const std::string &fragmentShader)
+{
+    auto start = std::chrono::steady_clock::now();
+    shader.load(vertexShader, fragmentShader);
+    statistics.shaderLoadTimeUs += std::chrono::duration_cast<
+        std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    statistics.shaderPrograms++;
+    if (shader.getLoadedFromCache())
+        statistics.shaderCacheHits++;
+}
+
+void RenderContextImpl::loadShaderInternal(Shader &shader,
+    const std::string &vertexName, const std::string &fragmentName)
+{
+    Buffer vert = readInternalMemoryBuffer(vertexName);
+    Buffer frag = readInternalMemoryBuffer(fragmentName);
+    loadShader(shader, vert.str(), frag.str());
+}
+
 } } // namespace vts renderer
 
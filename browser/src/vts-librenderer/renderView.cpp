@@ -24,6 +24,9 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <algorithm>
+#include <chrono>
+
 #include <vts-browser/resources.hpp>
 #include <vts-browser/cameraDraws.hpp>
 #include <vts-browser/celestial.hpp>
@@ -51,34 +54,95 @@ void enableClipDistance(bool enable)
 #endif
 }
 
-UboCache::UboCache() : current(0), last(0), prev(0)
+UboRing::UboRing()
+{}
+
+UboRing::~UboRing()
 {
-    // initialize the buffer
-    data.reserve(1000);
-    data.resize(10);
+    for (Segment &s : segments)
+    {
+        if (s.fence)
+            glDeleteSync(s.fence);
+    }
 }
 
-UniformBuffer *UboCache::get()
+void UboRing::frame()
 {
-    if ((current + 1) % data.size() == prev)
     {
-        // grow the buffer
-        data.insert(data.begin() + prev, nullptr);
-        prev++;
-        if (last > current)
-            last++;
+        Segment &s = segments[current];
+        if (s.required > 0)
+        {
+            if (s.fence)
+                glDeleteSync(s.fence);
+            s.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        }
+    }
+
+    current = (current + 1) % SegmentsCount;
+    Segment &s = segments[current];
+
+    if (s.fence)
+    {
+        OPTICK_EVENT("uboRingWait");
+#ifdef __EMSCRIPTEN__
+        // webgl does not allow blocking
+        //   the glBufferSubData synchronizes anyway
+        glClientWaitSync(s.fence, 0, 0);
+#else
+        glClientWaitSync(s.fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                         1000000000); // 1 second
+#endif
+        glDeleteSync(s.fence);
+        s.fence = 0;
     }
-    auto &c = data[current];
-    current = (current + 1) % data.size();
-    if (!c)
-        c = std::make_unique<UniformBuffer>();
-    return &*c;
+
+    // the segment has overflown, replace it with single larger buffer
+    if (s.buffers.size() > 1)
+    {
+        s.capacity = std::max(s.capacity, s.required + s.required / 4);
+        s.buffers.clear();
+    }
+
+    s.offset = 0;
+    s.required = 0;
 }
 
-void UboCache::frame()
+void UboRing::use(uint32 bindIndex, const void *data, uint32 size)
 {
-    prev = last;
-    last = current;
+    assert(size > 0);
+    Segment &s = segments[current];
+    uint32 aligned = (size + uniformBufferOffsetAlignment - 1)
+        / uniformBufferOffsetAlignment * uniformBufferOffsetAlignment;
+    s.required += aligned;
+
+    if (s.buffers.empty() || s.offset + size > s.capacity)
+    {
+        if (s.buffers.empty())
+            s.capacity = std::max(std::max(s.capacity, aligned), 64u * 1024);
+        else
+            s.capacity = std::max(s.capacity * 2, aligned);
+        s.offset = 0;
+        s.buffers.push_back(std::make_unique<UniformBuffer>());
+        UniformBuffer *b = &*s.buffers.back();
+        b->setDebugId("uboRing");
+        b->bind();
+        b->load(nullptr, s.capacity, GL_DYNAMIC_DRAW);
+    }
+
+    UniformBuffer *b = &*s.buffers.back();
+    b->bind();
+    glBufferSubData(GL_UNIFORM_BUFFER, s.offset, size, data);
+    glBindBufferRange(GL_UNIFORM_BUFFER, bindIndex, b->getUbo(),
+                      s.offset, size);
+    s.offset += aligned;
+}
+
+uint32 UboRing::buffersCount() const
+{
+    uint32 cnt = 0;
+    for (const Segment &s : segments)
+        cnt += s.buffers.size();
+    return cnt;
 }
 
 RenderViewImpl::RenderViewImpl(
@@ -111,33 +175,18 @@ void RenderViewImpl::clearGlState()
     CHECK_GL("cleared gl state");
 }
 
-UniformBuffer *RenderViewImpl::useDisposableUbo(uint32 bindIndex,
-    void *data, uint32 size)
+void RenderViewImpl::useDisposableUbo(uint32 bindIndex,
+    const void *data, uint32 size)
 {
-    UniformBuffer *ubo = size > 256 ? uboCacheLarge.get() : uboCacheSmall.get();
-    ubo->bind();
-    ubo->load(data, size, GL_DYNAMIC_DRAW);
-    ubo->bindToIndex(bindIndex);
-    return ubo;
+    uboRing.use(bindIndex, data, size);
+    statistics.uniformRanges++;
+    statistics.uniformUploadBytes += size;
+    statistics.uniformBuffers = uboRing.buffersCount();
 }
 
-void RenderViewImpl::drawSurface(const DrawSurfaceTask &t, bool wireframeSlow)
+void RenderViewImpl::surfaceUniforms(const DrawSurfaceTask &t,
+    Texture *tex, UboSurface &data)
 {
-    Texture *tex = (Texture*)t.texColor.get();
-    Mesh *m = (Mesh*)t.mesh.get();
-    if (!m || !tex)
-        return;
-
-    struct UboSurface
-    {
-        mat4f p;
-        mat4f mv;
-        vec4f uvTrans; // scale-x, scale-y, offset-x, offset-y
-        vec4f uvClip;
-        vec4f color;
-        vec4si32 flags; // mask, monochromatic, flat shading, uv source, lodBlendingWithDithering, ..., blendingCoverage, frameIndex
-    } data;
-
     data.p = proj.cast<float>();
     data.mv = rawToMat4(t.mv);
     data.uvTrans = rawToVec4(t.uvTrans);
@@ -163,8 +212,18 @@ void RenderViewImpl::drawSurface(const DrawSurfaceTask &t, bool wireframeSlow)
         else
             data.color[3] *= t.blendingCoverage;
     }
+}
 
-    useDisposableUbo(1, data)->setDebugId("UboSurface");
+void RenderViewImpl::drawSurface(const DrawSurfaceTask &t, bool wireframeSlow)
+{
+    Texture *tex = (Texture*)t.texColor.get();
+    Mesh *m = (Mesh*)t.mesh.get();
+    if (!m || !tex)
+        return;
+
+    UboSurface data;
+    surfaceUniforms(t, tex, data);
+    useDisposableUbo(1, data);
 
     if (t.texMask)
     {
@@ -179,6 +238,31 @@ void RenderViewImpl::drawSurface(const DrawSurfaceTask &t, bool wireframeSlow)
         m->dispatchWireframeSlow();
     else
         m->dispatch();
+    statistics.surfaceDrawCalls++;
+}
+
+void RenderViewImpl::drawOpaque()
+{
+    auto start = std::chrono::steady_clock::now();
+
+    if (options.surfacesIndirect && context->shaderSurfaceIndirect)
+    {
+        surfacesFallback.clear();
+        surfacesIndirect.draw(this, draws->opaque, surfacesFallback);
+        context->shaderSurface->bind();
+        for (const DrawSurfaceTask *t : surfacesFallback)
+            drawSurface(*t);
+    }
+    else
+    {
+        context->shaderSurface->bind();
+        for (const DrawSurfaceTask &t : draws->opaque)
+            drawSurface(t);
+    }
+
+    statistics.opaqueCpuTimeUs = std::chrono::duration_cast<
+        std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
 }
 
 void RenderViewImpl::drawInfographics(const DrawInfographicsTask &t)
@@ -207,7 +291,7 @@ void RenderViewImpl::drawInfographics(const DrawInfographicsTask &t)
     data.data = rawToVec4(t.data);
     data.data2 = rawToVec4(t.data2);
 
-    useDisposableUbo(1, data)->setDebugId("UboInfographics");
+    useDisposableUbo(1, data);
 
     if (t.texColor)
     {
@@ -366,10 +450,12 @@ void RenderViewImpl::entryInitialize()
     assert(context->shaderSurface);
     OPTICK_EVENT();
 
-    uboCacheLarge.frame();
-    uboCacheSmall.frame();
+    uboRing.frame();
+    context->beginViewFrame(poolsFrame);
     clearGlState();
     frameIndex++;
+    statistics = RenderStatistics();
+    statistics.uniformBuffers = uboRing.buffersCount();
 
     if (options.width <= 0 || options.height <= 0)
     {
@@ -418,10 +504,8 @@ void RenderViewImpl::entrySurfaces()
         glDisable(GL_BLEND);
         glEnable(GL_DEPTH_TEST);
         glDepthFunc(GL_LEQUAL);
-        context->shaderSurface->bind();
         enableClipDistance(true);
-        for (const DrawSurfaceTask &t : draws->opaque)
-            drawSurface(t);
+        drawOpaque();
         enableClipDistance(false);
         CHECK_GL("rendered opaque");
     }
@@ -526,14 +610,12 @@ void RenderViewImpl::entrySurfaces()
     {
         OPTICK_EVENT("copy_depth_to_cpu");
         clearGlState();
-        if ((frameIndex % 2) == 1)
-        {
-            uint32 dw = width;
-            uint32 dh = height;
-            if (!options.debugDepthFeedback)
-                dw = dh = 0;
-            depthBuffer.performCopy(vars.depthReadTexId, dw, dh, viewProj);
-        }
+        uint32 dw = width;
+        uint32 dh = height;
+        if (!options.debugDepthFeedback)
+            dw = dh = 0;
+        depthBuffer.performCopy(vars.depthReadTexId, dw, dh,
+            options.depthFeedbackDivisor, viewProj, frameIndex, statistics);
         glViewport(0, 0, options.width, options.height);
         glScissor(0, 0, options.width, options.height);
         glBindFramebuffer(GL_FRAMEBUFFER, vars.frameRenderBufferId);
@@ -666,19 +748,37 @@ void RenderViewImpl::updateAtmosphereBuffer()
         atmBlock.uniAtmColorZenith = rawToVec4(body->atmosphere.colorZenith);
     }
 
-    useDisposableUbo(0, atmBlock)->setDebugId("uboAtm");
+    useDisposableUbo(0, atmBlock);
 }
 
 void RenderViewImpl::getWorldPosition(const double screenPos[2], double worldPos[3])
 {
-    vecToRaw(nan3(), worldPos);
-    double x = screenPos[0];
-    double y = screenPos[1];
-    y = height - y - 1;
-    x = x / width * 2 - 1;
-    y = y / height * 2 - 1;
-    double z = depthBuffer.value(x, y) * 2 - 1;
-    vecToRaw(vec4to3(vec4(viewProjInv * vec4(x, y, z, 1)), true), worldPos);
+    getWorldPositions(screenPos, 1, worldPos);
+}
+
+void RenderViewImpl::getWorldPositions(const double *screenPos, uint32 count, double *worldPos)
+{
+    // unproject with the matrix the depth was rendered with
+    const mat4 &inv = depthBuffer.getConvInv();
+    for (uint32 i = 0; i < count; i++)
+    {
+        double x = screenPos[i * 2 + 0];
+        double y = screenPos[i * 2 + 1];
+        y = height - y - 1;
+        x = x / width * 2 - 1;
+        y = y / height * 2 - 1;
+        double z = depthBuffer.value(x, y) * 2 - 1;
+        vecToRaw(vec4to3(vec4(inv * vec4(x, y, z, 1)), true), worldPos + i * 3);
+    }
+}
+
+bool RenderViewImpl::getDepthRange(const double screenRect[4], double depthRange[2])
+{
+    double x0 = screenRect[0] / width * 2 - 1;
+    double x1 = (screenRect[0] + screenRect[2]) / width * 2 - 1;
+    double y0 = (height - screenRect[1] - 1) / height * 2 - 1;
+    double y1 = (height - screenRect[1] - screenRect[3] - 1) / height * 2 - 1;
+    return depthBuffer.range(x0, y0, x1, y1, depthRange[0], depthRange[1]);
 }
 
 void RenderViewImpl::renderCompass(const double screenPosSize[3], const double mapRotation[3])
@@ -28,6 +28,13 @@
 #define RENDERER_HPP_deh4f6d4hj
 
 #include <unordered_map>
+#include <map>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
 
 #include <vts-browser/log.hpp>
 #include <vts-browser/math.hpp>
@@ -50,36 +57,78 @@ namespace renderer
 
 class RenderContextImpl;
 class GeodataTile;
+class TextShapingCache;
+class GeodataBatch;
 struct Text;
 
-// reading depth immediately requires implicit sync between cpu and gpu, which is wasteful
-//   instead, this buffer stores the depth into temporary pbo (pixel buffer object)
-//   and reads it to cpu in separate step (in next frame)
+// depth feedback for queries on the cpu (picking, labels occlusion, ...)
+// the depth is read back through a ring of pbos guarded by fences
+//   so that the cpu never waits for the gpu
+//   and the results are few frames old
+// min/max pyramid is built on the cpu for rectangle queries
 class DepthBuffer
 {
 private:
-    static const uint32 PboCount = 2;
-    Buffer buffer;
-    mat4 conv[PboCount];
-    uint32 w[PboCount], h[PboCount];
-    uint32 pbo[PboCount];
+    static const uint32 PboCount = 3;
+
+    struct Slot
+    {
+        mat4 conv;
+        GLsync fence = 0;
+        uint32 pbo = 0;
+        uint32 capacity = 0; // bytes
+        uint32 w = 0, h = 0;
+        uint32 frame = 0;
+    };
+
+    struct Level
+    {
+        std::vector<float> min, max;
+        uint32 w = 0, h = 0;
+    };
+
+    Slot slots[PboCount];
+    std::vector<Level> levels; // level 0 is the depth itself
+    mat4 conv, convInv;
     uint32 tw, th;
     uint32 fbo, tex;
-    uint32 index;
+    uint32 writeIndex; // slot for the next copy
+    uint32 pendingCount; // slots with fences
 
-    double valuePix(uint32 x, uint32 y);
+    void poll(uint32 frameIndex, RenderStatistics &stats);
+    void readback(Slot &s);
+    void discard();
+    void buildPyramid();
+    double valuePix(uint32 x, uint32 y) const;
 
 public:
     DepthBuffer();
     ~DepthBuffer();
 
+    // the view-projection matrix of the available depth
     const mat4 &getConv() const;
+    const mat4 &getConvInv() const;
 
-    void performCopy(uint32 sourceTexture, uint32 w, uint32 h, const mat4 &storeConv);
+    // picks up finished readbacks and starts a new one (if a slot is free)
+    // zero w or h disables the feedback
+    void performCopy(uint32 sourceTexture, uint32 w, uint32 h,
+        uint32 divisor, const mat4 &storeConv,
+        uint32 frameIndex, RenderStatistics &stats);
 
     // xy in -1..1
     // returns 0..1 in logarithmic depth
-    double value(double x, double y);
+    // returns NaN at far plane or outside
+    double value(double x, double y) const;
+
+    // count pairs of xy in, count values out
+    void values(const double *xy, uint32 count, double *out) const;
+
+    // minimal and maximal depth in rectangle (x0, y0, x1, y1 in -1..1)
+    // far plane counts as 1
+    // the rectangle may be extended to the pyramid texels
+    // returns false if there is no depth available
+    bool range(double x0, double y0, double x1, double y1,
+        double &dmin, double &dmax) const;
 
     std::shared_ptr<Shader> shaderCopyDepth;
     std::shared_ptr<Mesh> meshQuad;
@@ -122,18 +171,318 @@ struct GeodataJob
     vec3f worldUp() const;
 };
 
+// hysteresis state of geodata jobs across frames
+//   open addressing (linear probing) keyed by interned hysteresis ids
+class HysteresisTable
+{
+public:
+    struct Record
+    {
+        std::shared_ptr<GeodataTile> g; // keeps the tile alive while fading out
+        uint64 id = 0; // zero marks an empty slot
+        uint32 itemIndex = 0;
+        uint32 frame = 0; // last frame in which the job was generated
+        float opacity = 0;
+    };
+
+    Record *find(uint64 id);
+    Record *insert(uint64 id); // returns existing or empty record
+    void erase(uint64 id);
+    void clear();
+    uint32 size() const { return count; }
+    std::vector<Record> &slots() { return data; }
+
+private:
+    uint32 slot(uint64 id) const;
+    void rehash(uint32 capacity);
+
+    std::vector<Record> data;
+    uint32 count = 0;
+};
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+
+// opengl 4.3 is not covered by the loader, the function is loaded manually
+// null when not available
+typedef void (APIENTRYP MultiDrawElementsIndirectProc)(GLenum mode,
+    GLenum type, const void *indirect, GLsizei drawcount, GLsizei stride);
+extern MultiDrawElementsIndirectProc multiDrawElementsIndirect;
+
 extern uint32 maxAntialiasingSamples;
 extern float maxAnisotropySamples;
+extern uint32 uniformBufferOffsetAlignment;
+extern bool textureCompressionS3tc;
+extern bool textureCompressionEtc2;
+extern bool programBinaries; // glGetProgramBinary and glProgramBinary are usable
+
+// decode thread texture processing (textureDecode.cpp)
+bool compressedFormat(uint32 internalFormat);
+uint32 chooseCompressedFormat(const GpuTextureSpec &spec);
+void generateMipmaps(GpuTextureSpec &spec);
+void compressTexture(GpuTextureSpec &spec, uint32 internalFormat);
 
 void enableClipDistance(bool enable);
 
-struct UboCache
+// persistent threads for data-parallel work of the rendering thread
+class WorkerPool : private Immovable
 {
-    std::vector<std::unique_ptr<UniformBuffer>> data;
-    uint32 current, last, prev;
-    UboCache();
-    UniformBuffer *get();
+public:
+    explicit WorkerPool(uint32 threadsCount);
+    ~WorkerPool();
+
+    // calls fnc for every index in 0 .. count-1 and waits for all of them
+    // the indices are distributed dynamically (in no particular order)
+    //   and the calling thread participates too
+    void parallelFor(uint32 count, const std::function<void(uint32)> &fnc);
+
+    uint32 threadsCount() const;
+
+private:
+    void work(const std::function<void(uint32)> &fnc, uint32 count);
+    void entry();
+
+    std::vector<std::thread> threads;
+    std::mutex mut;
+    std::condition_variable conStart;
+    std::condition_variable conDone;
+    const std::function<void(uint32)> *task = nullptr;
+    std::exception_ptr error;
+    std::atomic<uint32> next {0};
+    uint32 taskCount = 0;
+    uint32 active = 0;
+    uint64 generation = 0;
+    bool stop = false;
+};
+
+// number of frames before released gpu memory is reused
+//   (the gpu may still be reading it)
+static const uint32 PoolReuseDelay = 4;
+
+// fences inserted by the render context at the end of each frame
+// memory released during a frame may be overwritten
+//   (possibly from the shared data context)
+//   only after the fence of that frame has signaled
+class FrameFences : private Immovable
+{
+public:
+    ~FrameFences();
+
+    // render thread, ends the current frame
     void frame();
+
+    // any thread, does not wait
+    bool finished(uint64 frame);
+
+private:
+    void poll();
+
+    std::deque<std::pair<uint64, GLsync>> fences; // oldest first
+    std::mutex mut;
+    uint64 frameIndex = 0;
+    uint64 finishedFrame = 0; // all frames before this have finished
+};
+
+// sub-allocates ranges from few large gpu buffers
+// the allocations may come from the data thread (shared context)
+class BufferPool : private Immovable
+{
+public:
+    BufferPool(uint32 target, const std::string &debugId,
+               const std::shared_ptr<FrameFences> &fences);
+    ~BufferPool();
+
+    // returns false if the pool cannot hold the range
+    bool allocate(uint32 size, uint32 alignment,
+                  uint32 &buffer, uint32 &offset);
+    void release(uint32 buffer, uint32 offset, uint32 size);
+    void frame(uint32 chunkSize);
+
+    uint32 chunksCount();
+    uint32 capacity();
+    uint32 used();
+    uint32 freeRanges(); // fragmentation
+    uint32 largestFree();
+
+private:
+    struct Chunk
+    {
+        std::map<uint32, uint32> free; // offset -> size
+        uint32 buffer = 0;
+        uint32 capacity = 0;
+        uint32 used = 0;
+    };
+
+    struct Pending
+    {
+        uint64 frame = 0;
+        uint32 buffer = 0;
+        uint32 offset = 0;
+        uint32 size = 0;
+    };
+
+    bool allocate(Chunk &c, uint32 size, uint32 alignment, uint32 &offset);
+    void reclaim();
+
+    const std::string debugId;
+    const std::shared_ptr<FrameFences> fences;
+    std::vector<Chunk> chunks;
+    std::deque<Pending> pending;
+    std::mutex mut;
+    uint64 frameIndex = 0;
+    uint32 chunkSize = 0;
+    const uint32 target = 0;
+};
+
+// vertex and index buffers for meshes
+class MeshPool : private Immovable
+{
+public:
+    explicit MeshPool(const std::shared_ptr<FrameFences> &fences);
+
+    BufferPool vertices;
+    BufferPool indices;
+};
+
+// keeps released textures for reuse by textures of the same size and format
+class TexturePool : private Immovable
+{
+public:
+    struct Key
+    {
+        uint32 internalFormat = 0;
+        uint32 width = 0;
+        uint32 height = 0;
+        uint32 levels = 0;
+        bool operator == (const Key &other) const;
+    };
+
+    explicit TexturePool(const std::shared_ptr<FrameFences> &fences);
+    ~TexturePool();
+
+    // returns zero if there is no texture available
+    uint32 acquire(const Key &key);
+    void release(const Key &key, uint32 id, uint32 memory);
+    void frame(uint32 memoryBudget);
+
+    uint32 texturesCount();
+    uint32 memory();
+    uint32 reuses();
+    uint32 creations();
+    void created();
+
+private:
+    struct Entry
+    {
+        Key key;
+        uint64 frame = 0;
+        uint32 id = 0;
+        uint32 memory = 0;
+    };
+
+    void evict();
+
+    const std::shared_ptr<FrameFences> fences;
+    std::deque<Entry> entries; // oldest first
+    std::mutex mut;
+    uint64 frameIndex = 0;
+    uint32 memoryBudget = 0;
+    uint32 memoryUsed = 0;
+    uint32 reusesCount = 0;
+    uint32 creationsCount = 0;
+};
+
+// per-draw uniforms sub-allocated from few large buffers
+// each frame writes into its own segment
+//   and the segment is reused when the gpu has finished with it
+class UboRing : private Immovable
+{
+public:
+    UboRing();
+    ~UboRing();
+
+    // fences the previous segment and waits for the next one
+    void frame();
+
+    // copies the data into the ring and binds the range to the index
+    void use(uint32 bindIndex, const void *data, uint32 size);
+
+    uint32 buffersCount() const;
+
+private:
+    struct Segment
+    {
+        std::vector<std::unique_ptr<UniformBuffer>> buffers;
+        GLsync fence = 0;
+        uint32 capacity = 0; // of the last buffer
+        uint32 offset = 0; // in the last buffer
+        uint32 required = 0; // all bytes used in the frame
+    };
+
+    static const uint32 SegmentsCount = 3;
+    Segment segments[SegmentsCount];
+    uint32 current = 0;
+};
+
+struct UboSurface
+{
+    mat4f p;
+    mat4f mv;
+    vec4f uvTrans; // scale-x, scale-y, offset-x, offset-y
+    vec4f uvClip;
+    vec4f color;
+    vec4si32 flags; // mask, monochromatic, flat shading, uv source, lodBlendingWithDithering, ..., blendingCoverage, frameIndex
+};
+
+// opaque surfaces drawn with few glMultiDrawElementsIndirect calls
+// draws of pooled meshes are grouped by textures and buffers
+//   and the per-draw data are fetched from a texture buffer
+class SurfacesIndirect : private Immovable
+{
+public:
+    ~SurfacesIndirect();
+
+    // tasks that cannot be drawn indirectly are added to fallback
+    void draw(RenderViewImpl *view,
+              const std::vector<DrawSurfaceTask> &tasks,
+              std::vector<const DrawSurfaceTask *> &fallback);
+
+private:
+    struct Draw
+    {
+        const DrawSurfaceTask *task = nullptr;
+        Texture *tex = nullptr;
+        Texture *mask = nullptr;
+        Mesh *mesh = nullptr;
+    };
+
+    struct Command
+    {
+        uint32 count;
+        uint32 instanceCount;
+        uint32 firstIndex;
+        uint32 baseVertex;
+        uint32 baseInstance; // index of the draw data
+    };
+
+    void upload();
+
+    std::vector<Draw> draws;
+    std::vector<vec4f> drawsData;
+    std::vector<Command> commands;
+    uint32 dataBuffer = 0;
+    uint32 dataTexture = 0;
+    uint32 commandsBuffer = 0;
+    uint32 indicesBuffer = 0; // draw index per instance
+    uint32 indicesCapacity = 0;
 };
 
 class RenderViewImpl
@@ -146,10 +495,17 @@ public:
     RenderVariables vars;
     RenderOptions options;
     DepthBuffer depthBuffer;
-    UboCache uboCacheSmall;
-    UboCache uboCacheLarge;
+    UboRing uboRing;
+    SurfacesIndirect surfacesIndirect;
+    std::vector<const DrawSurfaceTask *> surfacesFallback;
     std::vector<GeodataJob> geodataJobs;
-    std::unordered_map<std::string, GeodataJob> hysteresisJobs;
+    std::vector<std::shared_ptr<GeodataTile>> geodataJobsTiles;
+    std::vector<std::vector<GeodataJob>> geodataJobsPerTile;
+    HysteresisTable hysteresisJobs;
+    std::shared_ptr<GeodataBatch> geodataBatch;
+    RenderStatistics statistics;
+    std::vector<uint64> hysteresisErase;
+    uint32 hysteresisFrame = 0;
     CameraDraws *draws = nullptr;
     const MapCelestialBody *body = nullptr;
     Texture *atmosphereDensityTexture = nullptr;
@@ -168,6 +524,7 @@ public:
     uint32 height = 0;
     uint32 antialiasingSamplesPrev = 0;
     uint32 frameIndex = 0;
+    uint32 poolsFrame = (uint32)-1; // see RenderContextImpl::beginViewFrame
     bool projected = false;
     bool lodBlendingWithDithering = false;
     bool colorRenderWithAlphaPrev = false;
@@ -176,16 +533,21 @@ public:
 
     void clearGlState();
 
-    UniformBuffer *useDisposableUbo(uint32 bindIndex, void *data, uint32 size);
+    void useDisposableUbo(uint32 bindIndex, const void *data, uint32 size);
     template<class T>
-    UniformBuffer *useDisposableUbo(uint32 bindIndex, const T &value)
+    void useDisposableUbo(uint32 bindIndex, const T &value)
     { return useDisposableUbo(bindIndex, (void*)&value, sizeof(value)); }
 
+    void surfaceUniforms(const DrawSurfaceTask &t, Texture *tex,
+                         UboSurface &data);
     void drawSurface(const DrawSurfaceTask &t, bool wireframeSlow = false);
+    void drawOpaque();
     void drawInfographics(const DrawInfographicsTask &t);
     void updateFramebuffers();
     void updateAtmosphereBuffer();
     void getWorldPosition(const double screenPos[2], double worldPos[3]);
+    void getWorldPositions(const double *screenPos, uint32 count, double *worldPos);
+    bool getDepthRange(const double screenRect[4], double depthRange[2]);
     void renderCompass(const double screenPosSize[3], const double mapRotation[3]);
 
     void entryInitialize();
@@ -195,6 +557,7 @@ public:
 
     bool collides(const GeodataJob &a, const GeodataJob &b);
     bool geodataTestVisibility(const float visibility[4], const vec3 &pos, const vec3f &up);
+    bool geodataTestVisibility(const float visibility[4], const vec3 &pos, const vec3f &up, const vec4 &clip);
     bool geodataDepthVisibility(const vec3 &pos, float threshold);
     mat4 depthOffsetCorrection(const std::shared_ptr<GeodataTile> &g) const;
     void renderGeodataQuad(const GeodataJob &job, const Rect &rect, const vec4f &color);
@@ -202,13 +565,15 @@ public:
     void computeZBufferOffsetValues();
     void bindUboCamera();
     void renderGeodata();
-    void regenerateJobCommon(GeodataJob &j);
+    void regenerateJobCommon(GeodataJob &j, const vec4 &clip);
     void regenerateJobIcon(GeodataJob &j);
     void regenerateJobStick(GeodataJob &j);
     void regenerateJobCollision(GeodataJob &j);
     bool regenerateJobLabelFlat(GeodataJob &j);
     void regenerateJobLabelScreen(GeodataJob &j);
     bool regenerateJob(GeodataJob &j);
+    bool regenerateJob(GeodataJob &j, const vec4 &clip);
+    void generateJobsTile(const std::shared_ptr<GeodataTile> &g, std::vector<GeodataJob> &jobs);
     void generateJobs();
     void sortJobsByZIndexAndImportance();
     void renderJobsDebugRects();
@@ -222,40 +587,81 @@ public:
     void renderIcon(const GeodataJob &job);
     void renderLabelFlat(const GeodataJob &job);
     void renderLabelScreen(const GeodataJob &job);
+    void batchJob(const GeodataJob &job);
+    void flushBatch();
     void renderJobs();
 };
 
+// the shader is loaded on its first use
+class LazyShader
+{
+public:
+    void setLoader(const std::function<void(Shader &)> &loader);
+    Shader *operator -> ();
+
+private:
+    std::function<void(Shader &)> loader;
+    std::shared_ptr<Shader> shader;
+};
+
 class RenderContextImpl
 {
 public:
     RenderContext *const api = nullptr;
 
     ContextOptions options;
+    ContextStatistics statistics;
 
+    std::shared_ptr<TextShapingCache> textShapingCache;
+    std::unique_ptr<WorkerPool> workerPool;
     std::shared_ptr<Texture> texCompas;
     std::shared_ptr<Texture> texBlueNoise; // uses texture array!
     std::shared_ptr<ShaderAtm> shaderSurface;
+    std::shared_ptr<ShaderAtm> shaderSurfaceIndirect; // null if unsupported
     std::shared_ptr<ShaderAtm> shaderBackground;
     std::shared_ptr<Shader> shaderInfographics;
     std::shared_ptr<Shader> shaderTexture;
     std::shared_ptr<Shader> shaderCopyDepth;
-    std::shared_ptr<Shader> shaderGeodataColor;
-    std::shared_ptr<Shader> shaderGeodataPointFlat;
-    std::shared_ptr<Shader> shaderGeodataPointScreen;
-    std::shared_ptr<Shader> shaderGeodataLineFlat;
-    std::shared_ptr<Shader> shaderGeodataLineScreen;
-    std::shared_ptr<Shader> shaderGeodataIconScreen;
-    std::shared_ptr<Shader> shaderGeodataLabelFlat;
-    std::shared_ptr<Shader> shaderGeodataLabelScreen;
-    std::shared_ptr<Shader> shaderGeodataTriangle;
+    LazyShader shaderGeodataColor;
+    LazyShader shaderGeodataPointFlat;
+    LazyShader shaderGeodataPointScreen;
+    LazyShader shaderGeodataLineFlat;
+    LazyShader shaderGeodataLineScreen;
+    LazyShader shaderGeodataIconScreen;
+    LazyShader shaderGeodataLabelFlat;
+    LazyShader shaderGeodataLabelScreen;
+    LazyShader shaderGeodataTriangle;
+    LazyShader shaderGeodataBatchIcon;
+    LazyShader shaderGeodataBatchLabel;
     std::shared_ptr<Mesh> meshQuad; // positions: -1 .. 1
     std::shared_ptr<Mesh> meshRect; // positions: 0 .. 1
     std::shared_ptr<Mesh> meshLine;
     std::shared_ptr<Mesh> meshEmpty;
+    std::shared_ptr<FrameFences> frameFences;
+    std::shared_ptr<MeshPool> meshPool;
+    std::shared_ptr<TexturePool> texturePool;
     uint32 globalVao = 0;
+    uint32 poolsFrame = 0;
 
     RenderContextImpl(RenderContext *api);
     ~RenderContextImpl();
+
+    // advances the pools and updates their statistics
+    void updatePools();
+
+    // called by each view when it starts rendering
+    // the pools advance once per frame, even with multiple views:
+    //   a view rendering for the second time starts a new frame
+    void beginViewFrame(uint32 &viewPoolsFrame);
+
+    // loads the program and updates the statistics
+    void loadShader(Shader &shader, const std::string &vertexShader,
+        const std::string &fragmentShader);
+    void loadShaderInternal(Shader &shader, const std::string &vertexName,
+        const std::string &fragmentName);
+
+    // (re)created on demand to match options.workerThreads
+    WorkerPool &workers();
 };
 
 } // namespace renderer
@@ -148,6 +148,23 @@ void vtsRenderViewGetWorldPosition(vtsHRenderView view,
     C_END
 }
 
+void vtsRenderViewGetWorldPositions(vtsHRenderView view,
+    const double *screenPosIn, uint32 count, double *worldPosOut)
+{
+    C_BEGIN
+    view->p->getWorldPositions(screenPosIn, count, worldPosOut);
+    C_END
+}
+
+bool vtsRenderViewGetDepthRange(vtsHRenderView view,
+    const double screenRectIn[4], double depthRangeOut[2])
+{
+    C_BEGIN
+    return view->p->getDepthRange(screenRectIn, depthRangeOut);
+    C_END
+    return false;
+}
+
 #ifdef __cplusplus
 } // extern C
 #endif
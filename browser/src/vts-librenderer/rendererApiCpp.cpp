@@ -43,6 +43,15 @@ ContextOptions::ContextOptions()
     memset(this, 0, sizeof(*this));
 #ifndef __EMSCRIPTEN__
     callGlFinishAfterUploadingData = true;
+#endif // !__EMSCRIPTEN__
+    textShapingCacheMemoryKB = 16 * 1024;
+    meshPoolChunkKB = 4 * 1024;
+    texturePoolMemoryKB = 16 * 1024;
+    decodeTextureMipMaps = true;
+#ifndef __EMSCRIPTEN__
+    workerThreads = std::min(std::thread::hardware_concurrency(), 4u);
+    if (workerThreads > 0)
+        workerThreads--;
 #endif // !__EMSCRIPTEN__
 }
 
@@ -56,14 +65,54 @@ void ContextOptions::applyJson(const std::string &json)
 {
     Json::Value v = stringToJson(json);
     AJ(callGlFinishAfterUploadingData, asBool);
+    AJ(textShapingCacheMemoryKB, asUInt);
+    AJ(workerThreads, asUInt);
+    AJ(meshPoolChunkKB, asUInt);
+    AJ(texturePoolMemoryKB, asUInt);
     AJ(enforceUsingMipMaps, asBool);
+    AJ(decodeTextureMipMaps, asBool);
+    AJ(decodeTextureCompression, asBool);
 }
 
 std::string ContextOptions::toJson() const
 {
     Json::Value v;
     TJ(callGlFinishAfterUploadingData, asBool);
+    TJ(textShapingCacheMemoryKB, asUInt);
+    TJ(workerThreads, asUInt);
+    TJ(meshPoolChunkKB, asUInt);
+    TJ(texturePoolMemoryKB, asUInt);
     TJ(enforceUsingMipMaps, asBool);
+    TJ(decodeTextureMipMaps, asBool);
+    TJ(decodeTextureCompression, asBool);
+    return jsonToString(v);
+}
+
+ContextStatistics::ContextStatistics()
+{
+    memset(this, 0, sizeof(*this));
+}
+
+std::string ContextStatistics::toJson() const
+{
+    Json::Value v;
+    TJ(textShapingCacheHits, asUInt);
+    TJ(textShapingCacheMisses, asUInt);
+    TJ(textShapingCacheEntries, asUInt);
+    TJ(textShapingCacheMemoryKB, asUInt);
+    TJ(meshPoolChunks, asUInt);
+    TJ(meshPoolCapacityKB, asUInt);
+    TJ(meshPoolUsedKB, asUInt);
+    TJ(meshPoolFreeRanges, asUInt);
+    TJ(meshPoolLargestFreeKB, asUInt);
+    TJ(texturePoolTextures, asUInt);
+    TJ(texturePoolMemoryKB, asUInt);
+    TJ(texturePoolReuses, asUInt);
+    TJ(texturePoolCreations, asUInt);
+    TJ(shaderPrograms, asUInt);
+    TJ(shaderCacheHits, asUInt);
+    TJ(shaderLoadTimeUs, asUInt);
+    TJ(initializationTimeUs, asUInt);
     return jsonToString(v);
 }
 
@@ -76,8 +125,11 @@ RenderOptions::RenderOptions()
 #else
     antialiasingSamples = 4;
 #endif // !VTSR_EMBEDDED
+    depthFeedbackDivisor = 3;
     renderAtmosphere = true;
     geodataHysteresis = true;
+    geodataBatching = true;
+    surfacesIndirect = false;
     debugDepthFeedback = true;
     colorToTargetFrameBuffer = true;
 }
@@ -94,8 +146,11 @@ void RenderOptions::applyJson(const std::string &json)
     AJ(textScale, asFloat);
     AJ(antialiasingSamples, asUInt);
     AJ(debugGeodataMode, asUInt);
+    AJ(depthFeedbackDivisor, asUInt);
     AJ(renderAtmosphere, asBool);
     AJ(geodataHysteresis, asBool);
+    AJ(geodataBatching, asBool);
+    AJ(surfacesIndirect, asBool);
     AJ(colorRenderWithAlpha, asBool);
     AJ(debugFlatShading, asBool);
     AJ(debugWireframe, asBool);
@@ -108,8 +163,11 @@ std::string RenderOptions::toJson() const
     TJ(textScale, asFloat);
     TJ(antialiasingSamples, asUInt);
     TJ(debugGeodataMode, asUInt);
+    TJ(depthFeedbackDivisor, asUInt);
     TJ(renderAtmosphere, asBool);
     TJ(geodataHysteresis, asBool);
+    TJ(geodataBatching, asBool);
+    TJ(surfacesIndirect, asBool);
     TJ(colorRenderWithAlpha, asBool);
     TJ(debugFlatShading, asBool);
     TJ(debugWireframe, asBool);
@@ -117,6 +175,30 @@ std::string RenderOptions::toJson() const
     return jsonToString(v);
 }
 
+RenderStatistics::RenderStatistics()
+{
+    memset(this, 0, sizeof(*this));
+}
+
+std::string RenderStatistics::toJson() const
+{
+    Json::Value v;
+    TJ(geodataDrawCalls, asUInt);
+    TJ(geodataBatchedQuads, asUInt);
+    TJ(uniformBuffers, asUInt);
+    TJ(uniformRanges, asUInt);
+    TJ(uniformUploadBytes, asUInt);
+    TJ(surfaceDrawCalls, asUInt);
+    TJ(surfaceIndirectDraws, asUInt);
+    TJ(opaqueCpuTimeUs, asUInt);
+    TJ(depthFeedbackWidth, asUInt);
+    TJ(depthFeedbackHeight, asUInt);
+    TJ(depthReadbacks, asUInt);
+    TJ(depthReadbacksSkipped, asUInt);
+    TJ(depthFeedbackLatency, asUInt);
+    return jsonToString(v);
+}
+
 RenderVariables::RenderVariables()
 {
     memset(this, 0, sizeof(*this));
@@ -135,17 +217,26 @@ ContextOptions &RenderContext::options()
     return impl->options;
 }
 
+const ContextStatistics &RenderContext::statistics() const
+{
+    return impl->statistics;
+}
+
 void RenderContext::bindLoadFunctions(Map *map)
 {
     assert(map);
     map->callbacks().loadTexture = std::bind(&RenderContext::loadTexture, this,
         std::placeholders::_1, std::placeholders::_2, std::placeholders::_3);
+    map->callbacks().decodeTexture = std::bind(&RenderContext::decodeTexture,
+        this, std::placeholders::_1, std::placeholders::_2);
     map->callbacks().loadMesh = std::bind(&RenderContext::loadMesh, this,
         std::placeholders::_1, std::placeholders::_2, std::placeholders::_3);
     map->callbacks().loadFont = std::bind(&RenderContext::loadFont, this,
         std::placeholders::_1, std::placeholders::_2, std::placeholders::_3);
     map->callbacks().loadGeodata = std::bind(&RenderContext::loadGeodata, this,
         std::placeholders::_1, std::placeholders::_2, std::placeholders::_3);
+    map->callbacks().decodeGeodata = std::bind(&RenderContext::decodeGeodata,
+        this, std::placeholders::_1, std::placeholders::_2);
 }
 
 std::shared_ptr<RenderView> RenderContext::createView(Camera *cam)
@@ -203,6 +294,11 @@ const RenderVariables &RenderView::variables() const
     return impl->vars;
 }
 
+const RenderStatistics &RenderView::statistics() const
+{
+    return impl->statistics;
+}
+
 void RenderView::render(RenderDraws *draws)
 {
     OPTICK_EVENT();
@@ -274,5 +370,17 @@ void RenderView::getWorldPosition(const double screenPosIn[2],
     impl->getWorldPosition(screenPosIn, worldPosOut);
 }
 
+void RenderView::getWorldPositions(const double *screenPosIn,
+                      uint32 count, double *worldPosOut)
+{
+    impl->getWorldPositions(screenPosIn, count, worldPosOut);
+}
+
+bool RenderView::getDepthRange(const double screenRectIn[4],
+                      double depthRangeOut[2])
+{
+    return impl->getDepthRange(screenRectIn, depthRangeOut);
+}
+
 } } // namespace vts renderer
 
@@ -0,0 +1,227 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <tuple>
+
+#include <vts-browser/cameraDraws.hpp>
+
+#include <optick.h>
+
+#include "renderer.hpp"
+
+namespace vts { namespace renderer
+{
+
+MultiDrawElementsIndirectProc multiDrawElementsIndirect = nullptr;
+
+namespace
+{
+
+bool compatibleAttributes(const GpuMeshSpec &a, const GpuMeshSpec &b)
+{
+    for (uint32 i = 0; i < a.attributes.size(); i++)
+    {
+        const auto &x = a.attributes[i];
+        const auto &y = b.attributes[i];
+        if (x.enable != y.enable)
+            return false;
+        if (!x.enable)
+            continue;
+        if (x.offset != y.offset || x.stride != y.stride
+            || x.components != y.components || x.type != y.type
+            || x.normalized != y.normalized)
+            return false;
+    }
+    return true;
+}
+
+} // namespace
+
+SurfacesIndirect::~SurfacesIndirect()
+{
+    if (dataTexture)
+        glDeleteTextures(1, &dataTexture);
+    if (dataBuffer)
+        glDeleteBuffers(1, &dataBuffer);
+    if (commandsBuffer)
+        glDeleteBuffers(1, &commandsBuffer);
+    if (indicesBuffer)
+        glDeleteBuffers(1, &indicesBuffer);
+}
+
+void SurfacesIndirect::upload()
+{
+    if (!dataBuffer)
+    {
+        glGenBuffers(1, &dataBuffer);
+        glGenBuffers(1, &commandsBuffer);
+        glGenBuffers(1, &indicesBuffer);
+        glGenTextures(1, &dataTexture);
+        glBindBuffer(GL_TEXTURE_BUFFER, dataBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, sizeof(vec4f), nullptr,
+                     GL_STREAM_DRAW);
+        glBindTexture(GL_TEXTURE_BUFFER, dataTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, dataBuffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+    }
+
+    // orphan the previous storage, the gpu may still be reading it
+    glBindBuffer(GL_TEXTURE_BUFFER, dataBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, drawsData.size() * sizeof(vec4f),
+                 drawsData.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandsBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(Command),
+                 commands.data(), GL_STREAM_DRAW);
+
+    // instanced attribute with the index of the draw
+    //   (offset by the baseInstance of each command)
+    if (indicesCapacity < draws.size())
+    {
+        indicesCapacity = std::max<uint32>(draws.size() * 2, 1024);
+        std::vector<uint32> indices(indicesCapacity);
+        for (uint32 i = 0; i < indicesCapacity; i++)
+            indices[i] = i;
+        glBindBuffer(GL_ARRAY_BUFFER, indicesBuffer);
+        glBufferData(GL_ARRAY_BUFFER, indicesCapacity * sizeof(uint32),
+                     indices.data(), GL_STATIC_DRAW);
+    }
+
+    CHECK_GL("upload indirect surfaces");
+}
+
+void SurfacesIndirect::draw(RenderViewImpl *view,
+    const std::vector<DrawSurfaceTask> &tasks,
+    std::vector<const DrawSurfaceTask *> &fallback)
+{
+    OPTICK_EVENT();
+    assert(multiDrawElementsIndirect);
+
+    draws.clear();
+    for (const DrawSurfaceTask &t : tasks)
+    {
+        Draw d;
+        d.task = &t;
+        d.tex = (Texture*)t.texColor.get();
+        d.mask = (Texture*)t.texMask.get();
+        d.mesh = (Mesh*)t.mesh.get();
+        if (!d.mesh || !d.tex)
+            continue;
+        const GpuMeshSpec &s = d.mesh->getSpec();
+        if (!d.mesh->getPooled() || s.indicesCount == 0
+            || s.faceMode != GpuMeshSpec::FaceMode::Triangles
+            || s.attributes[0].stride == 0)
+        {
+            fallback.push_back(&t);
+            continue;
+        }
+        draws.push_back(d);
+    }
+    if (draws.empty())
+        return;
+
+    // group the draws that share all bound state
+    std::stable_sort(draws.begin(), draws.end(),
+        [](const Draw &a, const Draw &b) {
+        return std::make_tuple(a.tex, a.mask, a.mesh->getVbo(),
+                               a.mesh->getVio())
+             < std::make_tuple(b.tex, b.mask, b.mesh->getVbo(),
+                               b.mesh->getVio());
+    });
+
+    drawsData.resize(draws.size() * 8);
+    commands.resize(draws.size());
+    for (uint32 i = 0, e = draws.size(); i != e; i++)
+    {
+        const Draw &d = draws[i];
+        UboSurface u;
+        view->surfaceUniforms(*d.task, d.tex, u);
+        vec4f *o = drawsData.data() + i * 8;
+        for (uint32 c = 0; c < 4; c++)
+            o[c] = u.mv.col(c);
+        o[4] = u.uvTrans;
+        o[5] = u.uvClip;
+        o[6] = u.color;
+        memcpy(o[7].data(), u.flags.data(), sizeof(vec4f));
+
+        const GpuMeshSpec &s = d.mesh->getSpec();
+        Command &c = commands[i];
+        c.count = s.indicesCount;
+        c.instanceCount = 1;
+        c.firstIndex = d.mesh->getVioOffset() / gpuTypeSize(s.indexMode);
+        c.baseVertex = d.mesh->getVboOffset() / s.attributes[0].stride;
+        c.baseInstance = i;
+    }
+
+    upload();
+
+    view->context->shaderSurfaceIndirect->bind();
+    mat4f proj = view->proj.cast<float>();
+    view->useDisposableUbo(1, proj);
+    glActiveTexture(GL_TEXTURE0 + 8);
+    glBindTexture(GL_TEXTURE_BUFFER, dataTexture);
+    glActiveTexture(GL_TEXTURE0 + 0);
+
+    for (uint32 b = 0, e = draws.size(); b != e;)
+    {
+        const Draw &d = draws[b];
+        const GpuMeshSpec &s = d.mesh->getSpec();
+        uint32 n = b + 1;
+        while (n != e && draws[n].tex == d.tex && draws[n].mask == d.mask
+            && draws[n].mesh->getVbo() == d.mesh->getVbo()
+            && draws[n].mesh->getVio() == d.mesh->getVio()
+            && draws[n].mesh->getSpec().indexMode == s.indexMode
+            && compatibleAttributes(draws[n].mesh->getSpec(), s))
+            n++;
+
+        if (d.mask)
+        {
+            glActiveTexture(GL_TEXTURE0 + 1);
+            d.mask->bind();
+            glActiveTexture(GL_TEXTURE0 + 0);
+        }
+        d.tex->bind();
+        d.mesh->bindChunk();
+        glBindBuffer(GL_ARRAY_BUFFER, indicesBuffer);
+        glEnableVertexAttribArray(3);
+        glVertexAttribIPointer(3, 1, GL_UNSIGNED_INT, 0, nullptr);
+        glVertexAttribDivisor(3, 1);
+
+        multiDrawElementsIndirect(GL_TRIANGLES, (GLenum)s.indexMode,
+            (void*)(std::size_t)(b * sizeof(Command)), n - b, 0);
+        view->statistics.surfaceDrawCalls++;
+        b = n;
+    }
+    view->statistics.surfaceIndirectDraws += draws.size();
+
+    glVertexAttribDivisor(3, 0);
+    glDisableVertexAttribArray(3);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    CHECK_GL("draw indirect surfaces");
+}
+
+} } // namespace vts renderer
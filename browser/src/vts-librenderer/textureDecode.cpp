@@ -0,0 +1,508 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "renderer.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <cstdlib>
+
+namespace vts { namespace renderer
+{
+
+namespace
+{
+
+bool powerOfTwo(uint32 v)
+{
+    return v > 0 && (v & (v - 1)) == 0;
+}
+
+// 2x2 box filter, odd sizes clamp the last row/column
+void downsample(const uint8 *src, uint32 w, uint32 h,
+    uint8 *dst, uint32 w2, uint32 h2, uint32 c)
+{
+    for (uint32 y = 0; y < h2; y++)
+    {
+        const uint8 *r0 = src + std::min(y * 2, h - 1) * w * c;
+        const uint8 *r1 = src + std::min(y * 2 + 1, h - 1) * w * c;
+        uint8 *d = dst + y * w2 * c;
+        for (uint32 x = 0; x < w2; x++)
+        {
+            uint32 s0 = std::min(x * 2, w - 1) * c;
+            uint32 s1 = std::min(x * 2 + 1, w - 1) * c;
+            for (uint32 k = 0; k < c; k++)
+            {
+                d[x * c + k] = (r0[s0 + k] + r0[s1 + k]
+                    + r1[s0 + k] + r1[s1 + k] + 2) >> 2;
+            }
+        }
+    }
+}
+
+// extracts 4x4 rgba pixels, clamped to the image
+void fetchBlock(const uint8 *src, uint32 w, uint32 h, uint32 c,
+    uint32 bx, uint32 by, uint8 px[64])
+{
+    for (uint32 y = 0; y < 4; y++)
+    {
+        for (uint32 x = 0; x < 4; x++)
+        {
+            const uint8 *s = src + (std::min(by * 4 + y, h - 1) * w
+                + std::min(bx * 4 + x, w - 1)) * c;
+            uint8 *p = px + (y * 4 + x) * 4;
+            p[0] = s[0];
+            p[1] = s[1];
+            p[2] = s[2];
+            p[3] = c == 4 ? s[3] : 255;
+        }
+    }
+}
+
+int sqr(int v)
+{
+    return v * v;
+}
+
+uint16 to565(const int rgb[3])
+{
+    return ((rgb[0] * 31 + 127) / 255) << 11
+        | ((rgb[1] * 63 + 127) / 255) << 5
+        | ((rgb[2] * 31 + 127) / 255);
+}
+
+void from565(uint16 c, int rgb[3])
+{
+    int r = (c >> 11) & 31;
+    int g = (c >> 5) & 63;
+    int b = c & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+// bc1 color block (also used by bc3), always in the 4 colors mode
+void encodeBc1(const uint8 px[64], uint8 *out)
+{
+    int mn[3] = { 255, 255, 255 };
+    int mx[3] = { 0, 0, 0 };
+    int mean[3] = { 0, 0, 0 };
+    for (uint32 i = 0; i < 16; i++)
+    {
+        for (uint32 k = 0; k < 3; k++)
+        {
+            int v = px[i * 4 + k];
+            mn[k] = std::min(mn[k], v);
+            mx[k] = std::max(mx[k], v);
+            mean[k] += v;
+        }
+    }
+
+    // inset the bounding box to reduce the error of the extremes
+    for (uint32 k = 0; k < 3; k++)
+    {
+        mean[k] /= 16;
+        int inset = (mx[k] - mn[k]) >> 4;
+        mn[k] += inset;
+        mx[k] -= inset;
+    }
+
+    // choose the diagonal of the box that follows the colors
+    int covRg = 0, covBg = 0;
+    for (uint32 i = 0; i < 16; i++)
+    {
+        int g = px[i * 4 + 1] - mean[1];
+        covRg += (px[i * 4 + 0] - mean[0]) * g;
+        covBg += (px[i * 4 + 2] - mean[2]) * g;
+    }
+    if (covRg < 0)
+        std::swap(mn[0], mx[0]);
+    if (covBg < 0)
+        std::swap(mn[2], mx[2]);
+
+    uint16 c0 = to565(mx);
+    uint16 c1 = to565(mn);
+    if (c0 < c1)
+        std::swap(c0, c1);
+
+    uint32 indices = 0;
+    if (c0 != c1)
+    {
+        int pal[4][3];
+        from565(c0, pal[0]);
+        from565(c1, pal[1]);
+        for (uint32 k = 0; k < 3; k++)
+        {
+            pal[2][k] = (2 * pal[0][k] + pal[1][k]) / 3;
+            pal[3][k] = (pal[0][k] + 2 * pal[1][k]) / 3;
+        }
+        for (uint32 i = 0; i < 16; i++)
+        {
+            const uint8 *p = px + i * 4;
+            uint32 best = 0;
+            int bestErr = std::numeric_limits<int>::max();
+            for (uint32 j = 0; j < 4; j++)
+            {
+                int err = sqr(p[0] - pal[j][0]) + sqr(p[1] - pal[j][1])
+                    + sqr(p[2] - pal[j][2]);
+                if (err < bestErr)
+                {
+                    bestErr = err;
+                    best = j;
+                }
+            }
+            indices |= best << (i * 2);
+        }
+    }
+
+    out[0] = c0 & 0xff;
+    out[1] = c0 >> 8;
+    out[2] = c1 & 0xff;
+    out[3] = c1 >> 8;
+    for (uint32 i = 0; i < 4; i++)
+        out[4 + i] = (indices >> (i * 8)) & 0xff;
+}
+
+// bc3 alpha block, in the 8 values mode
+void encodeBc3Alpha(const uint8 px[64], uint8 *out)
+{
+    int a0 = 0, a1 = 255;
+    for (uint32 i = 0; i < 16; i++)
+    {
+        a0 = std::max(a0, (int)px[i * 4 + 3]);
+        a1 = std::min(a1, (int)px[i * 4 + 3]);
+    }
+
+    uint64 indices = 0;
+    if (a0 > a1)
+    {
+        int pal[8];
+        pal[0] = a0;
+        pal[1] = a1;
+        for (int i = 1; i < 7; i++)
+            pal[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+        for (uint32 i = 0; i < 16; i++)
+        {
+            int a = px[i * 4 + 3];
+            uint64 best = 0;
+            int bestErr = 256;
+            for (uint32 j = 0; j < 8; j++)
+            {
+                int err = std::abs(a - pal[j]);
+                if (err < bestErr)
+                {
+                    bestErr = err;
+                    best = j;
+                }
+            }
+            indices |= best << (i * 3);
+        }
+    }
+
+    out[0] = a0;
+    out[1] = a1;
+    for (uint32 i = 0; i < 6; i++)
+        out[2 + i] = (indices >> (i * 8)) & 0xff;
+}
+
+const int etcModifiers[8][2] = {
+    { 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 },
+    { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 },
+};
+
+int clamp255(int v)
+{
+    return std::min(std::max(v, 0), 255);
+}
+
+// finds the best modifiers table for the pixels of one sub-block
+int encodeEtcSubblock(const uint8 px[64], const uint32 pixels[8],
+    const int base[3], uint32 &table, uint32 indices[8])
+{
+    int bestTotal = std::numeric_limits<int>::max();
+    for (uint32 t = 0; t < 8; t++)
+    {
+        int mods[4] = { etcModifiers[t][0], etcModifiers[t][1],
+                        -etcModifiers[t][0], -etcModifiers[t][1] };
+        int total = 0;
+        uint32 tmp[8];
+        for (uint32 j = 0; j < 8; j++)
+        {
+            const uint8 *p = px + pixels[j] * 4;
+            int bestErr = std::numeric_limits<int>::max();
+            for (uint32 m = 0; m < 4; m++)
+            {
+                int err = sqr(clamp255(base[0] + mods[m]) - p[0])
+                    + sqr(clamp255(base[1] + mods[m]) - p[1])
+                    + sqr(clamp255(base[2] + mods[m]) - p[2]);
+                if (err < bestErr)
+                {
+                    bestErr = err;
+                    tmp[j] = m;
+                }
+            }
+            total += bestErr;
+        }
+        if (total < bestTotal)
+        {
+            bestTotal = total;
+            table = t;
+            std::copy(tmp, tmp + 8, indices);
+        }
+    }
+    return bestTotal;
+}
+
+// etc1 block (which is valid etc2 rgb block too)
+// individual or differential mode, both flips are tried
+void encodeEtc(const uint8 px[64], uint8 *out)
+{
+    uint32 bestHi = 0, bestLo = 0;
+    int bestErr = std::numeric_limits<int>::max();
+    for (uint32 flip = 0; flip < 2; flip++)
+    {
+        // pixel indices (y * 4 + x) of the two sub-blocks
+        uint32 pixels[2][8];
+        for (uint32 j = 0; j < 8; j++)
+        {
+            uint32 a = j / 4, b = j % 4;
+            if (flip)
+            {
+                pixels[0][j] = a * 4 + b; // top 4x2
+                pixels[1][j] = (a + 2) * 4 + b; // bottom 4x2
+            }
+            else
+            {
+                pixels[0][j] = b * 4 + a; // left 2x4
+                pixels[1][j] = b * 4 + a + 2; // right 2x4
+            }
+        }
+
+        int avg[2][3] = {};
+        for (uint32 s = 0; s < 2; s++)
+        {
+            for (uint32 j = 0; j < 8; j++)
+                for (uint32 k = 0; k < 3; k++)
+                    avg[s][k] += px[pixels[s][j] * 4 + k];
+            for (uint32 k = 0; k < 3; k++)
+                avg[s][k] = (avg[s][k] + 4) / 8;
+        }
+
+        // quantize the base colors
+        int q[2][3], base[2][3];
+        bool diff = true;
+        for (uint32 s = 0; s < 2; s++)
+            for (uint32 k = 0; k < 3; k++)
+                q[s][k] = (avg[s][k] * 31 + 127) / 255;
+        for (uint32 k = 0; k < 3; k++)
+        {
+            int d = q[1][k] - q[0][k];
+            if (d < -4 || d > 3)
+                diff = false;
+        }
+        for (uint32 s = 0; s < 2; s++)
+        {
+            for (uint32 k = 0; k < 3; k++)
+            {
+                if (diff)
+                    base[s][k] = (q[s][k] << 3) | (q[s][k] >> 2);
+                else
+                {
+                    q[s][k] = (avg[s][k] * 15 + 127) / 255;
+                    base[s][k] = q[s][k] * 17;
+                }
+            }
+        }
+
+        uint32 tables[2];
+        uint32 indices[2][8];
+        int err = encodeEtcSubblock(px, pixels[0], base[0],
+                                    tables[0], indices[0])
+                + encodeEtcSubblock(px, pixels[1], base[1],
+                                    tables[1], indices[1]);
+        if (err >= bestErr)
+            continue;
+        bestErr = err;
+
+        uint32 hi = 0;
+        if (diff)
+        {
+            for (uint32 k = 0; k < 3; k++)
+            {
+                uint32 d = (q[1][k] - q[0][k]) & 7;
+                hi |= (q[0][k] << 3 | d) << (24 - k * 8);
+            }
+            hi |= 2;
+        }
+        else
+        {
+            for (uint32 k = 0; k < 3; k++)
+                hi |= (q[0][k] << 4 | q[1][k]) << (24 - k * 8);
+        }
+        hi |= tables[0] << 5 | tables[1] << 2 | flip;
+
+        uint32 lo = 0;
+        for (uint32 s = 0; s < 2; s++)
+        {
+            for (uint32 j = 0; j < 8; j++)
+            {
+                uint32 p = pixels[s][j];
+                uint32 bit = (p % 4) * 4 + p / 4; // column major
+                uint32 v = indices[s][j];
+                lo |= (v >> 1) << (bit + 16);
+                lo |= (v & 1) << bit;
+            }
+        }
+
+        bestHi = hi;
+        bestLo = lo;
+    }
+
+    for (uint32 i = 0; i < 4; i++)
+    {
+        out[i] = (bestHi >> (24 - i * 8)) & 0xff;
+        out[i + 4] = (bestLo >> (24 - i * 8)) & 0xff;
+    }
+}
+
+Buffer compressLevel(const Buffer &src, uint32 w, uint32 h, uint32 c,
+    uint32 internalFormat)
+{
+    uint32 bw = (w + 3) / 4;
+    uint32 bh = (h + 3) / 4;
+    uint32 blockSize = internalFormat == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+        ? 16 : 8;
+    Buffer out(bw * bh * blockSize);
+    uint8 px[64];
+    for (uint32 by = 0; by < bh; by++)
+    {
+        for (uint32 bx = 0; bx < bw; bx++)
+        {
+            fetchBlock((const uint8*)src.data(), w, h, c, bx, by, px);
+            uint8 *o = (uint8*)out.data() + (by * bw + bx) * blockSize;
+            switch (internalFormat)
+            {
+            case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+                encodeBc1(px, o);
+                break;
+            case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+                encodeBc3Alpha(px, o);
+                encodeBc1(px, o + 8);
+                break;
+            case GL_COMPRESSED_RGB8_ETC2:
+                encodeEtc(px, o);
+                break;
+            default:
+                throw std::invalid_argument("unsupported texture compression");
+            }
+        }
+    }
+    return out;
+}
+
+} // namespace
+
+bool compressedFormat(uint32 internalFormat)
+{
+    switch (internalFormat)
+    {
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+    case GL_COMPRESSED_RGB8_ETC2:
+    case GL_COMPRESSED_RGBA8_ETC2_EAC:
+        return true;
+    default:
+        return false;
+    }
+}
+
+uint32 chooseCompressedFormat(const GpuTextureSpec &spec)
+{
+    // whole blocks on all mipmap levels
+    if (spec.type != GpuTypeEnum::UnsignedByte
+        || !powerOfTwo(spec.width) || !powerOfTwo(spec.height)
+        || spec.width < 4 || spec.height < 4)
+        return 0;
+    switch (spec.components)
+    {
+    case 3:
+        if (textureCompressionS3tc)
+            return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        if (textureCompressionEtc2)
+            return GL_COMPRESSED_RGB8_ETC2;
+        return 0;
+    case 4:
+        if (textureCompressionS3tc)
+            return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        return 0;
+    default:
+        return 0;
+    }
+}
+
+void generateMipmaps(GpuTextureSpec &spec)
+{
+    assert(spec.type == GpuTypeEnum::UnsignedByte);
+    assert(spec.mipmaps.empty());
+    uint32 w = spec.width;
+    uint32 h = spec.height;
+    uint32 levels = 0;
+    while ((w >> levels) > 1 || (h >> levels) > 1)
+        levels++;
+    spec.mipmaps.reserve(levels);
+    const Buffer *src = &spec.buffer;
+    for (uint32 level = 0; level < levels; level++)
+    {
+        uint32 w2 = std::max(w / 2, 1u);
+        uint32 h2 = std::max(h / 2, 1u);
+        Buffer dst(w2 * h2 * spec.components);
+        downsample((const uint8*)src->data(), w, h,
+                   (uint8*)dst.data(), w2, h2, spec.components);
+        spec.mipmaps.push_back(std::move(dst));
+        src = &spec.mipmaps.back();
+        w = w2;
+        h = h2;
+    }
+}
+
+void compressTexture(GpuTextureSpec &spec, uint32 internalFormat)
+{
+    assert(spec.type == GpuTypeEnum::UnsignedByte);
+    assert(compressedFormat(internalFormat));
+    uint32 c = spec.components;
+    spec.buffer = compressLevel(spec.buffer,
+        spec.width, spec.height, c, internalFormat);
+    uint32 level = 1;
+    for (Buffer &b : spec.mipmaps)
+    {
+        b = compressLevel(b, std::max(spec.width >> level, 1u),
+            std::max(spec.height >> level, 1u), c, internalFormat);
+        level++;
+    }
+    spec.internalFormat = internalFormat;
+}
+
+} } // namespace vts renderer
@@ -0,0 +1,151 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "renderer.hpp"
+
+#include <optick.h>
+
+namespace vts { namespace renderer
+{
+
+WorkerPool::WorkerPool(uint32 threadsCount)
+{
+    threads.reserve(threadsCount);
+    for (uint32 i = 0; i < threadsCount; i++)
+        threads.emplace_back(&WorkerPool::entry, this);
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mut);
+        stop = true;
+    }
+    conStart.notify_all();
+    for (std::thread &t : threads)
+        t.join();
+}
+
+uint32 WorkerPool::threadsCount() const
+{
+    return threads.size();
+}
+
+void WorkerPool::parallelFor(uint32 count,
+    const std::function<void(uint32)> &fnc)
+{
+    if (threads.empty() || count <= 1)
+    {
+        for (uint32 i = 0; i < count; i++)
+            fnc(i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mut);
+        assert(!task);
+        task = &fnc;
+        taskCount = count;
+        next = 0;
+        error = nullptr;
+        generation++;
+    }
+    conStart.notify_all();
+
+    // the calling thread helps too
+    work(fnc, count);
+
+    std::exception_ptr e;
+    {
+        std::unique_lock<std::mutex> lock(mut);
+        conDone.wait(lock, [&]() { return active == 0; });
+        task = nullptr;
+        std::swap(e, error);
+    }
+    if (e)
+        std::rethrow_exception(e);
+}
+
+void WorkerPool::work(const std::function<void(uint32)> &fnc, uint32 count)
+{
+    while (true)
+    {
+        uint32 i = next++;
+        if (i >= count)
+            return;
+        try
+        {
+            fnc(i);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            if (!error)
+                error = std::current_exception();
+        }
+    }
+}
+
+void WorkerPool::entry()
+{
+    OPTICK_THREAD("renderer worker");
+    uint64 seen = 0;
+    while (true)
+    {
+        const std::function<void(uint32)> *fnc = nullptr;
+        uint32 count = 0;
+        {
+            std::unique_lock<std::mutex> lock(mut);
+            conStart.wait(lock, [&]() {
+                return stop || (task && generation != seen);
+            });
+            if (stop)
+                return;
+            seen = generation;
+            fnc = task;
+            count = taskCount;
+            active++;
+        }
+        work(*fnc, count);
+        {
+            std::lock_guard<std::mutex> lock(mut);
+            active--;
+        }
+        conDone.notify_all();
+    }
+}
+
+WorkerPool &RenderContextImpl::workers()
+{
+    if (!workerPool || workerPool->threadsCount() != options.workerThreads)
+    {
+        workerPool.reset();
+        workerPool = std::make_unique<WorkerPool>(options.workerThreads);
+    }
+    return *workerPool;
+}
+
+} } // namespace vts renderer